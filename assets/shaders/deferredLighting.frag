@@ -0,0 +1,390 @@
+#version 450
+
+// Fullscreen lighting pass of the deferred path (vertex shader: post.vert).
+// Reads the G-buffer written by pbrDeferred.frag and evaluates the same BRDF as pbrForward.frag.
+
+layout(location = 0) in vec2 inTexCoord;
+
+layout(set = 0, binding = 0) uniform SceneDataUBO {
+    mat4 projection;
+    mat4 view;
+    vec3 cameraPos;
+    float padding1;
+    vec3 directionalLightDir;
+    float padding2;
+    vec3 directionalLightColor;
+    float padding3;
+    mat4 lightSpaceMatrix;
+    mat4 inverseViewProjection;
+    mat4 cascadeMatrices[4]; // Light view-projection per shadow cascade
+    vec4 cascadeSplits;      // Far view distance of each cascade
+} sceneData;
+
+layout(set = 0, binding = 1) uniform OptionsUBO {
+    int textureOn;
+    int shadowOn;
+    int discardOn;
+    int animationOn;
+    float ssaoRadius;
+    float ssaoBias;
+    int ssaoSampleCount;
+    float ssaoPower;
+    int ssaoOn;
+} options;
+
+// Per-model weights that the forward path reads from push constants
+// x: specularWeight, y: diffuseWeight, z: shadowOffset
+layout(set = 0, binding = 2) uniform ModelCoeffsUBO {
+    vec4 coeffs[64];
+} modelCoeffs;
+
+// G-buffer
+layout(set = 1, binding = 0) uniform sampler2D gAlbedo;
+layout(set = 1, binding = 1) uniform sampler2D gNormal;
+layout(set = 1, binding = 2) uniform sampler2D gMaterial;
+layout(set = 1, binding = 3) uniform sampler2D gEmissive;
+layout(set = 1, binding = 4) uniform sampler2D gDepth;
+layout(set = 1, binding = 5, r32f) uniform readonly image2D ssaoImage; // ssaoUpsample.comp
+
+// IBL textures
+layout(set = 2, binding = 0) uniform samplerCube prefilteredMap;
+layout(set = 2, binding = 1) uniform samplerCube irradianceMap;
+layout(set = 2, binding = 2) uniform sampler2D brdfLUT;
+
+layout(set = 3, binding = 0) uniform sampler2DArrayShadow shadowMap; // One layer per cascade
+
+// Clustered point/spot lights (built by clusterLights.comp)
+layout(set = 4, binding = 0) uniform ClusterUBO {
+    mat4 view;
+    mat4 inverseProjection;
+    uvec4 gridSize; // w: light count
+    vec4 zParams;   // x: near, y: far, z: slice scale, w: slice bias
+    vec4 tileSize;  // xy: cluster size in pixels, zw: render target size
+} cluster;
+
+struct LocalLight {
+    vec3 position;
+    float range;
+    vec3 color;
+    float spotCosOuter;
+    vec3 direction;
+    float spotCosInner;
+};
+
+layout(std430, set = 4, binding = 1) readonly buffer LightBuffer {
+    LocalLight lights[];
+};
+
+layout(std430, set = 4, binding = 2) readonly buffer ClusterLightCounts {
+    uint lightCounts[];
+};
+
+layout(std430, set = 4, binding = 3) readonly buffer ClusterLightIndices {
+    uint lightIndices[];
+};
+
+layout(location = 0) out vec4 outColor;
+
+const float PI = 3.14159265359;
+const float MAX_REFLECTION_LOD = 4.0;
+
+vec3 decodeOctahedral(vec2 f)
+{
+    vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+const int SHADOW_CASCADES = 4; // ShadowMap::kCascadeCount
+
+// Cascaded shadow lookup: the cascade is picked by view distance, fragments beyond the last
+// split are unshadowed
+float calculateShadow(vec3 worldPos)
+{
+    float viewDistance = -(sceneData.view * vec4(worldPos, 1.0)).z;
+    int cascade = 0;
+    while (cascade < SHADOW_CASCADES && viewDistance > sceneData.cascadeSplits[cascade]) {
+        cascade++;
+    }
+    if (cascade == SHADOW_CASCADES) {
+        return 1.0;
+    }
+
+    const mat4 scaleBias = mat4(
+        0.5, 0.0, 0.0, 0.0,
+        0.0, 0.5, 0.0, 0.0,
+        0.0, 0.0, 1.0, 0.0,
+        0.5, 0.5, 0.0, 1.0
+    );
+    vec4 fragPosLightSpace = scaleBias * sceneData.cascadeMatrices[cascade] * vec4(worldPos, 1.0);
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+
+    if(projCoords.z <= -1.0 || projCoords.z >= 1.0)
+        return 1.0;
+
+    const vec2 poissonDisk[16] = vec2[](
+        vec2(-0.94201624, -0.39906216),
+        vec2(0.94558609, -0.76890725),
+        vec2(-0.09418410, -0.92938870),
+        vec2(0.34495938, 0.29387760),
+        vec2(-0.91588581, 0.45771432),
+        vec2(-0.81544232, -0.87912464),
+        vec2(-0.38277543, 0.27676845),
+        vec2(0.97484398, 0.75648379),
+        vec2(0.44323325, -0.97511554),
+        vec2(0.53742981, -0.47373420),
+        vec2(-0.26496911, -0.41893023),
+        vec2(0.79197514, 0.19090188),
+        vec2(-0.24188840, 0.99706507),
+        vec2(-0.81409955, 0.91437590),
+        vec2(0.19984126, 0.78641367),
+        vec2(0.14383161, -0.14100790)
+    );
+
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float filterRadius = 2.0;
+
+    for(int i = 0; i < 16; ++i)
+    {
+        vec2 offset = poissonDisk[i] * texelSize * filterRadius;
+        shadow += texture(shadowMap, vec4(projCoords.xy + offset, float(cascade), projCoords.z));
+    }
+    shadow /= 16.0;
+
+    return shadow;
+}
+
+float clampedDot(vec3 x, vec3 y)
+{
+    return clamp(dot(x, y), 0.0, 1.0);
+}
+
+vec3 getIBLGGXFresnel(vec3 n, vec3 v, float roughness, vec3 F0, float specularWeight)
+{
+    float NdotV = clamp(dot(n, v),0.0, 1.0);
+    vec2 brdfSamplePoint = clamp(vec2(NdotV, roughness), vec2(0.0, 0.0), vec2(1.0, 1.0));
+    vec2 f_ab = texture(brdfLUT, brdfSamplePoint).rg;
+    vec3 Fr = max(vec3(1.0 - roughness), F0) - F0;
+    vec3 k_S = F0 + Fr * pow(1.0 - NdotV, 5.0);
+    vec3 FssEss = specularWeight * (k_S * f_ab.x + f_ab.y);
+
+    float Ems = (1.0 - (f_ab.x + f_ab.y));
+    vec3 F_avg = specularWeight * (F0 + (1.0 - F0) / 21.0);
+    vec3 FmsEms = Ems * FssEss * F_avg / (1.0 - F_avg * Ems);
+
+    return FssEss + FmsEms;
+}
+
+vec3 getIBLRadianceGGX(vec3 n, vec3 v, float roughness)
+{
+    float lod = roughness * float(MAX_REFLECTION_LOD - 1) + 0.5;
+    vec3 reflection = normalize(reflect(-v, n));
+    return textureLod(prefilteredMap, reflection, lod).rgb;
+}
+
+vec3 BRDF_lambertian(vec3 diffuseColor)
+{
+    return (diffuseColor / PI);
+}
+
+vec3 F_Schlick(vec3 f0, vec3 f90, float VdotH)
+{
+    return f0 + (f90 - f0) * pow(clamp(1.0 - VdotH, 0.0, 1.0), 5.0);
+}
+
+float V_GGX(float NdotL, float NdotV, float alphaRoughness)
+{
+    float alphaRoughnessSq = alphaRoughness * alphaRoughness;
+
+    float GGXV = NdotL * sqrt(NdotV * NdotV * (1.0 - alphaRoughnessSq) + alphaRoughnessSq);
+    float GGXL = NdotV * sqrt(NdotL * NdotL * (1.0 - alphaRoughnessSq) + alphaRoughnessSq);
+
+    float GGX = GGXV + GGXL;
+    if (GGX > 0.0)
+    {
+        return 0.5 / GGX;
+    }
+    return 0.0;
+}
+
+float D_GGX(float NdotH, float alphaRoughness)
+{
+    float alphaRoughnessSq = alphaRoughness * alphaRoughness;
+    float f = (NdotH * NdotH) * (alphaRoughnessSq - 1.0) + 1.0;
+    return alphaRoughnessSq / (PI * f * f);
+}
+
+vec3 BRDF_specularGGX(float alphaRoughness, float NdotL, float NdotV, float NdotH)
+{
+    float Vis = V_GGX(NdotL, NdotV, alphaRoughness);
+    float D = D_GGX(NdotH, alphaRoughness);
+
+    return vec3(Vis * D);
+}
+
+const uint MAX_LIGHTS_PER_CLUSTER = 128; // ClusterUniform::kMaxLightsPerCluster
+
+uint clusterIndex(vec2 fragCoord, float viewDepth)
+{
+    uvec3 grid = cluster.gridSize.xyz;
+    float slice = log(viewDepth) * cluster.zParams.z - cluster.zParams.w;
+    uint z = uint(clamp(slice, 0.0, float(grid.z - 1)));
+    uvec2 tile = min(uvec2(fragCoord / cluster.tileSize.xy), grid.xy - 1);
+    return tile.x + grid.x * (tile.y + grid.y * z);
+}
+
+// Windowed inverse square falloff (Karis 2013, "Real Shading in Unreal Engine 4")
+float rangeAttenuation(float lightDistance, float range)
+{
+    float r = lightDistance / range;
+    float window = clamp(1.0 - r * r * r * r, 0.0, 1.0);
+    return window * window / max(lightDistance * lightDistance, 1e-4);
+}
+
+// Same BRDF as the directional light
+vec3 punctualLight(vec3 l, vec3 radiance, vec3 N, vec3 V, vec3 baseColor, float roughness,
+                   float metallic, float specularWeight)
+{
+    vec3 h = normalize(l + V);
+    float NdotL = clampedDot(N, l);
+    float NdotV = clampedDot(N, V);
+    float NdotH = clampedDot(N, h);
+    float VdotH = clampedDot(V, h);
+
+    vec3 dielectric_fresnel = F_Schlick(vec3(0.04) * specularWeight, vec3(1.0), abs(VdotH));
+    vec3 metal_fresnel = F_Schlick(baseColor, vec3(1.0), abs(VdotH));
+
+    vec3 l_diffuse = radiance * NdotL * BRDF_lambertian(baseColor);
+    float alphaRoughness = roughness * roughness;
+    vec3 l_specular = radiance * NdotL * BRDF_specularGGX(alphaRoughness, NdotL, NdotV, NdotH);
+
+    vec3 dielectric_brdf = mix(l_diffuse, l_specular, dielectric_fresnel);
+    return mix(dielectric_brdf, metal_fresnel * l_specular, metallic);
+}
+
+vec3 clusteredLights(vec3 worldPos, vec3 N, vec3 V, vec3 baseColor, float roughness,
+                     float metallic, float specularWeight)
+{
+    vec3 result = vec3(0.0);
+    if (cluster.gridSize.w == 0) {
+        return result;
+    }
+
+    float viewDepth = -(cluster.view * vec4(worldPos, 1.0)).z;
+    uint index = clusterIndex(gl_FragCoord.xy, viewDepth);
+    uint count = lightCounts[index];
+
+    for (uint i = 0; i < count; ++i) {
+        LocalLight light = lights[lightIndices[index * MAX_LIGHTS_PER_CLUSTER + i]];
+
+        vec3 toLight = light.position - worldPos;
+        float lightDistance = length(toLight);
+        if (lightDistance >= light.range) {
+            continue;
+        }
+        vec3 l = toLight / lightDistance;
+
+        float attenuation = rangeAttenuation(lightDistance, light.range);
+        if (light.spotCosOuter > -1.0) {
+            float cd = dot(normalize(light.direction), -l);
+            attenuation *= smoothstep(light.spotCosOuter, light.spotCosInner, cd);
+        }
+
+        result += punctualLight(l, light.color * attenuation, N, V, baseColor, roughness, metallic,
+                                specularWeight);
+    }
+
+    return result;
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth >= 1.0) {
+        discard; // Background, the sky pass fills it
+    }
+
+    vec3 baseColor = texelFetch(gAlbedo, pixel, 0).rgb;
+    vec3 N = decodeOctahedral(texelFetch(gNormal, pixel, 0).xy);
+    vec4 packedMaterial = texelFetch(gMaterial, pixel, 0);
+    vec3 emissive = texelFetch(gEmissive, pixel, 0).rgb;
+
+    float ao = packedMaterial.r;
+    float roughness = packedMaterial.g;
+    float metallic = packedMaterial.b;
+    int modelIndex = int(packedMaterial.a * 255.0 + 0.5);
+
+    float specularWeight = modelCoeffs.coeffs[modelIndex].x;
+    float diffuseWeight = modelCoeffs.coeffs[modelIndex].y;
+    float shadowOffset = modelCoeffs.coeffs[modelIndex].z;
+
+    // World position from depth (Vulkan NDC: xy in [-1, 1] with y down, z in [0, 1])
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(gDepth, 0));
+    vec4 worldPos = sceneData.inverseViewProjection * vec4(uv * 2.0 - 1.0, depth, 1.0);
+    worldPos /= worldPos.w;
+
+    vec3 V = normalize(sceneData.cameraPos - worldPos.xyz);
+
+    vec3 f_diffuse = texture(irradianceMap, N).rgb * baseColor * diffuseWeight;
+
+    vec3 f_specular_metal = getIBLRadianceGGX(N, V, roughness);
+    vec3 f_specular_dielectric = f_specular_metal;
+
+    vec3 f_metal_fresnel_ibl = getIBLGGXFresnel(N, V, roughness, baseColor.rgb, 1.0);
+    vec3 f_metal_brdf_ibl = f_metal_fresnel_ibl * f_specular_metal;
+
+    vec3 f0_dielectric = vec3(0.04);
+    vec3 f90_dielectric = vec3(1.0);
+
+    vec3 f_dielectric_fresnel_ibl = getIBLGGXFresnel(N, V, roughness, f0_dielectric, specularWeight);
+    vec3 f_dielectric_brdf_ibl = mix(f_diffuse, f_specular_dielectric,  f_dielectric_fresnel_ibl);
+
+    float shadowFactor = 1.0;
+
+    if(options.shadowOn != 0) {
+        shadowFactor = clamp(calculateShadow(worldPos.xyz) + shadowOffset, 0.0, 1.0);
+    }
+
+    // Directional light
+    vec3 l_light = vec3(0.0);
+    {
+        vec3 l = normalize(sceneData.directionalLightDir);
+        vec3 h = normalize(l + V);
+        float NdotL = clampedDot(N, l);
+        float NdotV = clampedDot(N, V);
+        float NdotH = clampedDot(N, h);
+        float VdotH = clampedDot(V, h);
+
+        vec3 dielectric_fresnel = F_Schlick(f0_dielectric * specularWeight, f90_dielectric, abs(VdotH));
+        vec3 metal_fresnel = F_Schlick(baseColor.rgb, vec3(1.0), abs(VdotH));
+        vec3 lightIntensity = vec3(1.0, 0.9, 0.7) * sceneData.directionalLightColor;
+        vec3 l_diffuse = lightIntensity * NdotL * BRDF_lambertian(baseColor.rgb);
+
+        vec3 l_specular_metal = lightIntensity * NdotL * BRDF_specularGGX(roughness*roughness, NdotL, NdotV, NdotH);
+        vec3 l_specular_dielectric = l_specular_metal;
+
+        vec3 l_metal_brdf = metal_fresnel * l_specular_metal;
+        vec3 l_dielectric_brdf = mix(l_diffuse, l_specular_dielectric, dielectric_fresnel);
+
+        l_light = mix(l_dielectric_brdf, l_metal_brdf, metallic) * shadowFactor;
+    }
+
+    // Point and spot lights of this pixel's cluster
+    l_light += clusteredLights(worldPos.xyz, N, V, baseColor, roughness, metallic, specularWeight);
+
+    // Screen-space AO only attenuates the image-based (ambient) term
+    float ssao = options.ssaoOn != 0 ? imageLoad(ssaoImage, pixel).r : 1.0;
+
+    vec3 color = mix(f_dielectric_brdf_ibl, f_metal_brdf_ibl, metallic) * ssao + l_light;
+
+    float u_OcclusionStrength = 1.0;
+    color = color * (1.0 + u_OcclusionStrength * (ao - 1.0));
+
+    color += emissive;
+
+    outColor = vec4(color, 1.0);
+}
@@ -0,0 +1,62 @@
+#version 450
+
+// Depth-only pass of the forward path. Only static (non-skinned) meshes are drawn here, and
+// the position math must stay identical to pbrForward.vert for the EQUAL depth test.
+
+// Vertex input attributes matching the updated Vertex class layout
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;     // normal (not used)
+layout(location = 2) in vec2 inTexCoord;   // texCoord (not used)
+layout(location = 3) in vec3 inTangent;    // tangent (not used)
+layout(location = 4) in vec3 inBitangent;  // bitangent (not used)
+layout(location = 5) in vec4 inBoneWeights;   // Bone weights (not used)
+layout(location = 6) in ivec4 inBoneIndices;  // Bone indices (not used)
+
+layout(set = 0, binding = 0) uniform SceneDataUBO {
+    mat4 projection;
+    mat4 view;
+    vec3 cameraPos;
+    float padding1;
+    vec3 directionalLightDir;
+    float padding2;
+    vec3 directionalLightColor;
+    float padding3;
+    mat4 lightSpaceMatrix;
+    mat4 inverseViewProjection;
+    mat4 cascadeMatrices[4]; // Light view-projection per shadow cascade
+    vec4 cascadeSplits;      // Far view distance of each cascade
+} sceneData;
+
+// Options and bone data are unused but declared so that set 0 keeps the layout of pbrForward
+layout(set = 0, binding = 1) uniform OptionsUBO {
+    bool textureOn;
+    bool shadowOn;
+    bool discardOn;
+    bool animationOn;
+    float ssaoRadius;
+    float ssaoBias;
+    int ssaoSampleCount;
+    float ssaoPower;
+} options;
+
+layout(set = 0, binding = 2) uniform BoneDataUBO {
+    mat4 boneMatrices[256];  // Support up to 256 bones (16,384 bytes)
+    vec4 animationData;      // x = hasAnimation (0.0/1.0), y,z,w = future use
+} boneData;
+
+// Per-instance data written by Renderer every frame (InstanceData in Renderer.h)
+struct Instance {
+    mat4 model;
+    uvec4 params; // x: model index
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer InstanceBuffer {
+    Instance instances[];
+};
+
+invariant gl_Position;
+
+void main() {
+    vec4 worldPos = instances[gl_InstanceIndex].model * vec4(inPosition, 1.0);
+    gl_Position = sceneData.projection * sceneData.view * worldPos;
+}
@@ -0,0 +1,123 @@
+#version 450
+
+// G-buffer pass of the deferred path. Shares pbrForward.vert and the descriptor sets of pbrForward.
+// Lighting is evaluated later in deferredLighting.frag.
+
+layout(location = 0) in vec3 fragPos;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec2 fragTexCoord;
+layout(location = 3) in vec3 fragTangent;
+layout(location = 4) in vec3 fragBitangent;
+layout(location = 5) in vec3 fragCameraPos;
+layout(location = 6) in vec4 fragPosLightSpace;
+layout(location = 7) flat in uint fragModelIndex; // Index into ModelCoeffsUBO of the lighting pass
+
+layout(push_constant) uniform PushConstants {
+    mat4 model; // Unused, transforms come from the instance buffer
+    float coeffs[16];
+} pushConstants;
+
+layout(set = 0, binding = 1) uniform OptionsUBO {
+    int textureOn;
+    int shadowOn;
+    int discardOn;
+    int animationOn;
+    float ssaoRadius;
+    float ssaoBias;
+    int ssaoSampleCount;
+    float ssaoPower;
+} options;
+
+// Material properties
+layout(set = 1, binding = 0) uniform MaterialUBO {
+    vec4 emissiveFactor;
+    vec4 baseColorFactor;
+    float roughnessFactor;
+    float transparencyFactor;
+    float discardAlpha;
+    float metallicFactor;
+    int baseColorTextureIndex;
+    int emissiveTextureIndex;
+    int normalTextureIndex;
+    int opacityTextureIndex;
+    int metallicRoughnessTextureIndex;
+    int occlusionTextureIndex;
+} material;
+
+// Material textures
+layout(set = 1, binding = 1) uniform sampler2D baseColorTexture;
+layout(set = 1, binding = 2) uniform sampler2D emissiveTexture;
+layout(set = 1, binding = 3) uniform sampler2D normalTexture;
+layout(set = 1, binding = 4) uniform sampler2D opacityTexture;
+layout(set = 1, binding = 5) uniform sampler2D metallicRoughnessTexture;
+layout(set = 1, binding = 6) uniform sampler2D occlusionTexture;
+
+layout(location = 0) out vec4 outAlbedo;   // R8G8B8A8_SRGB
+layout(location = 1) out vec2 outNormal;   // R16G16_SFLOAT, octahedral
+layout(location = 2) out vec4 outMaterial; // R8G8B8A8_UNORM: ao, roughness, metallic, model index
+layout(location = 3) out vec4 outEmissive; // B10G11R11_UFLOAT
+
+vec2 octWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Unit vector -> [-1, 1]^2 (see "A Survey of Efficient Representations for Independent Unit Vectors")
+vec2 encodeOctahedral(vec3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    n.xy = n.z >= 0.0 ? n.xy : octWrap(n.xy);
+    return n.xy;
+}
+
+void main() {
+    float emissiveWeight = pushConstants.coeffs[2];
+
+    vec4 baseColorRGBA = (options.textureOn != 0 && material.baseColorTextureIndex >= 0) ? texture(baseColorTexture, fragTexCoord) : vec4(1.0);
+
+    // Only the ALPHA_TEST variant (pbrDeferredAlphaTest.frag.spv) may discard
+#ifdef ALPHA_TEST
+    if(material.opacityTextureIndex >= 0) {
+        float opacity = texture(opacityTexture, fragTexCoord).r;
+        if(options.discardOn != 0 && opacity < 0.08)
+            discard;
+    }
+#endif
+
+    vec3 baseColor = material.baseColorFactor.rgb * baseColorRGBA.rgb;
+    float metallic = material.metallicFactor * pushConstants.coeffs[4];
+    float roughness = material.roughnessFactor * pushConstants.coeffs[5];
+
+    if(material.metallicRoughnessTextureIndex >= 0){
+        vec3 metallicRoughness = texture(metallicRoughnessTexture, fragTexCoord).rgb;
+        metallic *= metallicRoughness.b; // Blue channel
+        roughness *= metallicRoughness.g; // Green channel
+    }
+
+    float ao = 1.0;
+    if(material.occlusionTextureIndex >= 0) {
+        ao = texture(occlusionTexture, fragTexCoord).r;
+    }
+
+    vec3 emissive = material.emissiveFactor.xyz * emissiveWeight;
+    if(material.emissiveTextureIndex >= 0)
+    {
+        emissive *= texture(emissiveTexture, fragTexCoord).xyz;
+    }
+
+    vec3 N = normalize(fragNormal);
+    vec3 T = normalize(fragTangent);
+    vec3 B = normalize(fragBitangent);
+    mat3 TBN = mat3(T, B, N);
+    if(material.normalTextureIndex >= 0) {
+        vec3 tangentNormal = texture(normalTexture, fragTexCoord).xyz * 2.0 - 1.0;
+        if (length(tangentNormal) > 0.5)
+            N = normalize(TBN * tangentNormal);
+    }
+
+    outAlbedo = vec4(baseColor, 1.0);
+    outNormal = encodeOctahedral(N);
+    outMaterial = vec4(ao, clamp(roughness, 0.0, 1.0), clamp(metallic, 0.0, 1.0),
+                       float(fragModelIndex) / 255.0);
+    outEmissive = vec4(emissive, 1.0);
+}
@@ -9,7 +9,7 @@ layout(location = 5) in vec3 fragCameraPos;
 layout(location = 6) in vec4 fragPosLightSpace;
 
 layout(push_constant) uniform PushConstants {
-    mat4 model;
+    mat4 model; // Unused, transforms come from the instance buffer
     float coeffs[16];
 } pushConstants;
 
@@ -23,6 +23,9 @@ layout(set = 0, binding = 0) uniform SceneDataUBO {
     vec3 directionalLightColor;
     float padding3;
     mat4 lightSpaceMatrix;
+    mat4 inverseViewProjection;
+    mat4 cascadeMatrices[4]; // Light view-projection per shadow cascade
+    vec4 cascadeSplits;      // Far view distance of each cascade
 } sceneData;
 
 layout(set = 0, binding = 1) uniform OptionsUBO {
@@ -66,27 +69,66 @@ layout(set = 2, binding = 1) uniform samplerCube irradianceMap;
 layout(set = 2, binding = 2) uniform sampler2D brdfLUT;
 
 // Shadow map (주의: 각 셋의 바인딩은 0에서 시작해야 함)
-layout(set = 3, binding = 0) uniform sampler2DShadow shadowMap;
+layout(set = 3, binding = 0) uniform sampler2DArrayShadow shadowMap; // One layer per cascade
+
+// Clustered point/spot lights (built by clusterLights.comp)
+layout(set = 4, binding = 0) uniform ClusterUBO {
+    mat4 view;
+    mat4 inverseProjection;
+    uvec4 gridSize; // w: light count
+    vec4 zParams;   // x: near, y: far, z: slice scale, w: slice bias
+    vec4 tileSize;  // xy: cluster size in pixels, zw: render target size
+} cluster;
+
+struct LocalLight {
+    vec3 position;
+    float range;
+    vec3 color;
+    float spotCosOuter;
+    vec3 direction;
+    float spotCosInner;
+};
+
+layout(std430, set = 4, binding = 1) readonly buffer LightBuffer {
+    LocalLight lights[];
+};
+
+layout(std430, set = 4, binding = 2) readonly buffer ClusterLightCounts {
+    uint lightCounts[];
+};
+
+layout(std430, set = 4, binding = 3) readonly buffer ClusterLightIndices {
+    uint lightIndices[];
+};
 
 layout(location = 0) out vec4 outColor;
 
 const float PI = 3.14159265359;
 const float MAX_REFLECTION_LOD = 4.0;
 
-float calculateShadow(vec4 fragPosLightSpace)
+const int SHADOW_CASCADES = 4; // ShadowMap::kCascadeCount
+
+// Cascaded shadow lookup: the cascade is picked by view distance, fragments beyond the last
+// split are unshadowed
+float calculateShadow(vec3 worldPos)
 {
-    // Perform perspective divide
+    float viewDistance = -(sceneData.view * vec4(worldPos, 1.0)).z;
+    int cascade = 0;
+    while (cascade < SHADOW_CASCADES && viewDistance > sceneData.cascadeSplits[cascade]) {
+        cascade++;
+    }
+    if (cascade == SHADOW_CASCADES) {
+        return 1.0;
+    }
+
+    const mat4 scaleBias = mat4(
+        0.5, 0.0, 0.0, 0.0,
+        0.0, 0.5, 0.0, 0.0,
+        0.0, 0.0, 1.0, 0.0,
+        0.5, 0.5, 0.0, 1.0
+    );
+    vec4 fragPosLightSpace = scaleBias * sceneData.cascadeMatrices[cascade] * vec4(worldPos, 1.0);
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-    
-    // Transform to [0,1] range
-    //projCoords = projCoords * 0.5 + 0.5;
-    //projCoords.y = 1.0 - projCoords.y;
-    
-    // Check if fragment is outside shadow map bounds
-//    if (projCoords.z > 1.0 || projCoords.x < 0.0 || projCoords.x > 1.0 || 
-//        projCoords.y < 0.0 || projCoords.y > 1.0) {
-//        return 0.0; // Outside shadow map = no shadow
-//    }
 
     if(projCoords.z <= -1.0 || projCoords.z >= 1.0)
         return 1.0;
@@ -121,13 +163,13 @@ float calculateShadow(vec4 fragPosLightSpace)
 
     // PCF with Poisson disk sampling
     float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
     float filterRadius = 2.0; // Adjust for shadow softness
     
     for(int i = 0; i < 16; ++i)
     {
         vec2 offset = poissonDisk[i] * texelSize * filterRadius;
-        shadow += texture(shadowMap, vec3(projCoords.xy + offset, projCoords.z));
+        shadow += texture(shadowMap, vec4(projCoords.xy + offset, float(cascade), projCoords.z));
     }
     shadow /= 16.0;
 
@@ -249,6 +291,81 @@ vec3 BRDF_specularGGX(float alphaRoughness, float NdotL, float NdotV, float Ndot
     return vec3(Vis * D);
 }
 
+const uint MAX_LIGHTS_PER_CLUSTER = 128; // ClusterUniform::kMaxLightsPerCluster
+
+uint clusterIndex(vec2 fragCoord, float viewDepth)
+{
+    uvec3 grid = cluster.gridSize.xyz;
+    float slice = log(viewDepth) * cluster.zParams.z - cluster.zParams.w;
+    uint z = uint(clamp(slice, 0.0, float(grid.z - 1)));
+    uvec2 tile = min(uvec2(fragCoord / cluster.tileSize.xy), grid.xy - 1);
+    return tile.x + grid.x * (tile.y + grid.y * z);
+}
+
+// Windowed inverse square falloff (Karis 2013, "Real Shading in Unreal Engine 4")
+float rangeAttenuation(float lightDistance, float range)
+{
+    float r = lightDistance / range;
+    float window = clamp(1.0 - r * r * r * r, 0.0, 1.0);
+    return window * window / max(lightDistance * lightDistance, 1e-4);
+}
+
+// Same BRDF as the directional light
+vec3 punctualLight(vec3 l, vec3 radiance, vec3 N, vec3 V, vec3 baseColor, float roughness,
+                   float metallic, float specularWeight)
+{
+    vec3 h = normalize(l + V);
+    float NdotL = clampedDot(N, l);
+    float NdotV = clampedDot(N, V);
+    float NdotH = clampedDot(N, h);
+    float VdotH = clampedDot(V, h);
+
+    vec3 dielectric_fresnel = F_Schlick(vec3(0.04) * specularWeight, vec3(1.0), abs(VdotH));
+    vec3 metal_fresnel = F_Schlick(baseColor, vec3(1.0), abs(VdotH));
+
+    vec3 l_diffuse = radiance * NdotL * BRDF_lambertian(baseColor);
+    float alphaRoughness = roughness * roughness;
+    vec3 l_specular = radiance * NdotL * BRDF_specularGGX(alphaRoughness, NdotL, NdotV, NdotH);
+
+    vec3 dielectric_brdf = mix(l_diffuse, l_specular, dielectric_fresnel);
+    return mix(dielectric_brdf, metal_fresnel * l_specular, metallic);
+}
+
+vec3 clusteredLights(vec3 worldPos, vec3 N, vec3 V, vec3 baseColor, float roughness,
+                     float metallic, float specularWeight)
+{
+    vec3 result = vec3(0.0);
+    if (cluster.gridSize.w == 0) {
+        return result;
+    }
+
+    float viewDepth = -(cluster.view * vec4(worldPos, 1.0)).z;
+    uint index = clusterIndex(gl_FragCoord.xy, viewDepth);
+    uint count = lightCounts[index];
+
+    for (uint i = 0; i < count; ++i) {
+        LocalLight light = lights[lightIndices[index * MAX_LIGHTS_PER_CLUSTER + i]];
+
+        vec3 toLight = light.position - worldPos;
+        float lightDistance = length(toLight);
+        if (lightDistance >= light.range) {
+            continue;
+        }
+        vec3 l = toLight / lightDistance;
+
+        float attenuation = rangeAttenuation(lightDistance, light.range);
+        if (light.spotCosOuter > -1.0) {
+            float cd = dot(normalize(light.direction), -l);
+            attenuation *= smoothstep(light.spotCosOuter, light.spotCosInner, cd);
+        }
+
+        result += punctualLight(l, light.color * attenuation, N, V, baseColor, roughness, metallic,
+                                specularWeight);
+    }
+
+    return result;
+}
+
 void main() {
     float specularWeight = pushConstants.coeffs[0];
     float diffuseWeight = pushConstants.coeffs[1];
@@ -258,11 +375,17 @@ void main() {
     // Sample material properties
     vec4 baseColorRGBA = (options.textureOn != 0 && material.baseColorTextureIndex >= 0) ? texture(baseColorTexture, fragTexCoord) : vec4(1.0);
 
+    // Compiled three times (scripts/compile_shaders.py): the opaque variant has no discard so
+    // that early depth testing stays on, ALPHA_TEST cuts out, ALPHA_BLEND also outputs alpha
+    float alpha = 1.0;
+#if defined(ALPHA_TEST) || defined(ALPHA_BLEND)
     if(material.opacityTextureIndex >= 0) {
         float opacity = texture(opacityTexture, fragTexCoord).r;
         if(options.discardOn != 0 && opacity < 0.08)
             discard;
+        alpha = opacity;
     }
+#endif
 
     vec3 baseColor = material.baseColorFactor.rgb * baseColorRGBA.rgb;
     float metallic = material.metallicFactor * pushConstants.coeffs[4];
@@ -322,7 +445,7 @@ void main() {
     float shadowFactor = 1.0;
     
     if(options.shadowOn != 0) {
-        shadowFactor = calculateShadow(fragPosLightSpace) + shadowOffset;
+        shadowFactor = calculateShadow(fragPos) + shadowOffset;
         shadowFactor = clamp(shadowFactor, 0.0, 1.0);
     }
 
@@ -355,6 +478,9 @@ void main() {
         l_light = mix(l_dielectric_brdf, l_metal_brdf, metallic) * shadowFactor;
     }
 
+    // Point and spot lights of this fragment's cluster
+    l_light += clusteredLights(fragPos, N, V, baseColor.rgb, roughness, metallic, specularWeight);
+
     // Total color
     vec3 color = mix(f_dielectric_brdf_ibl, f_metal_brdf_ibl, metallic) + l_light;
     
@@ -363,5 +489,9 @@ void main() {
     
     color += emissive;
 
+#ifdef ALPHA_BLEND
+    outColor = vec4(color, alpha * material.transparencyFactor);
+#else
     outColor = vec4(color, 1.0);
+#endif
 }
\ No newline at end of file
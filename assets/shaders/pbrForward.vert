@@ -37,11 +37,18 @@ layout(set = 0, binding = 2) uniform BoneDataUBO {
     vec4 animationData;      // x = hasAnimation (0.0/1.0), y,z,w = future use
 } boneData;
 
-// Push constants for various coefficients
-layout(push_constant) uniform PushConstants {
+// Per-instance data written by Renderer every frame (InstanceData in Renderer.h)
+struct Instance {
     mat4 model;
-    float coeffs[16];
-} pushConstants;
+    uvec4 params; // x: model index
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer InstanceBuffer {
+    Instance instances[];
+};
+
+// Bit-identical to depthPrepass.vert for the EQUAL depth test after the pre-pass
+invariant gl_Position;
 
 // Output to fragment shader
 layout(location = 0) out vec3 fragPos;
@@ -51,6 +58,7 @@ layout(location = 3) out vec3 fragTangent;
 layout(location = 4) out vec3 fragBitangent;
 layout(location = 5) out vec3 fragCameraPos;
 layout(location = 6) out vec4 fragPosLightSpace;
+layout(location = 7) flat out uint fragModelIndex;
 
 void main() {
     vec3 position = inPosition;
@@ -110,7 +118,8 @@ void main() {
     }
 
     // Transform vertex position to world space
-    vec4 worldPos = pushConstants.model * vec4(position, 1.0);
+    mat4 model = instances[gl_InstanceIndex].model;
+    vec4 worldPos = model * vec4(position, 1.0);
     fragPos = worldPos.xyz;
     
     const mat4 scaleBias = mat4(
@@ -124,7 +133,7 @@ void main() {
     fragPosLightSpace = scaleBias * sceneData.lightSpaceMatrix * worldPos;
     
     // Transform normal, tangent, and bitangent to world space
-    mat3 normalMatrix = transpose(inverse(mat3(pushConstants.model)));
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
     fragNormal = normalMatrix * normal;
     fragTangent = normalMatrix * tangent;
     fragBitangent = normalMatrix * bitangent;
@@ -132,6 +141,7 @@ void main() {
     // Pass through texture coordinates and camera position
     fragTexCoord = inTexCoord;
     fragCameraPos = sceneData.cameraPos;
+    fragModelIndex = instances[gl_InstanceIndex].params.x;
     
     // Transform vertex to clip space
     gl_Position = sceneData.projection * sceneData.view * worldPos;
@@ -3,7 +3,54 @@
 // Fragment shader for shadow map generation
 // This shader is minimal since we only need depth values for shadow mapping
 // The depth values are automatically written to the depth buffer
+//
+// ALPHA_TEST (shadowMapAlphaTest.frag.spv) cuts out casters with an opacity texture. Only that
+// variant declares the material set (same bindings as pbrForward.frag so the layout is shared).
+
+#ifdef ALPHA_TEST
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(set = 0, binding = 1) uniform OptionsUBO {
+    int textureOn;
+    int shadowOn;
+    int discardOn;
+    int animationOn;
+    float ssaoRadius;
+    float ssaoBias;
+    int ssaoSampleCount;
+    float ssaoPower;
+} options;
+
+layout(set = 1, binding = 0) uniform MaterialUBO {
+    vec4 emissiveFactor;
+    vec4 baseColorFactor;
+    float roughnessFactor;
+    float transparencyFactor;
+    float discardAlpha;
+    float metallicFactor;
+    int baseColorTextureIndex;
+    int emissiveTextureIndex;
+    int normalTextureIndex;
+    int opacityTextureIndex;
+    int metallicRoughnessTextureIndex;
+    int occlusionTextureIndex;
+} material;
+
+layout(set = 1, binding = 1) uniform sampler2D baseColorTexture;
+layout(set = 1, binding = 2) uniform sampler2D emissiveTexture;
+layout(set = 1, binding = 3) uniform sampler2D normalTexture;
+layout(set = 1, binding = 4) uniform sampler2D opacityTexture;
+layout(set = 1, binding = 5) uniform sampler2D metallicRoughnessTexture;
+layout(set = 1, binding = 6) uniform sampler2D occlusionTexture;
+#endif
 
 void main() 
 {
-}
\ No newline at end of file
+#ifdef ALPHA_TEST
+    if(material.opacityTextureIndex >= 0) {
+        float opacity = texture(opacityTexture, fragTexCoord).r;
+        if(options.discardOn != 0 && opacity < 0.08)
+            discard;
+    }
+#endif
+}
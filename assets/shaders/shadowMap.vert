@@ -19,6 +19,9 @@ layout(set = 0, binding = 0) uniform SceneDataUBO {
     vec3 directionalLightColor;
     float padding3;
     mat4 lightSpaceMatrix;
+    mat4 inverseViewProjection;
+    mat4 cascadeMatrices[4]; // Light view-projection per shadow cascade
+    vec4 cascadeSplits;      // Far view distance of each cascade
 } sceneData;
 
 layout(set = 0, binding = 1) uniform OptionsUBO {
@@ -37,10 +40,20 @@ layout(set = 0, binding = 2) uniform BoneDataUBO {
     vec4 animationData;      // x = hasAnimation (0.0/1.0), y,z,w = future use
 } boneData;
 
-// Push constants for light space matrix
-layout(push_constant) uniform ShadowPushConstants {
+// Per-instance data written by Renderer every frame (InstanceData in Renderer.h)
+struct Instance {
     mat4 model;
-} pushConstants;
+    uvec4 params; // x: model index, y: shadow cascade
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer InstanceBuffer {
+    Instance instances[];
+};
+
+#ifdef ALPHA_TEST
+// shadowMapAlphaTest.vert.spv: texture coordinates for the opacity cut-out
+layout(location = 0) out vec2 fragTexCoord;
+#endif
 
 void main() {
     vec3 position = inPosition;
@@ -75,8 +88,12 @@ void main() {
     }
     
     // Transform vertex position from object space to world space
-    vec4 worldPos = pushConstants.model * vec4(position, 1.0);
+    vec4 worldPos = instances[gl_InstanceIndex].model * vec4(position, 1.0);
     
-    // Transform world position to light space (light's view-projection)
-    gl_Position = sceneData.lightSpaceMatrix * worldPos;
+    // Transform world position to the light space of the cascade being rendered
+    gl_Position = sceneData.cascadeMatrices[instances[gl_InstanceIndex].params.y] * worldPos;
+
+#ifdef ALPHA_TEST
+    fragTexCoord = inTexCoord;
+#endif
 }
\ No newline at end of file
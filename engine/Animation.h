@@ -153,6 +153,10 @@ class Animation
         isPlaying_ = false;
         currentTime_ = 0.0f;
     }
+    void setCurrentTime(float time)
+    {
+        currentTime_ = time;
+    }
 
     void setGlobalInverseTransform(const mat4& transform)
     {
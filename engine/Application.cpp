@@ -8,6 +8,7 @@
 #include <glm/gtx/matrix_decompose.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <chrono>
+#include <random>
 
 namespace hlab {
 
@@ -22,15 +23,16 @@ Application::Application(const ApplicationConfig& config)
       ctx_(window_.getRequiredExtensions(), true),
       swapchain_(ctx_, window_.createSurface(ctx_.instance()), windowSize_),
       shaderManager_(ctx_, kShaderPathPrefix,
-                     {{"shadowMap", {"shadowMap.vert.spv", "shadowMap.frag.spv"}},
-                      {"pbrForward", {"pbrForward.vert.spv", "pbrForward.frag.spv"}},
-                      {"sky", {"skybox.vert.spv", "skybox.frag.spv"}},
-                      {"ssao", {"ssao.comp.spv"}},
-                      {"post", {"post.vert.spv", "post.frag.spv"}},
-                      {"gui", {"imgui.vert", "imgui.frag"}}}),
+                     [] {
+                         auto shaders = Renderer::pipelineShaders();
+                         shaders.push_back({"gui", {"imgui.vert", "imgui.frag"}}); // GuiRenderer
+                         return shaders;
+                     }()),
       guiRenderer_(ctx_, shaderManager_, swapchain_.colorFormat()),
       renderer_(ctx_, shaderManager_, kMaxFramesInFlight, kAssetsPathPrefix, kShaderPathPrefix)
 {
+    Profiler::instance().setThreadName("main"); // Before any worker thread starts
+
     initializeVulkanResources();
     setupCallbacks();
     initializeWithConfig(config);
@@ -48,16 +50,16 @@ void Application::initializeVulkanResources()
     msaaSamples_ = ctx_.getMaxUsableSampleCount();
     commandBuffers_ = ctx_.createGraphicsCommandBuffers(kMaxFramesInFlight);
 
-    // Initialize fences
-    waitFences_.resize(kMaxFramesInFlight);
-    for (auto& fence : waitFences_) {
-        VkFenceCreateInfo fenceCreateInfo{};
-        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-        check(vkCreateFence(ctx_.device(), &fenceCreateInfo, nullptr, &fence));
-    }
+    // Frame timeline: value k once frame k is done (0: no frame submitted yet)
+    VkSemaphoreTypeCreateInfo timelineCI{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+    timelineCI.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineCI.initialValue = 0;
+    VkSemaphoreCreateInfo timelineSemaphoreCI{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    timelineSemaphoreCI.pNext = &timelineCI;
+    check(vkCreateSemaphore(ctx_.device(), &timelineSemaphoreCI, nullptr, &frameTimeline_));
+    slotValues_.assign(kMaxFramesInFlight, 0);
 
-    // Acquire semaphores: per frame-in-flight (fence guards reuse)
+    // Acquire semaphores: per frame slot (the frame timeline guards reuse)
     imageAcquiredSemaphores_.resize(kMaxFramesInFlight);
     for (size_t i = 0; i < kMaxFramesInFlight; i++) {
         VkSemaphoreCreateInfo semaphoreCI{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
@@ -76,36 +78,43 @@ void Application::initializeVulkanResources()
 
 void Application::initializeWithConfig(const ApplicationConfig& config)
 {
-    setupCamera(config.camera);
-    loadModels(config.models);
+    benchmarkConfig_ = config.benchmark;
+    profilerConfig_ = config.profiler;
+    if (profilerConfig_.captureAtStart) {
+        startTrace(); // Includes loading
+    }
+
+    cameraConfig_ = config.camera;
+    setupCamera(camera_, config.camera, float(windowSize_.width) / windowSize_.height);
+    loadModels(ctx_, kAssetsPathPrefix, config.models, models_);
 
     renderer_.prepareForModels(models_, swapchain_.colorFormat(), ctx_.depthFormat(), msaaSamples_,
                                windowSize_.width, windowSize_.height);
 }
 
-void Application::setupCamera(const CameraConfig& cameraConfig)
+void Application::setupCamera(Camera& camera, const CameraConfig& cameraConfig,
+                              float aspectRatio)
 {
-    const float aspectRatio = float(windowSize_.width) / windowSize_.height;
-
-    camera_.type = cameraConfig.type;
-    camera_.position = cameraConfig.position;
-    camera_.rotation = cameraConfig.rotation;
-    camera_.viewPos = cameraConfig.viewPos;
-    camera_.setMovementSpeed(cameraConfig.movementSpeed);
-    camera_.setRotationSpeed(cameraConfig.rotationSpeed);
-
-    camera_.updateViewMatrix();
-    camera_.setPerspective(cameraConfig.fov, aspectRatio, cameraConfig.nearPlane,
-                           cameraConfig.farPlane);
+    camera.type = cameraConfig.type;
+    camera.position = cameraConfig.position;
+    camera.rotation = cameraConfig.rotation;
+    camera.viewPos = cameraConfig.viewPos;
+    camera.setMovementSpeed(cameraConfig.movementSpeed);
+    camera.setRotationSpeed(cameraConfig.rotationSpeed);
+
+    camera.updateViewMatrix();
+    camera.setPerspective(cameraConfig.fov, aspectRatio, cameraConfig.nearPlane,
+                          cameraConfig.farPlane);
 }
 
-void Application::loadModels(const vector<ModelConfig>& modelConfigs)
+void Application::loadModels(Context& ctx, const string& assetsPathPrefix,
+                             const vector<ModelConfig>& modelConfigs, vector<Model>& models)
 {
     for (const auto& modelConfig : modelConfigs) {
-        models_.emplace_back(ctx_);
-        auto& model = models_.back();
+        models.emplace_back(ctx);
+        auto& model = models.back();
 
-        string fullPath = kAssetsPathPrefix + modelConfig.filePath;
+        string fullPath = assetsPathPrefix + modelConfig.filePath;
         model.loadFromModelFile(fullPath, modelConfig.isBistroObj);
         model.name() = modelConfig.displayName;
         model.modelMatrix() = modelConfig.transform;
@@ -157,6 +166,11 @@ void Application::setupCallbacks()
                     app->camera_.type = hlab::Camera::CameraType::lookat;
                 }
                 break;
+            case GLFW_KEY_F9:
+                if (app->traceFramesLeft_ == 0) {
+                    app->startTrace();
+                }
+                break;
             case GLFW_KEY_F3:
                 printLog("{} {} {}", glm::to_string(app->camera_.position),
                          glm::to_string(app->camera_.rotation),
@@ -327,9 +341,7 @@ Application::~Application()
         vkDestroySemaphore(ctx_.device(), sem, nullptr);
     }
 
-    for (auto& fence : waitFences_) {
-        vkDestroyFence(ctx_.device(), fence, nullptr);
-    }
+    vkDestroySemaphore(ctx_.device(), frameTimeline_, nullptr);
 
     // Destructors of members automatically cleanup everything.
 }
@@ -341,200 +353,227 @@ void Application::run()
     // 렌더러가 파이프라인을 사용할 때 어떤 리소스를 넣을지 결정한다.
 
     uint32_t frameCounter = 0;
-    uint32_t currentFrame = 0; // For CPU resources (command buffers, fences, acquire semaphores)
+    uint32_t currentFrame = 0; // Frame slot: command buffers, acquire semaphores, uniforms
 
     // NEW: Animation timing variables
     auto lastTime = std::chrono::high_resolution_clock::now();
     float deltaTime = 0.016f; // Default to ~60 FPS
 
+    // Configured benchmarks start with the first frame and end the run
+    const bool benchmarkRun = benchmarkConfig_.enabled;
+    if (benchmarkRun) {
+        startBenchmark(benchmarkConfig_);
+    }
+
     while (!window_.isCloseRequested()) {
-        window_.pollEvents();
+        {
+            HLAB_PROFILE_SCOPE("frame");
 
-        // NEW: Calculate delta time for smooth animation
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        deltaTime = std::chrono::duration<float>(currentTime - lastTime).count();
-        lastTime = currentTime;
+            if (benchmark_.isActive()) {
+                benchmark_.beginFrame();
+            }
 
-        // Clamp delta time to prevent large jumps (e.g., when debugging)
-        deltaTime = std::min(deltaTime, 0.033f); // Max 33ms (30 FPS minimum)
+            // CPU time of the parts of the frame, reported by the benchmark
+            auto phaseStart = std::chrono::steady_clock::now();
+            const auto endPhase = [&](const char* name) {
+                const auto now = std::chrono::steady_clock::now();
+                HLAB_PROFILE_ZONE(name, phaseStart, now);
+                benchmark_.addPhase(name, std::chrono::duration<float, std::milli>(now - phaseStart)
+                                              .count());
+                phaseStart = now;
+            };
+
+            float frameWaitMs = 0.0f;
+            if (requestedPresentMode_ != VK_PRESENT_MODE_MAX_ENUM_KHR) {
+                recreateSwapchain(requestedPresentMode_);
+                requestedPresentMode_ = VK_PRESENT_MODE_MAX_ENUM_KHR;
+            }
 
-        updateFPS(deltaTime);
+            // Input and animation are then sampled as late as possible before the frame is drawn
+            if (framePacing_ == FramePacing::LowLatency) {
+                frameWaitMs += waitForFrame(frameValue_);
+                phaseStart = std::chrono::steady_clock::now();
+            }
 
-        updateGui();
+            {
+                HLAB_PROFILE_SCOPE("poll");
+                window_.pollEvents();
+            }
 
-        camera_.update(deltaTime);
-        renderer_.sceneUBO().projection = camera_.matrices.perspective;
-        renderer_.sceneUBO().view = camera_.matrices.view;
-        renderer_.sceneUBO().cameraPos = glm::vec3(glm::inverse(camera_.matrices.view)[3]);
+            // NEW: Calculate delta time for smooth animation
+            auto currentTime = std::chrono::high_resolution_clock::now();
+            deltaTime = std::chrono::duration<float>(currentTime - lastTime).count();
+            lastTime = currentTime;
 
-        for (auto& model : models_) {
-            if (model.hasAnimations()) {
-                model.updateAnimation(deltaTime);
-            }
-        }
+            // Clamp delta time to prevent large jumps (e.g., when debugging)
+            deltaTime = std::min(deltaTime, 0.033f); // Max 33ms (30 FPS minimum)
 
-        // Update for shadow mapping
-        {
-            if (models_.size() > 0) {
-
-                glm::mat4 lightView =
-                    glm::lookAt(vec3(0.0f), -renderer_.sceneUBO().directionalLightDir,
-                                glm::vec3(0.0f, 0.0f, 1.0f));
-
-                // Transform the first model's bounding box to find the initial light bounding box
-                vec3 firstMin =
-                    vec3(models_[0].modelMatrix() * vec4(models_[0].boundingBoxMin(), 1.0f));
-                vec3 firstMax =
-                    vec3(models_[0].modelMatrix() * vec4(models_[0].boundingBoxMax(), 1.0f));
-
-                // Ensure min is actually smaller than max for each component
-                vec3 min_ = glm::min(firstMin, firstMax);
-                vec3 max_ = glm::max(firstMin, firstMax);
-
-                // Iterate through all models to find the combined bounding box
-                for (uint32_t i = 1; i < models_.size(); i++) {
-                    // Transform this model's bounding box to world space
-                    vec3 modelMin =
-                        vec3(models_[i].modelMatrix() * vec4(models_[i].boundingBoxMin(), 1.0f));
-                    vec3 modelMax =
-                        vec3(models_[i].modelMatrix() * vec4(models_[i].boundingBoxMax(), 1.0f));
-
-                    // Ensure proper min/max ordering
-                    vec3 transformedMin = glm::min(modelMin, modelMax);
-                    vec3 transformedMax = glm::max(modelMin, modelMax);
-
-                    // Expand the overall bounding box
-                    min_ = glm::min(min_, transformedMin);
-                    max_ = glm::max(max_, transformedMax);
-                }
+            updateFPS(deltaTime);
 
-                vec3 corners[] = {
-                    vec3(min_.x, min_.y, min_.z), vec3(min_.x, max_.y, min_.z),
-                    vec3(min_.x, min_.y, max_.z), vec3(min_.x, max_.y, max_.z),
-                    vec3(max_.x, min_.y, min_.z), vec3(max_.x, max_.y, min_.z),
-                    vec3(max_.x, min_.y, max_.z), vec3(max_.x, max_.y, max_.z),
-                };
-                vec3 vmin(std::numeric_limits<float>::max());
-                vec3 vmax(std::numeric_limits<float>::lowest());
-                for (size_t i = 0; i != 8; i++) {
-                    auto temp = vec3(lightView * vec4(corners[i], 1.0f));
-                    vmin = glm::min(vmin, temp);
-                    vmax = glm::max(vmax, temp);
-                }
-                min_ = vmin;
-                max_ = vmax;
-                glm::mat4 lightProjection = glm::orthoLH_ZO(min_.x, max_.x, min_.y, max_.y, max_.z,
-                                                            min_.z); // 마지막 Max, Min 순서 주의
-                renderer_.sceneUBO().lightSpaceMatrix = lightProjection * lightView;
-
-                // Modifed "Vulkan 3D Graphics Rendering Cookbook - 2nd Edition Build Status"
-                // https://github.com/PacktPublishing/3D-Graphics-Rendering-Cookbook-Second-Edition
+            // Fixed step and scripted camera, so that every benchmark run renders the same frames
+            if (benchmark_.isActive()) {
+                deltaTime = benchmark_.deltaTime();
             }
-        }
 
-        // Wait using currentFrame index (CPU-side fence)
-        check(vkWaitForFences(ctx_.device(), 1, &waitFences_[currentFrame], VK_TRUE, UINT64_MAX));
-        check(vkResetFences(ctx_.device(), 1, &waitFences_[currentFrame]));
-
-        renderer_.update(camera_, currentFrame, (float)glfwGetTime() * 0.5f);
-        renderer_.updateBoneData(models_, currentFrame);
-        
-        // NEW: Update view frustum and perform culling
-        glm::mat4 viewProjection = camera_.matrices.perspective * camera_.matrices.view;
-        renderer_.updateViewFrustum(viewProjection);
-        
-        // Update world bounds for all meshes before performing culling
-        for (auto& model : models_) {
-            const glm::mat4& modelMatrix = model.modelMatrix();
-            for (auto& mesh : model.meshes()) {
-                mesh.updateWorldBounds(modelMatrix);
+            updateGui();
+
+            camera_.update(deltaTime);
+            if (benchmark_.isActive() && !benchmark_.cameraPath().empty()) {
+                const CameraKeyframe pose = benchmark_.cameraPath().sample(benchmark_.time());
+                camera_.position = pose.position;
+                camera_.setRotation(pose.rotation);
             }
-        }
-        
-        // Perform frustum culling on all models
-        renderer_.performFrustumCulling(models_);
-        
-        guiRenderer_.update();
-
-        // Acquire using currentFrame index (fence guards semaphore reuse)
-        uint32_t imageIndex{0};
-        VkResult result = vkAcquireNextImageKHR(ctx_.device(), swapchain_.handle(), UINT64_MAX,
-                                                imageAcquiredSemaphores_[currentFrame],
-                                                VK_NULL_HANDLE, &imageIndex);
-        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-            continue; // Ignore resize in this example
-        } else if ((result != VK_SUCCESS) && (result != VK_SUBOPTIMAL_KHR)) {
-            exitWithMessage("Could not acquire the next swap chain image!");
-        }
+            if (recordingCameraPath_) {
+                recordCameraKeyframe(deltaTime);
+            }
+            renderer_.setCamera(camera_);
 
-        // Use currentFrame index (CPU-side command buffer)
-        CommandBuffer& cmd = commandBuffers_[currentFrame];
+            {
+                HLAB_PROFILE_SCOPE("animation");
+                for (auto& model : models_) {
+                    if (model.hasAnimations()) {
+                        model.updateAnimation(deltaTime);
+                    }
+                }
+            }
 
-        // Begin command buffer
-        vkResetCommandBuffer(cmd.handle(), 0);
-        VkCommandBufferBeginInfo cmdBufferBeginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
-        check(vkBeginCommandBuffer(cmd.handle(), &cmdBufferBeginInfo));
+            // Update for shadow mapping
+            renderer_.fitShadowsToScene(models_);
+
+            // The slot must be free, and at most framesInFlight_ frames (with this one) queued
+            const uint64_t queuedLimit =
+                frameValue_ + 1 > framesInFlight_ ? frameValue_ + 1 - framesInFlight_ : 0;
+            endPhase("update");
+            frameWaitMs += waitForFrame(std::max(slotValues_[currentFrame], queuedLimit));
+            phaseStart = std::chrono::steady_clock::now();
+
+            const float time = benchmark_.isActive() ? benchmark_.time() : float(glfwGetTime());
+            renderer_.update(camera_, currentFrame, time * 0.5f);
+            renderer_.updateBoneData(models_, currentFrame);
+            endPhase("upload");
+
+            // View frustum, world bounds of all meshes, frustum and shadow culling
+            renderer_.cullScene(models_);
+            endPhase("culling");
+
+            // Needs the world bounds above; uploaded with the next renderer_.update()
+            if (localLightsDirty_) {
+                renderer_.generateLocalLights(models_, localLightCount_, localLightRange_,
+                                              localLightIntensity_);
+                localLightsDirty_ = false;
+            }
 
-        // Make Shadow map
-        {
-            renderer_.makeShadowMap(cmd.handle(), currentFrame, models_);
-        }
+            guiRenderer_.update();
+            endPhase("gui");
+
+            // Acquire using currentFrame index (the slot wait guards semaphore reuse). Blocks when
+            // no image is available, e.g. with FIFO when the presentation queue is full.
+            uint32_t imageIndex{0};
+            const auto acquireStart = std::chrono::steady_clock::now();
+            VkResult result = vkAcquireNextImageKHR(ctx_.device(), swapchain_.handle(), UINT64_MAX,
+                                                    imageAcquiredSemaphores_[currentFrame],
+                                                    VK_NULL_HANDLE, &imageIndex);
+            const auto acquireEnd = std::chrono::steady_clock::now();
+            acquireMs_ =
+                std::chrono::duration<float, std::milli>(acquireEnd - acquireStart).count();
+            if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+                continue; // Ignore resize in this example
+            } else if ((result != VK_SUCCESS) && (result != VK_SUBOPTIMAL_KHR)) {
+                exitWithMessage("Could not acquire the next swap chain image!");
+            }
+            endPhase("acquire");
 
-        {
-            // Transition swapchain image from undefined to color attachment layout
-            swapchain_.barrierHelper(imageIndex)
-                .transitionTo(cmd.handle(), VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-                              VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                              VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-            VkViewport viewport{0.0f, 0.0f, (float)windowSize_.width, (float)windowSize_.height,
-                                0.0f, 1.0f};
-            VkRect2D scissor{0, 0, windowSize_.width, windowSize_.height};
-
-            // Draw models
-            renderer_.draw(cmd.handle(), currentFrame, swapchain_.imageView(imageIndex), models_,
-                           viewport, scissor);
-
-            // Draw GUI (overwrite to swapchain image)
-            guiRenderer_.draw(cmd.handle(), swapchain_.imageView(imageIndex), viewport);
-
-            swapchain_.barrierHelper(imageIndex)
-                .transitionTo(cmd.handle(), VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-                              VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
-        }
-        check(vkEndCommandBuffer(cmd.handle())); // End command buffer
+            // Use currentFrame index (CPU-side command buffer)
+            CommandBuffer& cmd = commandBuffers_[currentFrame];
 
-        VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        // 비교: 마지막으로 실행되는 셰이더가 Compute라면 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+            // Begin command buffer
+            check(vkResetCommandBuffer(cmd.handle(), 0));
+            VkCommandBufferBeginInfo cmdBufferBeginInfo{
+                VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+            check(vkBeginCommandBuffer(cmd.handle(), &cmdBufferBeginInfo));
 
-        VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
-        submitInfo.pCommandBuffers = &cmd.handle();
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pWaitDstStageMask = &waitStageMask;
-        submitInfo.pWaitSemaphores = &imageAcquiredSemaphores_[currentFrame];
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = &renderDoneSemaphores_[imageIndex];
-        submitInfo.signalSemaphoreCount = 1;
-        check(vkQueueSubmit(cmd.queue(), 1, &submitInfo, waitFences_[currentFrame]));
+            renderer_.beginFrame(cmd.handle(), currentFrame);
 
-        VkPresentInfoKHR presentInfo{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
-        presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = &renderDoneSemaphores_[imageIndex];
-        presentInfo.swapchainCount = 1;
-        presentInfo.pSwapchains = &swapchain_.handle();
-        presentInfo.pImageIndices = &imageIndex;
-        check(vkQueuePresentKHR(ctx_.graphicsQueue(), &presentInfo));
+            // Make Shadow map
+            {
+                renderer_.makeShadowMap(cmd.handle(), currentFrame, models_);
+            }
 
-        currentFrame = (currentFrame + 1) % kMaxFramesInFlight;
+            // With async compute the renderer continues the frame in a command buffer of its own
+            VkCommandBuffer frameCmd = cmd.handle();
+            {
+                VkViewport viewport{0.0f, 0.0f, (float)windowSize_.width, (float)windowSize_.height,
+                                    0.0f, 1.0f};
+                VkRect2D scissor{0, 0, windowSize_.width, windowSize_.height};
+
+                // Draw models (also transitions the swapchain image to color attachment layout)
+                frameCmd = renderer_.draw(frameCmd, currentFrame, swapchain_.imageView(imageIndex),
+                                          swapchain_.barrierHelper(imageIndex), models_, viewport,
+                                          scissor);
+
+                // Draw GUI (overwrite to swapchain image)
+                guiRenderer_.draw(frameCmd, swapchain_.imageView(imageIndex), viewport,
+                                  &renderer_.gpuTimer());
+
+                swapchain_.barrierHelper(imageIndex)
+                    .transitionTo(frameCmd, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                                  VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT);
+            }
+            check(vkEndCommandBuffer(frameCmd)); // End command buffer
+            endPhase("record");
+
+            // Waits for the acquired image at the color attachment output stage
+            frameValue_++;
+            slotValues_[currentFrame] = frameValue_;
+            renderer_.submitFrame(frameCmd, imageAcquiredSemaphores_[currentFrame],
+                                  renderDoneSemaphores_[imageIndex], frameTimeline_, frameValue_);
+            endPhase("submit");
+
+            VkPresentInfoKHR presentInfo{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
+            presentInfo.waitSemaphoreCount = 1;
+            presentInfo.pWaitSemaphores = &renderDoneSemaphores_[imageIndex];
+            presentInfo.swapchainCount = 1;
+            presentInfo.pSwapchains = &swapchain_.handle();
+            presentInfo.pImageIndices = &imageIndex;
+            check(vkQueuePresentKHR(ctx_.graphicsQueue(), &presentInfo));
+            endPhase("present");
+
+            currentFrame = (currentFrame + 1) % framesInFlight_;
+            frameWaitMs_ = frameWaitMs;
+
+            frameCounter++;
+
+            if (benchmark_.isActive()) {
+                benchmark_.addPhase("wait", frameWaitMs);
+                renderer_.reportBenchmarkStats(benchmark_);
+                benchmark_.endFrame();
+                if (benchmark_.isFinished()) {
+                    finishBenchmark();
+                    if (benchmarkRun) {
+                        break;
+                    }
+                }
+            }
+        }
 
-        frameCounter++;
+        // After the "frame" zone above has been recorded, so the trace ends with a whole frame
+        if (traceFramesLeft_ > 0 && --traceFramesLeft_ == 0) {
+            finishTrace();
+        }
     }
 
     ctx_.waitIdle(); // 종료하기 전 GPU 사용이 모두 끝날때까지 대기
+
+    if (traceFramesLeft_ > 0) {
+        traceFramesLeft_ = 0;
+        finishTrace(); // Closed before captureFrames frames
+    }
 }
 
 void Application::updateGui()
 {
+    HLAB_PROFILE_SCOPE("updateGui");
+
     static float scale = 1.4f;
 
     ImGuiIO& io = ImGui::GetIO();
@@ -567,6 +606,52 @@ void Application::updateGui()
     if (ImGui::IsItemHovered()) {
         ImGui::SetTooltip("Performance Indicator\nGreen: >60 FPS\nYellow: 30-60 FPS\nRed: <30 FPS");
     }
+
+    // Frame pacing
+    const char* pacingNames[] = {"Throughput", "Low Latency"};
+    int pacing = static_cast<int>(framePacing_);
+    if (ImGui::Combo("Frame Pacing", &pacing, pacingNames, IM_ARRAYSIZE(pacingNames))) {
+        framePacing_ = static_cast<FramePacing>(pacing);
+    }
+    int framesInFlight = static_cast<int>(framesInFlight_);
+    if (framePacing_ == FramePacing::Throughput &&
+        ImGui::SliderInt("Frames in Flight", &framesInFlight, 1, int(kMaxFramesInFlight))) {
+        framesInFlight_ = static_cast<uint32_t>(framesInFlight);
+    }
+    const VkPresentModeKHR presentModes[] = {VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+                                             VK_PRESENT_MODE_IMMEDIATE_KHR};
+    if (ImGui::BeginCombo("Present Mode", presentModeToString(swapchain_.presentMode()))) {
+        for (VkPresentModeKHR mode : presentModes) {
+            if (!swapchain_.supportsPresentMode(mode)) {
+                continue;
+            }
+            if (ImGui::Selectable(presentModeToString(mode), mode == swapchain_.presentMode())) {
+                requestedPresentMode_ = mode;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::Text("CPU wait: %.2f ms (GPU %.2f, acquire %.2f)", frameWaitMs_ + acquireMs_,
+                frameWaitMs_, acquireMs_);
+    if (traceFramesLeft_ > 0) {
+        ImGui::Text("Capturing CPU trace: %u frames left", traceFramesLeft_);
+    } else if (ImGui::Button("Capture CPU Trace (F9)")) {
+        startTrace();
+    }
+
+    // Rolling GPU time of every timed pass, read back without stalls a few frames later
+    if (renderer_.gpuTimer().isSupported() && ImGui::CollapsingHeader("GPU Profiler")) {
+        const GpuTimer& timer = renderer_.gpuTimer();
+        for (const string& name : timer.historyNames()) {
+            const GpuTimer::History* history = timer.history(name);
+            const float maxMs =
+                std::max(*std::max_element(history->values.begin(), history->values.end()), 0.1f);
+            const string overlay = std::format("{} {:.3f} ms", name, timer.elapsedMs(name));
+            ImGui::PlotLines(("##gpu" + name).c_str(), history->values.data(),
+                             int(history->values.size()), int(history->offset), overlay.c_str(),
+                             0.0f, maxMs * 1.2f, ImVec2(0.0f, 40.0f));
+        }
+    }
     ImGui::Separator();
 
     static vec3 lightColor = vec3(1.0f);
@@ -608,7 +693,89 @@ void Application::updateGui()
     bool textureOn = renderer_.optionsUBO().textureOn != 0;
     bool shadowOn = renderer_.optionsUBO().shadowOn != 0;
     bool discardOn = renderer_.optionsUBO().discardOn != 0;
+
+    int renderPath = static_cast<int>(renderer_.renderPath());
+    if (ImGui::Combo("Render Path", &renderPath, "Forward (MSAA)\0Deferred\0")) {
+        renderer_.setRenderPath(static_cast<RenderPath>(renderPath));
+    }
+    bool alternating = renderer_.isRenderPathAlternating();
+    if (ImGui::Checkbox("Alternate Paths (A/B timing)", &alternating)) {
+        renderer_.setRenderPathAlternating(alternating);
+    }
+    bool depthPrepass = renderer_.isDepthPrepassEnabled();
+    if (ImGui::Checkbox("Depth Pre-pass (forward)", &depthPrepass)) {
+        renderer_.setDepthPrepassEnabled(depthPrepass);
+    }
+    if (renderer_.gpuTimer().isSupported()) {
+        const GpuTimer& timer = renderer_.gpuTimer();
+        ImGui::Text("Forward: %.3f ms", timer.elapsedMs("forward"));
+        ImGui::Text("Forward with pre-pass: %.3f ms (pre-pass %.3f)",
+                    timer.elapsedMs("forwardPrepassed"), timer.elapsedMs("depthPrepass"));
+        ImGui::Text("Deferred: %.3f ms (G-buffer %.3f, lighting %.3f)", timer.elapsedMs("deferred"),
+                    timer.elapsedMs("gBuffer"), timer.elapsedMs("lighting"));
+    } else {
+        ImGui::Text("GPU timestamps not supported");
+    }
+
+    // SSAO runs as half resolution compute passes of the deferred path
+    bool ssaoOn = renderer_.optionsUBO().ssaoOn != 0;
+    if (ImGui::Checkbox("SSAO (deferred)", &ssaoOn)) {
+        renderer_.optionsUBO().ssaoOn = ssaoOn ? 1 : 0;
+    }
+    if (ssaoOn) {
+        ImGui::SliderFloat("SSAO Radius", &renderer_.optionsUBO().ssaoRadius, 0.05f, 2.0f, "%.2f");
+        ImGui::SliderFloat("SSAO Bias", &renderer_.optionsUBO().ssaoBias, 0.0f, 0.1f, "%.3f");
+        ImGui::SliderInt("SSAO Samples", &renderer_.optionsUBO().ssaoSampleCount, 1, 64);
+        ImGui::SliderFloat("SSAO Power", &renderer_.optionsUBO().ssaoPower, 0.5f, 4.0f, "%.2f");
+        float historyBlend = renderer_.ssaoHistoryBlend();
+        if (ImGui::SliderFloat("SSAO Temporal Blend", &historyBlend, 0.02f, 1.0f, "%.2f")) {
+            renderer_.setSsaoHistoryBlend(historyBlend);
+        }
+        if (renderer_.isAsyncComputeAvailable()) {
+            bool asyncCompute = renderer_.isAsyncComputeEnabled();
+            if (ImGui::Checkbox("SSAO on Compute Queue", &asyncCompute)) {
+                renderer_.setAsyncComputeEnabled(asyncCompute);
+            }
+        } else {
+            ImGui::TextDisabled("Async compute: no separate compute queue");
+        }
+        if (renderer_.gpuTimer().isSupported()) {
+            const GpuTimer& timer = renderer_.gpuTimer();
+            ImGui::Text("SSAO: %.3f ms", timer.elapsedMs("ssao"));
+            ImGui::Text("  downsample %.3f, ao %.3f, temporal %.3f, upsample %.3f",
+                        timer.elapsedMs("ssaoDownsample"), timer.elapsedMs("ssaoAo"),
+                        timer.elapsedMs("ssaoTemporal"), timer.elapsedMs("ssaoUpsample"));
+            if (renderer_.isAsyncComputeEnabled()) {
+                ImGui::Text("  overlapped with shadow pass: %.3f ms",
+                            timer.overlapMs("ssao", "shadow"));
+            }
+        }
+    }
     
+    // Clustered point/spot lights (both render paths)
+    ImGui::Separator();
+    ImGui::Text("Local Lights (clustered)");
+    localLightsDirty_ |= ImGui::SliderInt("Light Count", &localLightCount_, 0,
+                                          int(ClusterUniform::kMaxLights));
+    localLightsDirty_ |= ImGui::SliderFloat("Light Range", &localLightRange_, 0.5f, 20.0f, "%.1f");
+    localLightsDirty_ |=
+        ImGui::SliderFloat("Local Light Intensity", &localLightIntensity_, 0.0f, 200.0f, "%.1f");
+    {
+        const ClusterStats& clusterStats = renderer_.clusterStats();
+        if (renderer_.gpuTimer().isSupported()) {
+            ImGui::Text("Cluster build: %.3f ms", renderer_.gpuTimer().elapsedMs("clusterBuild"));
+        }
+        ImGui::Text("Lights per cluster: %.2f avg, %.2f avg non-empty, %u max",
+                    clusterStats.averageLightsPerCluster,
+                    clusterStats.averageLightsPerNonEmptyCluster,
+                    clusterStats.maxLightsPerCluster);
+        if (clusterStats.overflowedClusters > 0) {
+            ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Overflowed clusters: %u (max %u)",
+                               clusterStats.overflowedClusters,
+                               ClusterUniform::kMaxLightsPerCluster);
+        }
+    }
+
     // NEW: Frustum Culling Controls
     ImGui::Separator();
     ImGui::Text("View Frustum Culling");
@@ -628,6 +795,122 @@ void Application::updateGui()
         float cullPercent = (float)stats.culledMeshes / stats.totalMeshes * 100.0f;
         ImGui::Text("Culled: %.1f%%", cullPercent);
     }
+
+    // Shading workload per pass: what culling leaves to the vertex and fragment shaders
+    const PipelineStatistics& statistics = renderer_.pipelineStatistics();
+    if (!statistics.isSupported()) {
+        ImGui::Text("Pipeline statistics queries not supported");
+    } else if (!renderer_.isPipelineStatisticsAvailable()) {
+        ImGui::Text("Pipeline statistics need inheritedQueries (or no secondaries)");
+    } else {
+        bool pipelineStatistics = renderer_.isPipelineStatisticsEnabled();
+        if (ImGui::Checkbox("Pipeline Statistics", &pipelineStatistics)) {
+            renderer_.setPipelineStatisticsEnabled(pipelineStatistics);
+        }
+        if (pipelineStatistics) {
+            for (const auto& [name, passStats] : statistics.resolvedPasses()) {
+                ImGui::Text("%s: %llu prims (%llu after clip), %llu VS, %llu FS", name.c_str(),
+                            (unsigned long long)passStats.inputPrimitives,
+                            (unsigned long long)passStats.clippingPrimitives,
+                            (unsigned long long)passStats.vertexInvocations,
+                            (unsigned long long)passStats.fragmentInvocations);
+            }
+            // Fragments of the main pass per pixel (1 without overdraw)
+            const PipelineStats mainPass = statistics.stats(
+                renderer_.renderPath() == RenderPath::Deferred ? "gBuffer" : "forward");
+            const float pixels = float(windowSize_.width) * float(windowSize_.height);
+            if (pixels > 0.0f) {
+                ImGui::Text("Overdraw: %.2f fragments per pixel",
+                            float(mainPass.fragmentInvocations) / pixels);
+            }
+        }
+    }
+
+    float contributionThreshold = renderer_.contributionCullingThreshold();
+    if (ImGui::SliderFloat("Min Screen Area (pixels)", &contributionThreshold, 0.0f, 64.0f,
+                           "%.1f")) {
+        renderer_.setContributionCullingThreshold(contributionThreshold);
+    }
+    ImGui::Text("Too small: %u meshes", stats.contributionCulledMeshes);
+
+    bool softwareOcclusionEnabled = renderer_.isSoftwareOcclusionEnabled();
+    if (ImGui::Checkbox("Software Occlusion (CPU)", &softwareOcclusionEnabled)) {
+        renderer_.setSoftwareOcclusionEnabled(softwareOcclusionEnabled);
+    }
+    if (softwareOcclusionEnabled) {
+        ImGui::Text("Occluded: %u meshes, %u occluder triangles, %.3f ms",
+                    stats.softwareOccludedMeshes, stats.softwareOccluderTriangles,
+                    stats.softwareOcclusionMs);
+    }
+
+    // Two-phase Hi-Z occlusion culling of the main pass (replaces the depth pre-pass)
+    bool occlusionCullingEnabled = renderer_.isOcclusionCullingEnabled();
+    if (ImGui::Checkbox("Occlusion Culling (Hi-Z)", &occlusionCullingEnabled)) {
+        renderer_.setOcclusionCullingEnabled(occlusionCullingEnabled);
+    }
+    if (occlusionCullingEnabled) {
+        ImGui::Text("Occluded: %u meshes, %u draws", stats.occludedMeshes, stats.occludedDraws);
+        ImGui::Text("Newly visible (second pass): %u", stats.secondPassMeshes);
+        if (renderer_.gpuTimer().isSupported()) {
+            ImGui::Text("Depth pyramid + culling: %.3f ms",
+                        renderer_.gpuTimer().elapsedMs("occlusionCull"));
+        }
+    }
+
+    bool shadowCullingEnabled = renderer_.isShadowCullingEnabled();
+    if (ImGui::Checkbox("Light Frustum Culling", &shadowCullingEnabled)) {
+        renderer_.setShadowCullingEnabled(shadowCullingEnabled);
+    }
+    bool receiverCullingEnabled = renderer_.isReceiverShadowCullingEnabled();
+    if (ImGui::Checkbox("Receiver-Aware Caster Culling", &receiverCullingEnabled)) {
+        renderer_.setReceiverShadowCullingEnabled(receiverCullingEnabled);
+    }
+    ImGui::Text("Shadow casters: %u rendered, %u culled, %u draws", stats.shadowRenderedMeshes,
+                stats.shadowCulledMeshes, stats.shadowDraws);
+    bool staticShadowCaching = renderer_.isStaticShadowCachingEnabled();
+    if (ImGui::Checkbox("Cache Static Shadow Casters", &staticShadowCaching)) {
+        renderer_.setStaticShadowCachingEnabled(staticShadowCaching);
+    }
+    ImGui::Text("Static shadow cascades re-rendered: %u", stats.shadowStaticRedraws);
+    if (renderer_.gpuTimer().isSupported()) {
+        ImGui::Text("Shadow pass: %.3f ms", renderer_.gpuTimer().elapsedMs("shadow"));
+    }
+
+    // Commands recorded from the sorted render queue (all passes of the last frame)
+    const RenderQueueStats& queueStats = renderer_.renderQueueStats();
+    ImGui::Text("Draws: %u (%u meshes)", queueStats.draws, queueStats.instances);
+    ImGui::Text("Binds: pipeline %u, sets %u, push %u, vb %u, ib %u", queueStats.pipelineBinds,
+                queueStats.descriptorSetBinds, queueStats.pushConstantUpdates,
+                queueStats.vertexBufferBinds, queueStats.indexBufferBinds);
+    ImGui::Text("Redundant binds skipped: %u", queueStats.skippedBinds);
+
+    bool instancingOn = renderer_.isInstancingEnabled();
+    if (ImGui::Checkbox("Instancing", &instancingOn)) {
+        renderer_.setInstancingEnabled(instancingOn);
+    }
+
+    bool parallelRecordingOn = renderer_.isParallelRecordingEnabled();
+    if (ImGui::Checkbox("Parallel recording", &parallelRecordingOn)) {
+        renderer_.setParallelRecordingEnabled(parallelRecordingOn);
+    }
+    ImGui::Text("Recording: %.3f ms, %u threads, %u secondaries", queueStats.recordMs,
+                renderer_.recordingThreadCount(), queueStats.secondaryCommandBuffers);
+
+    bool commandCachingOn = renderer_.isCommandCachingEnabled();
+    if (ImGui::Checkbox("Cache pass commands", &commandCachingOn)) {
+        renderer_.setCommandCachingEnabled(commandCachingOn);
+    }
+    ImGui::Text("Passes: %u recorded, %u reused", queueStats.passesRecorded,
+                queueStats.passesReused);
+
+    // Barriers derived by the render graph and memory shared by its transient targets
+    const RenderGraph::Stats& graphStats = renderer_.renderGraphStats();
+    const float toMb = 1.0f / (1024.0f * 1024.0f);
+    ImGui::Text("Barrier calls: %u (render graph: %u barriers in %u)",
+                renderer_.barrierCallCount(), graphStats.barriers, graphStats.barrierBatches);
+    ImGui::Text("Transient targets: %.1f MB in %.1f MB (%.1f MB lazy)",
+                float(graphStats.transientBytes) * toMb, float(graphStats.allocatedBytes) * toMb,
+                float(graphStats.lazyBytes) * toMb);
     
     if (ImGui::Checkbox("Textures", &textureOn)) {
         renderer_.optionsUBO().textureOn = textureOn ? 1 : 0;
@@ -998,6 +1281,37 @@ void Application::renderCameraControlWindow()
         }
     }
 
+    // Camera path recording and benchmark playback
+    if (ImGui::CollapsingHeader("Camera Path & Benchmark")) {
+        if (!recordingCameraPath_) {
+            if (ImGui::Button("Record Path")) {
+                recordedCameraPath_.clear();
+                recordingTime_ = 0.0f;
+                recordingCameraPath_ = true;
+            }
+        } else if (ImGui::Button("Stop & Save")) {
+            recordingCameraPath_ = false;
+            if (!recordedCameraPath_.save(kCameraPathFile)) {
+                printLog("Could not save camera path to {}", kCameraPathFile);
+            }
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Load Path") && !recordingCameraPath_) {
+            recordedCameraPath_.load(kCameraPathFile);
+        }
+        ImGui::Text("Keyframes: %zu (%.1f s)", recordedCameraPath_.keyframes().size(),
+                    recordedCameraPath_.duration());
+
+        if (benchmark_.isActive()) {
+            ImGui::Text("Benchmark: frame %u / %u", benchmark_.frame(),
+                        benchmark_.config().warmupFrames + benchmark_.config().measuredFrames);
+        } else if (ImGui::Button("Run Benchmark") && !recordingCameraPath_) {
+            BenchmarkConfig config = benchmarkConfig_;
+            config.cameraKeyframes = recordedCameraPath_.keyframes();
+            startBenchmark(config);
+        }
+    }
+
     // Camera Presets
     if (ImGui::CollapsingHeader("Presets")) {
         if (ImGui::Button("Helmet View")) {
@@ -1066,6 +1380,96 @@ void Application::handleMouseMove(int32_t x, int32_t y)
     mouseState_.position = glm::vec2((float)x, (float)y);
 }
 
+auto Application::waitForFrame(uint64_t value) -> float
+{
+    HLAB_PROFILE_SCOPE("frameWait");
+    const auto start = std::chrono::steady_clock::now();
+
+    VkSemaphoreWaitInfo waitInfo{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &frameTimeline_;
+    waitInfo.pValues = &value;
+    check(vkWaitSemaphores(ctx_.device(), &waitInfo, UINT64_MAX));
+
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+void Application::recreateSwapchain(VkPresentModeKHR presentMode)
+{
+    ctx_.waitIdle();
+
+    VkExtent2D swapchainSize = windowSize_;
+    swapchain_.create(swapchainSize, presentMode);
+
+    // The image count may differ with the present mode
+    for (auto& sem : renderDoneSemaphores_) {
+        vkDestroySemaphore(ctx_.device(), sem, nullptr);
+    }
+    renderDoneSemaphores_.resize(swapchain_.images().size());
+    for (auto& sem : renderDoneSemaphores_) {
+        VkSemaphoreCreateInfo semaphoreCI{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        check(vkCreateSemaphore(ctx_.device(), &semaphoreCI, nullptr, &sem));
+    }
+}
+
+void Application::recordCameraKeyframe(float deltaTime)
+{
+    // Keyframe times follow the frame time, so the path plays back at the recorded speed
+    if (recordedCameraPath_.empty() ||
+        recordingTime_ - recordedCameraPath_.duration() >= kCameraKeyframeInterval) {
+        recordedCameraPath_.addKeyframe({recordingTime_, camera_.position, camera_.rotation});
+    }
+    recordingTime_ += deltaTime;
+}
+
+void Application::startTrace()
+{
+#if !defined(HLAB_PROFILER)
+    printLog("CPU trace is empty: the engine was built without HLAB_PROFILER");
+#endif
+    traceFramesLeft_ = std::max(profilerConfig_.captureFrames, 1u);
+    Profiler::instance().startCapture();
+}
+
+void Application::finishTrace()
+{
+    Profiler::instance().stopCapture();
+    Profiler::instance().writeChromeTrace(profilerConfig_.outputFile);
+}
+
+// Every run starts from the configured camera pose and the first animation frame, also when
+// started from the GUI after the camera was moved
+void Application::startBenchmark(const BenchmarkConfig& config)
+{
+    camera_.position = cameraConfig_.position;
+    camera_.rotation = cameraConfig_.rotation;
+    camera_.updateViewMatrix();
+    for (auto& model : models_) {
+        model.resetAnimationTime();
+    }
+
+    benchmark_.start(config);
+}
+
+void Application::finishBenchmark()
+{
+    const Context::MemoryUsage memory = ctx_.deviceMemoryUsage();
+    const RenderGraph::Stats& graphStats = renderer_.renderGraphStats();
+
+    benchmark_.setInfo("device", ctx_.deviceName());
+    benchmark_.setInfo("resolution", std::format("{}x{}", windowSize_.width, windowSize_.height));
+    benchmark_.setInfo("renderPath",
+                       renderer_.renderPath() == RenderPath::Forward ? "Forward" : "Deferred");
+    benchmark_.setInfo("msaaSamples", std::format("{}", int(msaaSamples_)));
+    benchmark_.setInfo("framesInFlight", std::format("{}", framesInFlight_));
+    benchmark_.setInfo("presentMode", presentModeToString(swapchain_.presentMode()));
+    benchmark_.setMemory("deviceLocalUsed", memory.usedBytes);
+    benchmark_.setMemory("deviceLocalBudget", memory.budgetBytes);
+    benchmark_.setMemory("transientTargets", graphStats.allocatedBytes);
+    benchmark_.writeJson(benchmark_.config().outputFile);
+}
+
 void Application::updateFPS(float deltaTime)
 {
     framesSinceLastUpdate_++;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Benchmark.h"
 #include "Camera.h"
 #include "Context.h"
 #include "Image2D.h"
@@ -8,6 +9,7 @@
 #include "MappedBuffer.h"
 #include "Model.h"
 #include "Pipeline.h"
+#include "Profiler.h"
 #include "Sampler.h"
 #include "StorageBuffer.h"
 #include "Swapchain.h"
@@ -139,6 +141,8 @@ struct ApplicationConfig
 {
     vector<ModelConfig> models;
     CameraConfig camera;
+    BenchmarkConfig benchmark; // When enabled, run() ends after the benchmark
+    ProfilerConfig profiler;
 
     // Default configuration (current hardcoded setup)
     static ApplicationConfig createDefault()
@@ -208,8 +212,13 @@ class Application
     void updateGui();
     void handleMouseMove(int32_t x, int32_t y);
 
+    // Scene setup shared with HeadlessApplication
+    static void setupCamera(Camera& camera, const CameraConfig& cameraConfig, float aspectRatio);
+    static void loadModels(Context& ctx, const string& assetsPathPrefix,
+                           const vector<ModelConfig>& modelConfigs, vector<Model>& models);
+
   private:
-    const uint32_t kMaxFramesInFlight = 2;
+    const uint32_t kMaxFramesInFlight = 3; // Frame slots, framesInFlight_ of them are used
     const string kAssetsPathPrefix = "../../assets/";
     const string kShaderPathPrefix = kAssetsPathPrefix + "shaders/";
 
@@ -225,7 +234,21 @@ class Application
 
     vector<CommandBuffer> commandBuffers_{};
 
-    vector<VkFence> waitFences_{};
+    // Frame pacing. Frame k sets frameTimeline_ to k when the GPU is done with it; a frame slot
+    // is reused once the frame that last used it is done.
+    //   Throughput: up to framesInFlight_ frames are queued ahead of the GPU
+    //   LowLatency: waits for the previous frame before reading input, one frame in flight
+    enum class FramePacing { Throughput, LowLatency };
+    FramePacing framePacing_{FramePacing::Throughput};
+    uint32_t framesInFlight_{2};
+    VkSemaphore frameTimeline_{VK_NULL_HANDLE};
+    uint64_t frameValue_{0};   // Of the last submitted frame
+    vector<uint64_t> slotValues_{}; // Frame that last used each slot
+    VkPresentModeKHR requestedPresentMode_{VK_PRESENT_MODE_MAX_ENUM_KHR}; // Pending change
+
+    // CPU time of the last frame spent waiting for the GPU and in vkAcquireNextImageKHR
+    float frameWaitMs_{0.0f};
+    float acquireMs_{0.0f};
 
     vector<VkSemaphore> imageAcquiredSemaphores_{};
     vector<VkSemaphore> renderDoneSemaphores_{};
@@ -243,14 +266,40 @@ class Application
     uint32_t framesSinceLastUpdate_{0};
     static constexpr float kFpsUpdateInterval = 0.1f; // 100ms
 
+    // Randomly placed point/spot lights for the clustered lighting
+    int localLightCount_{256};
+    float localLightRange_{4.0f};
+    float localLightIntensity_{20.0f};
+    bool localLightsDirty_{true};
+
+    // Scripted benchmark: from the config, or started in the camera window with the recorded
+    // camera path
+    BenchmarkConfig benchmarkConfig_;
+    Benchmark benchmark_;
+    CameraConfig cameraConfig_; // Start pose of every benchmark run
+    CameraPath recordedCameraPath_;
+    bool recordingCameraPath_{false};
+    float recordingTime_{0.0f};
+    const string kCameraPathFile = "camera_path.txt";
+    static constexpr float kCameraKeyframeInterval = 0.1f; // Seconds between recorded keyframes
+
+    // CPU trace of the next profilerConfig_.captureFrames frames, started with F9
+    ProfilerConfig profilerConfig_;
+    uint32_t traceFramesLeft_{0};
+
     // NEW: Configuration loading methods
     void initializeWithConfig(const ApplicationConfig& config);
-    void setupCamera(const CameraConfig& cameraConfig);
-    void loadModels(const vector<ModelConfig>& modelConfigs);
     void setupCallbacks();
     void initializeVulkanResources();
 
     void updateFPS(float deltaTime);
+    auto waitForFrame(uint64_t value) -> float; // Returns the milliseconds spent waiting
+    void recreateSwapchain(VkPresentModeKHR presentMode);
+    void recordCameraKeyframe(float deltaTime);
+    void startBenchmark(const BenchmarkConfig& config);
+    void finishBenchmark();
+    void startTrace();
+    void finishTrace();
 
     void renderHDRControlWindow();
     void renderPostProcessingControlWindow();
@@ -1,14 +1,29 @@
 #pragma once
 #include <vulkan/vulkan.h>
+#include <atomic>
 #include <vector>
 #include <functional>
 
 namespace hlab {
 
+// Number of vkCmdPipelineBarrier2 calls made through recordBarrier(), for the frame stats
+inline auto barrierCallCounter() -> std::atomic<uint32_t>&
+{
+    static std::atomic<uint32_t> count{0};
+    return count;
+}
+
+inline void recordBarrier(VkCommandBuffer cmd, const VkDependencyInfo& depInfo)
+{
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+    barrierCallCounter()++;
+}
+
 // Modern barrier helper following industry standards
 class BarrierHelper
 {
     friend class ResourceBinding;
+    friend class BarrierBatch;
 
   public:
     BarrierHelper()
@@ -138,7 +153,7 @@ class BarrierHelper
         depInfo.imageMemoryBarrierCount = 1;
         depInfo.pImageMemoryBarriers = &barrier;
 
-        vkCmdPipelineBarrier2(cmd, &depInfo);
+        recordBarrier(cmd, depInfo);
 
         // Update state only if transitioning the entire image
         if (baseMipLevel == 0 && actualLevelCount == mipLevels_ && baseArrayLayer == 0 &&
@@ -208,4 +223,86 @@ class BarrierHelper
     }
 };
 
+// Collects image, buffer and memory barriers and records them with one vkCmdPipelineBarrier2.
+// Like BarrierHelper::transitionTo, a transition to the current layout and access is left out.
+class BarrierBatch
+{
+  public:
+    void transition(BarrierHelper& image, VkAccessFlags2 newAccess, VkImageLayout newLayout,
+                    VkPipelineStageFlags2 newStage)
+    {
+        if (image.image_ == VK_NULL_HANDLE ||
+            (image.currentLayout_ == newLayout && image.currentAccess_ == newAccess)) {
+            return;
+        }
+        imageBarriers_.push_back(image.prepareBarrier(newLayout, newAccess, newStage));
+    }
+
+    // Image that is not tracked by a BarrierHelper (e.g. single layers)
+    void add(const VkImageMemoryBarrier2& barrier)
+    {
+        imageBarriers_.push_back(barrier);
+    }
+
+    void addBuffer(VkBuffer buffer, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+                   VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess,
+                   VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE)
+    {
+        VkBufferMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+        barrier.srcStageMask = srcStage;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstStageMask = dstStage;
+        barrier.dstAccessMask = dstAccess;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = buffer;
+        barrier.offset = offset;
+        barrier.size = size;
+        bufferBarriers_.push_back(barrier);
+    }
+
+    // Global memory dependencies are merged into a single VkMemoryBarrier2
+    void addMemory(VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+                   VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess)
+    {
+        memoryBarrier_.srcStageMask |= srcStage;
+        memoryBarrier_.srcAccessMask |= srcAccess;
+        memoryBarrier_.dstStageMask |= dstStage;
+        memoryBarrier_.dstAccessMask |= dstAccess;
+        hasMemoryBarrier_ = true;
+    }
+
+    auto empty() const -> bool
+    {
+        return imageBarriers_.empty() && bufferBarriers_.empty() && !hasMemoryBarrier_;
+    }
+
+    void flush(VkCommandBuffer cmd)
+    {
+        if (empty()) {
+            return;
+        }
+
+        VkDependencyInfo depInfo{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        depInfo.memoryBarrierCount = hasMemoryBarrier_ ? 1 : 0;
+        depInfo.pMemoryBarriers = &memoryBarrier_;
+        depInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers_.size());
+        depInfo.pBufferMemoryBarriers = bufferBarriers_.data();
+        depInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers_.size());
+        depInfo.pImageMemoryBarriers = imageBarriers_.data();
+        recordBarrier(cmd, depInfo);
+
+        imageBarriers_.clear();
+        bufferBarriers_.clear();
+        memoryBarrier_ = VkMemoryBarrier2{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+        hasMemoryBarrier_ = false;
+    }
+
+  private:
+    std::vector<VkImageMemoryBarrier2> imageBarriers_;
+    std::vector<VkBufferMemoryBarrier2> bufferBarriers_;
+    VkMemoryBarrier2 memoryBarrier_{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    bool hasMemoryBarrier_{false};
+};
+
 } // namespace hlab
\ No newline at end of file
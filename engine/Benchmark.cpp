@@ -0,0 +1,323 @@
+#include "Benchmark.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <numeric>
+
+namespace hlab {
+
+void CameraPath::addKeyframe(const CameraKeyframe& keyframe)
+{
+    if (!keyframes_.empty() && keyframe.time < keyframes_.back().time) {
+        exitWithMessage("Camera path keyframes must be ordered by time");
+    }
+    keyframes_.push_back(keyframe);
+}
+
+void CameraPath::clear()
+{
+    keyframes_.clear();
+}
+
+auto CameraPath::empty() const -> bool
+{
+    return keyframes_.empty();
+}
+
+auto CameraPath::duration() const -> float
+{
+    return keyframes_.empty() ? 0.0f : keyframes_.back().time;
+}
+
+auto CameraPath::keyframes() const -> const vector<CameraKeyframe>&
+{
+    return keyframes_;
+}
+
+auto CameraPath::sample(float time) const -> CameraKeyframe
+{
+    if (keyframes_.empty()) {
+        return CameraKeyframe{};
+    }
+    if (keyframes_.size() == 1 || duration() <= 0.0f) {
+        return keyframes_.front();
+    }
+
+    time = std::fmod(time, duration());
+
+    // First keyframe after time
+    auto next = std::upper_bound(
+        keyframes_.begin(), keyframes_.end(), time,
+        [](float t, const CameraKeyframe& keyframe) { return t < keyframe.time; });
+    if (next == keyframes_.begin()) {
+        return keyframes_.front();
+    }
+    if (next == keyframes_.end()) {
+        return keyframes_.back();
+    }
+    const CameraKeyframe& a = *(next - 1);
+    const CameraKeyframe& b = *next;
+
+    const float span = b.time - a.time;
+    const float t = span > 0.0f ? (time - a.time) / span : 0.0f;
+
+    CameraKeyframe result;
+    result.time = time;
+    result.position = glm::mix(a.position, b.position, t);
+    result.rotation = glm::mix(a.rotation, b.rotation, t);
+    return result;
+}
+
+auto CameraPath::load(const string& filename) -> bool
+{
+    ifstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    keyframes_.clear();
+    CameraKeyframe k;
+    while (file >> k.time >> k.position.x >> k.position.y >> k.position.z >> k.rotation.x >>
+           k.rotation.y >> k.rotation.z) {
+        addKeyframe(k);
+    }
+    return true;
+}
+
+auto CameraPath::save(const string& filename) const -> bool
+{
+    ofstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    for (const CameraKeyframe& k : keyframes_) {
+        file << std::format("{} {} {} {} {} {} {}\n", k.time, k.position.x, k.position.y,
+                            k.position.z, k.rotation.x, k.rotation.y, k.rotation.z);
+    }
+    return true;
+}
+
+void Benchmark::start(const BenchmarkConfig& config)
+{
+    config_ = config;
+    started_ = true;
+    frame_ = 0;
+
+    frameMs_.clear();
+    frameMs_.reserve(config_.measuredFrames);
+    phases_.clear();
+    gpuScopes_.clear();
+    counters_.clear();
+    info_.clear();
+    memory_.clear();
+
+    cameraPath_.clear();
+    for (const CameraKeyframe& keyframe : config_.cameraKeyframes) {
+        cameraPath_.addKeyframe(keyframe);
+    }
+    if (cameraPath_.empty() && !config_.cameraPathFile.empty() &&
+        !cameraPath_.load(config_.cameraPathFile)) {
+        exitWithMessage("Could not load camera path: {}", config_.cameraPathFile);
+    }
+
+    printLog("Benchmark: {} warmup and {} measured frames, {} camera keyframes",
+             config_.warmupFrames, config_.measuredFrames, cameraPath_.keyframes().size());
+
+    beginFrame(); // May be started in the middle of a frame
+}
+
+auto Benchmark::isActive() const -> bool
+{
+    return started_ && !isFinished();
+}
+
+auto Benchmark::isFinished() const -> bool
+{
+    return started_ && frame_ >= config_.warmupFrames + config_.measuredFrames;
+}
+
+auto Benchmark::isMeasuring() const -> bool
+{
+    return isActive() && frame_ >= config_.warmupFrames;
+}
+
+auto Benchmark::frame() const -> uint32_t
+{
+    return frame_;
+}
+
+auto Benchmark::time() const -> float
+{
+    return frame_ * config_.frameDeltaTime;
+}
+
+auto Benchmark::deltaTime() const -> float
+{
+    return config_.frameDeltaTime;
+}
+
+auto Benchmark::cameraPath() const -> const CameraPath&
+{
+    return cameraPath_;
+}
+
+auto Benchmark::config() const -> const BenchmarkConfig&
+{
+    return config_;
+}
+
+void Benchmark::beginFrame()
+{
+    frameStart_ = chrono::steady_clock::now();
+}
+
+void Benchmark::addPhase(const string& name, float ms)
+{
+    if (isMeasuring()) {
+        findSeries(phases_, name).samples.push_back(ms);
+    }
+}
+
+void Benchmark::addGpuScopes(const vector<pair<string, float>>& scopes)
+{
+    if (!isMeasuring()) {
+        return;
+    }
+    // A scope may be recorded more than once per frame (e.g. both occlusion culling phases):
+    // one sample per name with the sum, like GpuTimer's history
+    vector<pair<string, float>> frameScopes;
+    for (const auto& [name, ms] : scopes) {
+        auto it = std::find_if(frameScopes.begin(), frameScopes.end(),
+                               [&](const auto& scope) { return scope.first == name; });
+        if (it == frameScopes.end()) {
+            frameScopes.emplace_back(name, ms);
+        } else {
+            it->second += ms;
+        }
+    }
+    for (const auto& [name, ms] : frameScopes) {
+        findSeries(gpuScopes_, name).samples.push_back(ms);
+    }
+}
+
+void Benchmark::addCounter(const string& name, double value)
+{
+    if (!isMeasuring()) {
+        return;
+    }
+    auto it = std::find_if(counters_.begin(), counters_.end(),
+                           [&](const auto& counter) { return counter.first == name; });
+    if (it == counters_.end()) {
+        counters_.emplace_back(name, value);
+    } else {
+        it->second += value;
+    }
+}
+
+void Benchmark::endFrame()
+{
+    if (isMeasuring()) {
+        frameMs_.push_back(
+            chrono::duration<float, milli>(chrono::steady_clock::now() - frameStart_).count());
+    }
+    frame_++;
+}
+
+void Benchmark::setInfo(const string& name, const string& value)
+{
+    info_.emplace_back(name, value);
+}
+
+void Benchmark::setMemory(const string& name, VkDeviceSize bytes)
+{
+    memory_.emplace_back(name, bytes);
+}
+
+auto Benchmark::findSeries(vector<Series>& series, const string& name) -> Series&
+{
+    auto it = std::find_if(series.begin(), series.end(),
+                           [&](const Series& s) { return s.name == name; });
+    if (it != series.end()) {
+        return *it;
+    }
+    series.push_back(Series{name, {}});
+    return series.back();
+}
+
+// Nearest-rank percentile of sorted samples
+static auto percentile(const vector<float>& sorted, float p) -> float
+{
+    if (sorted.empty()) {
+        return 0.0f;
+    }
+    const size_t rank = size_t(std::ceil(p / 100.0f * sorted.size()));
+    return sorted[std::clamp(rank, size_t(1), sorted.size()) - 1];
+}
+
+static auto statisticsJson(vector<float> samples) -> string
+{
+    std::sort(samples.begin(), samples.end());
+    const float mean =
+        samples.empty()
+            ? 0.0f
+            : std::accumulate(samples.begin(), samples.end(), 0.0f) / float(samples.size());
+    return std::format("{{\"mean\": {:.4f}, \"min\": {:.4f}, \"p50\": {:.4f}, \"p95\": {:.4f}, "
+                       "\"p99\": {:.4f}, \"max\": {:.4f}, \"samples\": {}}}",
+                       mean, samples.empty() ? 0.0f : samples.front(), percentile(samples, 50.0f),
+                       percentile(samples, 95.0f), percentile(samples, 99.0f),
+                       samples.empty() ? 0.0f : samples.back(), samples.size());
+}
+
+auto Benchmark::writeJson(const string& filename) const -> bool
+{
+    ofstream file(filename);
+    if (!file.is_open()) {
+        printLog("Could not write benchmark results to {}", filename);
+        return false;
+    }
+
+    const auto writeObject = [&](const string& key, const auto& entries, const auto& toJson) {
+        file << std::format("  \"{}\": {{", key);
+        for (size_t i = 0; i < entries.size(); i++) {
+            file << std::format("{}\n    \"{}\": {}", i > 0 ? "," : "",
+                                escapeJson(entries[i].first), toJson(entries[i].second));
+        }
+        file << (entries.empty() ? "},\n" : "\n  },\n");
+    };
+    const auto seriesEntries = [](const vector<Series>& series) {
+        vector<pair<string, vector<float>>> entries;
+        for (const Series& s : series) {
+            entries.emplace_back(s.name, s.samples);
+        }
+        return entries;
+    };
+    const size_t measured = std::max(frameMs_.size(), size_t(1));
+
+    file << "{\n";
+    writeObject("info", info_,
+                [](const string& value) { return std::format("\"{}\"", escapeJson(value)); });
+    file << std::format("  \"warmupFrames\": {},\n  \"measuredFrames\": {},\n"
+                        "  \"frameDeltaTime\": {},\n",
+                        config_.warmupFrames, frameMs_.size(), config_.frameDeltaTime);
+    file << std::format("  \"cpuFrameMs\": {},\n", statisticsJson(frameMs_));
+    writeObject("cpuPhasesMs", seriesEntries(phases_), statisticsJson);
+    writeObject("gpuPassesMs", seriesEntries(gpuScopes_), statisticsJson);
+    writeObject("counters", counters_,
+                [&](double sum) { return std::format("{:.2f}", sum / measured); });
+    writeObject("memoryBytes", memory_,
+                [](VkDeviceSize bytes) { return std::format("{}", bytes); });
+    file << std::format("  \"cameraKeyframes\": {}\n}}\n", cameraPath_.keyframes().size());
+
+    vector<float> sorted = frameMs_;
+    std::sort(sorted.begin(), sorted.end());
+    printLog("Benchmark: p50 {:.3f} ms, p95 {:.3f} ms, p99 {:.3f} ms per frame, written to {}",
+             percentile(sorted, 50.0f), percentile(sorted, 95.0f), percentile(sorted, 99.0f),
+             filename);
+    return true;
+}
+
+} // namespace hlab
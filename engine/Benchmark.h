@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hlab {
+
+using namespace std;
+
+struct CameraKeyframe
+{
+    float time = 0.0f; // Seconds
+    glm::vec3 position{0.0f};
+    glm::vec3 rotation{0.0f}; // Camera::rotation (Euler angles in degrees)
+};
+
+// Camera poses over time, sampled with linear interpolation between keyframes and looped after
+// the last one. Saved as one "time px py pz rx ry rz" line per keyframe.
+class CameraPath
+{
+  public:
+    void addKeyframe(const CameraKeyframe& keyframe); // Times must not decrease
+    void clear();
+
+    auto empty() const -> bool;
+    auto duration() const -> float;
+    auto keyframes() const -> const vector<CameraKeyframe>&;
+    auto sample(float time) const -> CameraKeyframe;
+
+    auto load(const string& filename) -> bool;
+    auto save(const string& filename) const -> bool;
+
+  private:
+    vector<CameraKeyframe> keyframes_;
+};
+
+struct BenchmarkConfig
+{
+    bool enabled = false;
+    uint32_t warmupFrames = 120;  // Rendered but not measured (pipelines, caches, clocks)
+    uint32_t measuredFrames = 600;
+    float frameDeltaTime = 1.0f / 60.0f; // Fixed step of animation, camera path and shaders
+
+    // Camera path: the keyframes, or a file recorded in the camera window when they are empty.
+    // Without either the camera stays at its configured pose.
+    vector<CameraKeyframe> cameraKeyframes;
+    string cameraPathFile;
+
+    string outputFile = "benchmark.json";
+};
+
+// Deterministic benchmark run: warmup frames, then measured frames whose CPU frame time,
+// CPU phases, GPU passes and counters are collected and written as JSON with percentiles.
+// Scene time advances by the fixed step, so every run renders the same frames.
+//
+// Per frame: beginFrame(), add...() for the frame, endFrame(). Samples added during the
+// warmup are ignored.
+class Benchmark
+{
+  public:
+    void start(const BenchmarkConfig& config);
+
+    auto isActive() const -> bool; // Started and not finished
+    auto isFinished() const -> bool;
+    auto isMeasuring() const -> bool;
+    auto frame() const -> uint32_t;   // Since start, warmup included
+    auto time() const -> float;       // Scene time of the current frame
+    auto deltaTime() const -> float;
+    auto cameraPath() const -> const CameraPath&;
+    auto config() const -> const BenchmarkConfig&;
+
+    void beginFrame();
+    void addPhase(const string& name, float ms); // CPU time of a part of the frame
+    void addGpuScopes(const vector<pair<string, float>>& scopes);
+    void addCounter(const string& name, double value); // Averaged over the measured frames
+    void endFrame();
+
+    // Reported as is, e.g. device name, resolution, memory at the end of the run
+    void setInfo(const string& name, const string& value);
+    void setMemory(const string& name, VkDeviceSize bytes);
+
+    auto writeJson(const string& filename) const -> bool;
+
+  private:
+    struct Series
+    {
+        string name;
+        vector<float> samples;
+    };
+
+    BenchmarkConfig config_;
+    CameraPath cameraPath_;
+    bool started_{false};
+    uint32_t frame_{0};
+    chrono::steady_clock::time_point frameStart_;
+
+    vector<float> frameMs_;
+    vector<Series> phases_;
+    vector<Series> gpuScopes_;
+    vector<pair<string, double>> counters_; // Sums over the measured frames
+    vector<pair<string, string>> info_;
+    vector<pair<string, VkDeviceSize>> memory_;
+
+    static auto findSeries(vector<Series>& series, const string& name) -> Series&;
+};
+
+} // namespace hlab
@@ -0,0 +1,152 @@
+#include "CommandRecorder.h"
+#include "Context.h"
+#include "VulkanTools.h"
+#include "Logger.h"
+#include "PipelineStatistics.h"
+#include "Profiler.h"
+
+namespace hlab {
+
+CommandRecorder::CommandRecorder(Context& ctx, WorkerPool& workers) : ctx_(ctx), workers_(workers)
+{
+}
+
+CommandRecorder::~CommandRecorder()
+{
+    cleanup();
+}
+
+void CommandRecorder::create(uint32_t framesInFlight)
+{
+    cleanup();
+
+    threadCount_ = workers_.threadCount();
+
+    VkCommandPoolCreateInfo poolCI{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    poolCI.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolCI.queueFamilyIndex = ctx_.queueFamilyIndices().graphics;
+
+    VkCommandPoolCreateInfo persistentPoolCI = poolCI;
+    persistentPoolCI.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    frames_.resize(framesInFlight);
+    for (auto& threads : frames_) {
+        threads.resize(threadCount_);
+        for (ThreadCommands& commands : threads) {
+            check(vkCreateCommandPool(ctx_.device(), &poolCI, nullptr, &commands.pool));
+            check(vkCreateCommandPool(ctx_.device(), &persistentPoolCI, nullptr,
+                                      &commands.persistentPool));
+        }
+    }
+
+    printLog("Command recording threads: {}", threadCount_);
+}
+
+void CommandRecorder::cleanup()
+{
+    // Destroying a pool frees its command buffers
+    for (auto& threads : frames_) {
+        for (ThreadCommands& commands : threads) {
+            vkDestroyCommandPool(ctx_.device(), commands.pool, nullptr);
+            vkDestroyCommandPool(ctx_.device(), commands.persistentPool, nullptr);
+        }
+    }
+    frames_.clear();
+}
+
+void CommandRecorder::beginFrame(uint32_t frameIndex)
+{
+    frameIndex_ = frameIndex;
+    for (ThreadCommands& commands : frames_[frameIndex]) {
+        check(vkResetCommandPool(ctx_.device(), commands.pool, 0));
+        commands.used = 0;
+    }
+}
+
+auto CommandRecorder::record(uint32_t chunkCount,
+                             const VkCommandBufferInheritanceRenderingInfo& renderingInfo,
+                             const function<void(VkCommandBuffer, uint32_t)>& recordChunk,
+                             vector<VkCommandBuffer>* persistent) -> vector<VkCommandBuffer>
+{
+    vector<VkCommandBuffer> secondaries(chunkCount, VK_NULL_HANDLE);
+    if (persistent && persistent->size() < chunkCount) {
+        persistent->resize(chunkCount, VK_NULL_HANDLE);
+    }
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritanceInfo.pNext = &renderingInfo;
+    // May run inside a pipeline statistics query of the primary command buffer. The flags
+    // need both features (MoltenVK has inheritedQueries without pipelineStatisticsQuery).
+    const VkPhysicalDeviceFeatures& features = ctx_.enabledFeatures();
+    if (features.inheritedQueries && features.pipelineStatisticsQuery) {
+        inheritanceInfo.pipelineStatistics = PipelineStatistics::kStatisticFlags;
+    }
+
+    VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    if (!persistent) {
+        beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    }
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    // Chunks are dealt round-robin so that each thread only touches its own pools. This also
+    // holds across frames for persistent buffers: chunk i always comes from thread i % count.
+    const function<void(uint32_t)> job = [&](uint32_t threadIndex) {
+        HLAB_PROFILE_SCOPE("recordChunks");
+        ThreadCommands& commands = frames_[frameIndex_][threadIndex];
+        for (uint32_t chunk = threadIndex; chunk < chunkCount; chunk += threadCount_) {
+            VkCommandBuffer cmd = VK_NULL_HANDLE;
+            if (persistent) {
+                VkCommandBuffer& kept = (*persistent)[chunk];
+                if (kept == VK_NULL_HANDLE) {
+                    kept = allocate(commands.persistentPool);
+                }
+                cmd = kept; // vkBeginCommandBuffer resets it implicitly
+            } else {
+                cmd = acquire(commands);
+            }
+            check(vkBeginCommandBuffer(cmd, &beginInfo));
+            recordChunk(cmd, chunk);
+            check(vkEndCommandBuffer(cmd));
+            secondaries[chunk] = cmd;
+        }
+    };
+
+    if (chunkCount > 1 && threadCount_ > 1) {
+        workers_.run(job);
+    } else {
+        for (uint32_t i = 0; i < threadCount_; i++) {
+            job(i);
+        }
+    }
+
+    return secondaries;
+}
+
+auto CommandRecorder::threadCount() const -> uint32_t
+{
+    return threadCount_;
+}
+
+auto CommandRecorder::acquire(ThreadCommands& commands) -> VkCommandBuffer
+{
+    if (commands.used == commands.buffers.size()) {
+        commands.buffers.push_back(allocate(commands.pool));
+    }
+    return commands.buffers[commands.used++];
+}
+
+auto CommandRecorder::allocate(VkCommandPool pool) -> VkCommandBuffer
+{
+    VkCommandBufferAllocateInfo allocInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    allocInfo.commandPool = pool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    check(vkAllocateCommandBuffers(ctx_.device(), &allocInfo, &cmd));
+    return cmd;
+}
+
+} // namespace hlab
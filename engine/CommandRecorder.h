@@ -0,0 +1,73 @@
+#pragma once
+
+#include "WorkerPool.h"
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <vector>
+
+namespace hlab {
+
+using namespace std;
+
+class Context; // Forward declaration
+
+// Records chunks of a dynamic rendering pass into secondary command buffers in parallel.
+// 스레드마다 프레임 슬롯별 커맨드 풀을 따로 두기 때문에 풀 접근에 락이 필요 없고,
+// 펜스를 기다린 뒤 beginFrame()에서 해당 슬롯의 풀을 통째로 리셋합니다.
+// Runs on the threads of a shared WorkerPool, created before create().
+class CommandRecorder
+{
+  public:
+    CommandRecorder(Context& ctx, WorkerPool& workers);
+    CommandRecorder(const CommandRecorder&) = delete;
+    CommandRecorder& operator=(const CommandRecorder&) = delete;
+    ~CommandRecorder();
+
+    // One set of command pools per thread of the worker pool
+    void create(uint32_t framesInFlight);
+    void cleanup();
+
+    // Call after the fence of frameIndex has been waited on, before any record().
+    void beginFrame(uint32_t frameIndex);
+
+    // Calls recordChunk(cmd, chunk) for chunk = 0 .. chunkCount - 1, spread over the threads.
+    // Each cmd is a begun secondary command buffer continuing the rendering described by
+    // renderingInfo, ended after recordChunk returns. The result is in chunk order and must
+    // be executed in the primary with vkCmdExecuteCommands, inside a vkCmdBeginRendering
+    // that uses VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT.
+    //
+    // Without `persistent` the buffers are only valid for the current frame slot. With it,
+    // the buffers in *persistent are re-recorded in place (allocated on first use) and stay
+    // valid until the next record() into the same vector, so they can be executed again in
+    // later frames. Keep one such vector per frame slot.
+    auto record(uint32_t chunkCount, const VkCommandBufferInheritanceRenderingInfo& renderingInfo,
+                const function<void(VkCommandBuffer, uint32_t)>& recordChunk,
+                vector<VkCommandBuffer>* persistent = nullptr) -> vector<VkCommandBuffer>;
+
+    auto threadCount() const -> uint32_t;
+
+  private:
+    // Command pools of one thread for one frame slot
+    struct ThreadCommands
+    {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        vector<VkCommandBuffer> buffers; // Allocated so far, reused after the pool reset
+        uint32_t used = 0;
+
+        // Never reset as a whole; its buffers are owned by the callers' persistent vectors
+        VkCommandPool persistentPool = VK_NULL_HANDLE;
+    };
+
+    Context& ctx_;
+    WorkerPool& workers_;
+
+    uint32_t threadCount_{1}; // Of workers_ at create()
+    uint32_t frameIndex_{0};
+    vector<vector<ThreadCommands>> frames_; // [frame slot][thread]
+
+    auto acquire(ThreadCommands& commands) -> VkCommandBuffer;
+    auto allocate(VkCommandPool pool) -> VkCommandBuffer;
+};
+
+} // namespace hlab
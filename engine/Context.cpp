@@ -55,6 +55,29 @@ Context::Context(const vector<const char*>& requiredInstanceExtensions, bool use
     descriptorPool_.createFromScript();
 }
 
+auto Context::deviceMemoryUsage() const -> MemoryUsage
+{
+    MemoryUsage usage;
+    if (!memoryBudgetSupported_) {
+        return usage;
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT};
+    VkPhysicalDeviceMemoryProperties2 memoryProperties2{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2};
+    memoryProperties2.pNext = &budgetProperties;
+    vkGetPhysicalDeviceMemoryProperties2(physicalDevice_, &memoryProperties2);
+
+    for (uint32_t i = 0; i < deviceMemoryProperties_.memoryHeapCount; i++) {
+        if (deviceMemoryProperties_.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            usage.usedBytes += budgetProperties.heapUsage[i];
+            usage.budgetBytes += budgetProperties.heapBudget[i];
+        }
+    }
+    return usage;
+}
+
 uint32_t Context::getMemoryTypeIndex(uint32_t typeBits, VkMemoryPropertyFlags properties) const
 {
     for (uint32_t i = 0; i < deviceMemoryProperties_.memoryTypeCount; i++) {
@@ -440,6 +463,12 @@ void Context::createLogicalDevice(bool useSwapChain)
     enabledFeatures13.dynamicRendering = VK_TRUE;
     enabledFeatures13.synchronization2 = VK_TRUE;
 
+    // Cross-queue synchronization of the async compute passes (core in Vulkan 1.2)
+    VkPhysicalDeviceVulkan12Features enabledFeatures12{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+    enabledFeatures12.timelineSemaphore = VK_TRUE;
+    enabledFeatures12.pNext = &enabledFeatures13;
+
     vector<VkDeviceQueueCreateInfo> queueCreateInfos{};
 
     const float defaultQueuePriority(0.0f);
@@ -493,9 +522,18 @@ void Context::createLogicalDevice(bool useSwapChain)
         deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
     }
 
+    // Optional, only for reporting memory usage
+    memoryBudgetSupported_ = extensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (memoryBudgetSupported_) {
+        deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
     enabledFeatures_.samplerAnisotropy = deviceFeatures_.samplerAnisotropy;
     enabledFeatures_.depthClamp = deviceFeatures_.depthClamp;
     enabledFeatures_.depthBiasClamp = deviceFeatures_.depthBiasClamp;
+    // Optional, only for pipeline statistics of passes (also around secondary command buffers)
+    enabledFeatures_.pipelineStatisticsQuery = deviceFeatures_.pipelineStatisticsQuery;
+    enabledFeatures_.inheritedQueries = deviceFeatures_.inheritedQueries;
 
     VkDeviceCreateInfo deviceCreateInfo = {};
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -506,7 +544,7 @@ void Context::createLogicalDevice(bool useSwapChain)
     VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{};
     physicalDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
     physicalDeviceFeatures2.features = enabledFeatures_;
-    physicalDeviceFeatures2.pNext = &enabledFeatures13;
+    physicalDeviceFeatures2.pNext = &enabledFeatures12;
     deviceCreateInfo.pEnabledFeatures = nullptr;
     deviceCreateInfo.pNext = &physicalDeviceFeatures2;
 
@@ -613,6 +651,14 @@ VkQueue Context::transferQueue() const
     return transferQueue_;
 }
 
+auto Context::sharedQueueFamilyIndices() const -> vector<uint32_t>
+{
+    if (queueFamilyIndices_.compute == queueFamilyIndices_.graphics) {
+        return {};
+    }
+    return {queueFamilyIndices_.graphics, queueFamilyIndices_.compute};
+}
+
 string Context::deviceName() const
 {
     return string(deviceProperties_.deviceName);
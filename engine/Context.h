@@ -47,6 +47,10 @@ class Context
     auto computeQueue() const -> VkQueue;
     auto transferQueue() const -> VkQueue;
 
+    // Graphics and compute families for VK_SHARING_MODE_CONCURRENT resources that both queues
+    // use; empty when they are the same family (exclusive sharing is enough then)
+    auto sharedQueueFamilyIndices() const -> vector<uint32_t>;
+
     auto deviceName() const -> string;
     auto pipelineCache() const -> VkPipelineCache;
 
@@ -73,6 +77,23 @@ class Context
     {
         return queueFamilyIndices_;
     }
+    auto deviceProperties() const -> const VkPhysicalDeviceProperties&
+    {
+        return deviceProperties_;
+    }
+    auto enabledFeatures() const -> const VkPhysicalDeviceFeatures&
+    {
+        return enabledFeatures_;
+    }
+
+    struct MemoryUsage
+    {
+        VkDeviceSize usedBytes{0};   // By this process
+        VkDeviceSize budgetBytes{0}; // What it can use without degrading performance
+    };
+
+    // Device local heaps, from VK_EXT_memory_budget (all zero when the device lacks it)
+    auto deviceMemoryUsage() const -> MemoryUsage;
 
   private:
     VkInstance instance_{VK_NULL_HANDLE};
@@ -105,6 +126,7 @@ class Context
     VkPhysicalDeviceMemoryProperties deviceMemoryProperties_{};
 
     VkFormat depthFormat_{VK_FORMAT_UNDEFINED};
+    bool memoryBudgetSupported_{false};
 
     DescriptorPool descriptorPool_;
 
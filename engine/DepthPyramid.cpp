@@ -0,0 +1,187 @@
+#include "DepthPyramid.h"
+#include "Logger.h"
+
+#include <algorithm>
+
+namespace hlab {
+
+DepthPyramid::DepthPyramid(Context& ctx) : ctx_(ctx)
+{
+}
+
+DepthPyramid::~DepthPyramid()
+{
+    cleanup();
+}
+
+static auto previousPowerOfTwo(uint32_t value) -> uint32_t
+{
+    uint32_t result = 1;
+    while (result * 2 <= value) {
+        result *= 2;
+    }
+    return result;
+}
+
+void DepthPyramid::create(uint32_t depthWidth, uint32_t depthHeight)
+{
+    if (depthWidth == 0 || depthHeight == 0) {
+        exitWithMessage("Depth pyramid dimensions must be greater than zero");
+    }
+
+    cleanup();
+
+    const VkDevice device = ctx_.device();
+
+    // Rounding down keeps every pyramid texel within two depth texels in each direction
+    width_ = previousPowerOfTwo(depthWidth);
+    height_ = previousPowerOfTwo(depthHeight);
+    levelCount_ = 1;
+    while ((std::max(width_, height_) >> levelCount_) > 0 && levelCount_ < kMaxLevels) {
+        levelCount_++;
+    }
+
+    VkImageCreateInfo imageCI{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    imageCI.imageType = VK_IMAGE_TYPE_2D;
+    imageCI.format = format_;
+    imageCI.extent = {width_, height_, 1};
+    imageCI.mipLevels = levelCount_;
+    imageCI.arrayLayers = 1;
+    imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCI.usage =
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    check(vkCreateImage(device, &imageCI, nullptr, &image_));
+
+    VkMemoryRequirements memReqs;
+    vkGetImageMemoryRequirements(device, image_, &memReqs);
+
+    VkMemoryAllocateInfo memAlloc{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    memAlloc.allocationSize = memReqs.size;
+    memAlloc.memoryTypeIndex =
+        ctx_.getMemoryTypeIndex(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    check(vkAllocateMemory(device, &memAlloc, nullptr, &memory_));
+    check(vkBindImageMemory(device, image_, memory_, 0));
+
+    VkImageViewCreateInfo viewCI{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    viewCI.image = image_;
+    viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewCI.format = format_;
+    viewCI.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount_, 0, 1};
+    check(vkCreateImageView(device, &viewCI, nullptr, &imageView_));
+
+    viewCI.subresourceRange.levelCount = 1;
+    for (uint32_t level = 0; level < levelCount_; level++) {
+        viewCI.subresourceRange.baseMipLevel = level;
+        check(vkCreateImageView(device, &viewCI, nullptr, &levelViews_[level]));
+    }
+
+    // Only texelFetch is used, the sampler is needed for the descriptor type
+    VkSamplerCreateInfo samplerCI{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+    samplerCI.magFilter = VK_FILTER_NEAREST;
+    samplerCI.minFilter = VK_FILTER_NEAREST;
+    samplerCI.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerCI.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCI.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCI.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCI.maxLod = VK_LOD_CLAMP_NONE;
+    check(vkCreateSampler(device, &samplerCI, nullptr, &sampler_));
+
+    resourceBinding_.image_ = image_;
+    resourceBinding_.imageView_ = imageView_;
+    resourceBinding_.sampler_ = sampler_;
+    resourceBinding_.descriptorCount_ = 1;
+    resourceBinding_.update();
+    resourceBinding_.imageInfo_.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    resourceBinding_.barrierHelper_.update(image_, format_, levelCount_, 1);
+
+    for (uint32_t level = 0; level < levelCount_; level++) {
+        ResourceBinding& binding = levelBindings_[level];
+        binding.image_ = image_;
+        binding.imageView_ = levelViews_[level];
+        binding.descriptorType_ = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        binding.descriptorCount_ = 1;
+        binding.imageInfo_.imageView = levelViews_[level];
+        binding.imageInfo_.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
+    // Stays in GENERAL from here on; levels that are not built yet read as far away
+    CommandBuffer cmd = ctx_.createGraphicsCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+    resourceBinding_.barrierHelper_.transitionTo(
+        cmd.handle(), VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL,
+        VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+    const VkClearColorValue farDepth{{1.0f, 1.0f, 1.0f, 1.0f}};
+    const VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount_, 0, 1};
+    vkCmdClearColorImage(cmd.handle(), image_, VK_IMAGE_LAYOUT_GENERAL, &farDepth, 1, &range);
+    resourceBinding_.barrierHelper_.transitionTo(
+        cmd.handle(), VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    cmd.submitAndWait();
+
+    printLog("Depth pyramid: {}x{}, {} levels", width_, height_, levelCount_);
+}
+
+void DepthPyramid::cleanup()
+{
+    const VkDevice device = ctx_.device();
+
+    if (sampler_ != VK_NULL_HANDLE) {
+        vkDestroySampler(device, sampler_, nullptr);
+        sampler_ = VK_NULL_HANDLE;
+    }
+
+    for (VkImageView& view : levelViews_) {
+        if (view != VK_NULL_HANDLE) {
+            vkDestroyImageView(device, view, nullptr);
+            view = VK_NULL_HANDLE;
+        }
+    }
+
+    if (imageView_ != VK_NULL_HANDLE) {
+        vkDestroyImageView(device, imageView_, nullptr);
+        imageView_ = VK_NULL_HANDLE;
+    }
+
+    if (image_ != VK_NULL_HANDLE) {
+        vkDestroyImage(device, image_, nullptr);
+        image_ = VK_NULL_HANDLE;
+    }
+
+    if (memory_ != VK_NULL_HANDLE) {
+        vkFreeMemory(device, memory_, nullptr);
+        memory_ = VK_NULL_HANDLE;
+    }
+
+    width_ = 0;
+    height_ = 0;
+    levelCount_ = 0;
+}
+
+auto DepthPyramid::width() const -> uint32_t
+{
+    return width_;
+}
+
+auto DepthPyramid::height() const -> uint32_t
+{
+    return height_;
+}
+
+auto DepthPyramid::levelCount() const -> uint32_t
+{
+    return levelCount_;
+}
+
+auto DepthPyramid::resourceBinding() -> ResourceBinding&
+{
+    return resourceBinding_;
+}
+
+auto DepthPyramid::levelBinding(uint32_t level) -> ResourceBinding&
+{
+    return levelBindings_[level];
+}
+
+} // namespace hlab
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Context.h"
+#include "ResourceBinding.h"
+
+namespace hlab {
+
+// Hierarchical depth (Hi-Z) for GPU occlusion culling: r32f mip chain where every texel holds
+// the farthest depth of the pixels it covers. Mip 0 is the depth buffer reduced to the previous
+// power of two, so every level is exactly half of the one above it.
+// Compute-only, so the image always stays in GENERAL layout.
+class DepthPyramid
+{
+  public:
+    static constexpr uint32_t kMaxLevels = 16;
+
+    DepthPyramid(Context& ctx);
+    DepthPyramid(const DepthPyramid&) = delete;
+    DepthPyramid& operator=(const DepthPyramid&) = delete;
+    ~DepthPyramid();
+
+    // depthWidth x depthHeight: size of the depth buffer the pyramid is built from
+    void create(uint32_t depthWidth, uint32_t depthHeight);
+    void cleanup();
+
+    auto width() const -> uint32_t;  // Of mip 0
+    auto height() const -> uint32_t; // Of mip 0
+    auto levelCount() const -> uint32_t;
+
+    // All levels as a sampler2D (read with texelFetch)
+    auto resourceBinding() -> ResourceBinding&;
+
+    // One level as a storage image
+    auto levelBinding(uint32_t level) -> ResourceBinding&;
+
+  private:
+    Context& ctx_;
+
+    VkImage image_{VK_NULL_HANDLE};
+    VkDeviceMemory memory_{VK_NULL_HANDLE};
+    VkImageView imageView_{VK_NULL_HANDLE};
+    VkImageView levelViews_[kMaxLevels]{};
+    VkSampler sampler_{VK_NULL_HANDLE};
+    uint32_t width_{0};
+    uint32_t height_{0};
+    uint32_t levelCount_{0};
+    VkFormat format_{VK_FORMAT_R32_SFLOAT};
+
+    ResourceBinding resourceBinding_;
+    ResourceBinding levelBindings_[kMaxLevels];
+};
+
+} // namespace hlab
@@ -2,6 +2,7 @@
 
 #include "Context.h"
 #include "BarrierHelper.h"
+#include "ResourceBinding.h"
 
 namespace hlab {
 
@@ -18,6 +19,25 @@ class DepthStencil // TODO: hlab::Image or texture
     }
 
     void create(uint32_t width, uint32_t height, VkSampleCountFlagBits msaaSamples)
+    {
+        createUnbound(width, height, msaaSamples,
+                      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+
+        VkMemoryAllocateInfo memAlloc{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+        VkMemoryRequirements memReqs;
+        vkGetImageMemoryRequirements(ctx_.device(), image, &memReqs);
+        memAlloc.allocationSize = memReqs.size;
+        memAlloc.memoryTypeIndex =
+            ctx_.getMemoryTypeIndex(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        check(vkAllocateMemory(ctx_.device(), &memAlloc, nullptr, &memory));
+
+        bindMemory(memory, 0);
+    }
+
+    // Image without memory, completed by bindMemory() (memory shared by a RenderGraph). The
+    // memory stays owned by the caller.
+    void createUnbound(uint32_t width, uint32_t height, VkSampleCountFlagBits msaaSamples,
+                       VkImageUsageFlags usage)
     {
         VkImageCreateInfo imageCI{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
         imageCI.imageType = VK_IMAGE_TYPE_2D;
@@ -27,18 +47,28 @@ class DepthStencil // TODO: hlab::Image or texture
         imageCI.arrayLayers = 1;
         imageCI.samples = msaaSamples;
         imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imageCI.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageCI.usage = usage;
         imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        const vector<uint32_t> queueFamilies =
+            sharedWithCompute_ ? ctx_.sharedQueueFamilyIndices() : vector<uint32_t>{};
+        if (!queueFamilies.empty()) {
+            imageCI.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            imageCI.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+            imageCI.pQueueFamilyIndices = queueFamilies.data();
+        }
         check(vkCreateImage(ctx_.device(), &imageCI, nullptr, &image));
+    }
 
-        VkMemoryAllocateInfo memAlloc{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-        VkMemoryRequirements memReqs;
-        vkGetImageMemoryRequirements(ctx_.device(), image, &memReqs);
-        memAlloc.allocationSize = memReqs.size;
-        memAlloc.memoryTypeIndex =
-            ctx_.getMemoryTypeIndex(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        check(vkAllocateMemory(ctx_.device(), &memAlloc, nullptr, &memory));
-        check(vkBindImageMemory(ctx_.device(), image, memory, 0));
+    // Sampled by compute passes on the compute queue (see Image2D::shareWithComputeQueue())
+    void shareWithComputeQueue()
+    {
+        sharedWithCompute_ = true;
+    }
+
+    void bindMemory(VkDeviceMemory deviceMemory, VkDeviceSize offset)
+    {
+        check(vkBindImageMemory(ctx_.device(), image, deviceMemory, offset));
 
         // Create depth-stencil view for rendering (includes both depth and stencil aspects)
         VkImageViewCreateInfo depthStencilViewCI{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
@@ -73,6 +103,23 @@ class DepthStencil // TODO: hlab::Image or texture
         barrierHelper_.update(image, ctx_.depthFormat(), 1, 1);
     }
 
+    // Binds samplerView (depth only) for sampling in shaders. The descriptor uses
+    // DEPTH_STENCIL_READ_ONLY_OPTIMAL so the image can stay attached as a read-only depth
+    // buffer (e.g. sky after deferred lighting) while it is being sampled.
+    void setSampler(VkSampler sampler)
+    {
+        resourceBinding_.image_ = image;
+        resourceBinding_.imageView_ = samplerView;
+        resourceBinding_.descriptorCount_ = 1;
+        resourceBinding_.setSampler(sampler);
+        resourceBinding_.imageInfo_.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    }
+
+    auto resourceBinding() -> ResourceBinding&
+    {
+        return resourceBinding_;
+    }
+
     void cleanup()
     {
         if (samplerView != VK_NULL_HANDLE) {
@@ -101,6 +148,8 @@ class DepthStencil // TODO: hlab::Image or texture
 
   private:
     Context& ctx_;
+    ResourceBinding resourceBinding_;
+    bool sharedWithCompute_{false};
 };
 
 } // namespace hlab
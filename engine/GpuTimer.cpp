@@ -0,0 +1,207 @@
+#include "GpuTimer.h"
+#include "Context.h"
+#include "VulkanTools.h"
+#include "Logger.h"
+#include <algorithm>
+
+namespace hlab {
+
+GpuTimer::GpuTimer(Context& ctx) : ctx_(ctx)
+{
+}
+
+GpuTimer::~GpuTimer()
+{
+    cleanup();
+}
+
+void GpuTimer::create(uint32_t framesInFlight, uint32_t maxScopesPerFrame)
+{
+    cleanup();
+
+    const VkPhysicalDeviceLimits& limits = ctx_.deviceProperties().limits;
+    // Scopes may also be recorded on the compute queue (async compute)
+    const auto& families = ctx_.queueFamilyProperties();
+    const uint32_t validBits =
+        std::min(families[ctx_.queueFamilyIndices().graphics].timestampValidBits,
+                 families[ctx_.queueFamilyIndices().compute].timestampValidBits);
+
+    supported_ = limits.timestampComputeAndGraphics && validBits > 0;
+    if (!supported_) {
+        printLog("GPU timestamps are not supported on this device");
+        return;
+    }
+
+    timestampPeriod_ = limits.timestampPeriod;
+    timestampMask_ = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+    maxQueriesPerFrame_ = maxScopesPerFrame * 2;
+
+    VkQueryPoolCreateInfo queryPoolCI{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCI.queryCount = maxQueriesPerFrame_ * framesInFlight;
+    check(vkCreateQueryPool(ctx_.device(), &queryPoolCI, nullptr, &queryPool_));
+
+    frameScopes_.resize(framesInFlight);
+}
+
+void GpuTimer::cleanup()
+{
+    if (queryPool_ != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(ctx_.device(), queryPool_, nullptr);
+        queryPool_ = VK_NULL_HANDLE;
+    }
+    frameScopes_.clear();
+    openScopes_.clear();
+}
+
+void GpuTimer::collect(uint32_t frameIndex)
+{
+    if (!supported_ || frameScopes_[frameIndex].empty()) {
+        return;
+    }
+
+    const vector<Scope>& scopes = frameScopes_[frameIndex];
+    const uint32_t firstQuery = frameIndex * maxQueriesPerFrame_;
+    const uint32_t queryCount = scopes.back().endQuery - firstQuery + 1;
+
+    // {timestamp, availability} pairs
+    vector<uint64_t> results(queryCount * 2, 0);
+    VkResult result = vkGetQueryPoolResults(
+        ctx_.device(), queryPool_, firstQuery, queryCount, results.size() * sizeof(uint64_t),
+        results.data(), sizeof(uint64_t) * 2,
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {
+        check(result);
+    }
+
+    resolvedScopes_.clear();
+    for (const Scope& scope : scopes) {
+        const uint32_t b = scope.beginQuery - firstQuery;
+        const uint32_t e = scope.endQuery - firstQuery;
+        if (results[b * 2 + 1] == 0 || results[e * 2 + 1] == 0) {
+            continue; // Not available yet, keep the previous value
+        }
+        const uint64_t ticks = (results[e * 2] - results[b * 2]) & timestampMask_;
+        elapsedMs_[scope.name] = float(double(ticks) * timestampPeriod_ * 1e-6);
+        intervals_[scope.name] = {results[b * 2], results[b * 2] + ticks};
+        resolvedScopes_.emplace_back(scope.name, elapsedMs_[scope.name]);
+    }
+
+    pushHistory();
+}
+
+void GpuTimer::pushHistory()
+{
+    for (const auto& [name, ms] : resolvedScopes_) {
+        if (!histories_.contains(name)) {
+            histories_[name].values.assign(kHistorySize, 0.0f);
+            historyNames_.push_back(name);
+        }
+    }
+
+    for (auto& [name, history] : histories_) {
+        // A scope may be recorded more than once per frame (e.g. per cascade): sum them
+        float ms = 0.0f;
+        for (const auto& scope : resolvedScopes_) {
+            if (scope.first == name) {
+                ms += scope.second;
+            }
+        }
+        history.values[history.offset] = ms;
+        history.offset = (history.offset + 1) % kHistorySize;
+    }
+}
+
+void GpuTimer::beginFrame(VkCommandBuffer cmd, uint32_t frameIndex)
+{
+    if (!supported_) {
+        return;
+    }
+
+    frameIndex_ = frameIndex;
+    nextQuery_ = frameIndex * maxQueriesPerFrame_;
+    frameScopes_[frameIndex].clear();
+    openScopes_.clear();
+
+    vkCmdResetQueryPool(cmd, queryPool_, nextQuery_, maxQueriesPerFrame_);
+}
+
+void GpuTimer::begin(VkCommandBuffer cmd, const string& name)
+{
+    if (!supported_) {
+        return;
+    }
+
+    if (nextQuery_ + 2 > (frameIndex_ + 1) * maxQueriesPerFrame_) {
+        exitWithMessage("GpuTimer: too many scopes in a frame ({})", name);
+    }
+
+    Scope scope;
+    scope.name = name;
+    scope.beginQuery = nextQuery_++;
+    scope.endQuery = nextQuery_++;
+
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, queryPool_, scope.beginQuery);
+
+    openScopes_.push_back(uint32_t(frameScopes_[frameIndex_].size()));
+    frameScopes_[frameIndex_].push_back(scope);
+}
+
+void GpuTimer::end(VkCommandBuffer cmd)
+{
+    if (!supported_) {
+        return;
+    }
+
+    if (openScopes_.empty()) {
+        exitWithMessage("GpuTimer: end() without matching begin()");
+    }
+
+    const Scope& scope = frameScopes_[frameIndex_][openScopes_.back()];
+    openScopes_.pop_back();
+
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool_, scope.endQuery);
+}
+
+auto GpuTimer::isSupported() const -> bool
+{
+    return supported_;
+}
+
+auto GpuTimer::elapsedMs(const string& name) const -> float
+{
+    auto it = elapsedMs_.find(name);
+    return it != elapsedMs_.end() ? it->second : 0.0f;
+}
+
+auto GpuTimer::resolvedScopes() const -> const vector<pair<string, float>>&
+{
+    return resolvedScopes_;
+}
+
+auto GpuTimer::historyNames() const -> const vector<string>&
+{
+    return historyNames_;
+}
+
+auto GpuTimer::history(const string& name) const -> const GpuTimer::History*
+{
+    auto it = histories_.find(name);
+    return it != histories_.end() ? &it->second : nullptr;
+}
+
+auto GpuTimer::overlapMs(const string& first, const string& second) const -> float
+{
+    auto a = intervals_.find(first);
+    auto b = intervals_.find(second);
+    if (a == intervals_.end() || b == intervals_.end()) {
+        return 0.0f;
+    }
+
+    const uint64_t begin = std::max(a->second.first, b->second.first);
+    const uint64_t end = std::min(a->second.second, b->second.second);
+    return end > begin ? float(double(end - begin) * timestampPeriod_ * 1e-6) : 0.0f;
+}
+
+} // namespace hlab
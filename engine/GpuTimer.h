@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hlab {
+
+using namespace std;
+
+class Context; // Forward declaration
+
+// Timestamp-query based GPU timer.
+// 프레임 슬롯(frames in flight)마다 쿼리 구간을 따로 두기 때문에, 펜스를 기다린 뒤
+// 해당 슬롯의 결과를 읽으면 GPU를 멈추지 않고(VK_QUERY_RESULT_WAIT_BIT 없이) 읽을 수 있습니다.
+class GpuTimer
+{
+  public:
+    GpuTimer(Context& ctx);
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+    ~GpuTimer();
+
+    void create(uint32_t framesInFlight, uint32_t maxScopesPerFrame = 32);
+    void cleanup();
+
+    // Call right after the fence of frameIndex has been waited on.
+    void collect(uint32_t frameIndex);
+
+    // Resets the query range of frameIndex. Must be recorded before any begin()/end().
+    void beginFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+
+    void begin(VkCommandBuffer cmd, const string& name);
+    void end(VkCommandBuffer cmd); // Closes the most recently opened scope
+
+    auto isSupported() const -> bool;
+    auto elapsedMs(const string& name) const -> float; // Last resolved value, 0 if unknown
+
+    // Scopes resolved by the last collect(), in recording order
+    auto resolvedScopes() const -> const vector<pair<string, float>>&;
+
+    // Rolling history of a scope for graphs, one value per collected frame (0 when the scope
+    // was not recorded in that frame). Oldest value at offset, as ImGui::PlotLines expects.
+    struct History
+    {
+        vector<float> values;
+        uint32_t offset = 0;
+    };
+    static constexpr uint32_t kHistorySize = 120;
+    auto historyNames() const -> const vector<string>&; // In order of first appearance
+    auto history(const string& name) const -> const History*; // nullptr if never resolved
+
+    // Time during which both scopes of the last resolved frame ran, e.g. a scope on the compute
+    // queue and one on the graphics queue (timestamps of all queues share one time base)
+    auto overlapMs(const string& first, const string& second) const -> float;
+
+  private:
+    struct Scope
+    {
+        string name;
+        uint32_t beginQuery = 0;
+        uint32_t endQuery = 0;
+    };
+
+    Context& ctx_;
+
+    VkQueryPool queryPool_{VK_NULL_HANDLE};
+    uint32_t maxQueriesPerFrame_{0};
+    float timestampPeriod_{1.0f}; // Nanoseconds per tick
+    uint64_t timestampMask_{~0ull};
+    bool supported_{false};
+
+    uint32_t frameIndex_{0};
+    uint32_t nextQuery_{0};
+    vector<vector<Scope>> frameScopes_; // Recorded scopes per frame slot
+    vector<uint32_t> openScopes_;       // Indices into frameScopes_[frameIndex_]
+
+    unordered_map<string, float> elapsedMs_;
+    unordered_map<string, pair<uint64_t, uint64_t>> intervals_; // Begin and end ticks
+    vector<pair<string, float>> resolvedScopes_;
+    unordered_map<string, History> histories_;
+    vector<string> historyNames_;
+
+    void pushHistory();
+};
+
+} // namespace hlab
@@ -134,8 +134,12 @@ bool GuiRenderer::update()
 }
 
 void GuiRenderer::draw(const VkCommandBuffer cmd, VkImageView swapchainImageView,
-                       VkViewport viewport)
+                       VkViewport viewport, GpuTimer* gpuTimer)
 {
+    if (gpuTimer) {
+        gpuTimer->begin(cmd, "gui");
+    }
+
     VkRenderingAttachmentInfo swapchainColorAttachment{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
     swapchainColorAttachment.imageView = swapchainImageView;
     swapchainColorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
@@ -193,6 +197,10 @@ void GuiRenderer::draw(const VkCommandBuffer cmd, VkImageView swapchainImageView
     }
 
     vkCmdEndRendering(cmd);
+
+    if (gpuTimer) {
+        gpuTimer->end(cmd);
+    }
 }
 
 void GuiRenderer::resize(uint32_t width, uint32_t height)
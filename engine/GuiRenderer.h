@@ -7,6 +7,7 @@
 #include "Sampler.h"
 #include "PushConstants.h"
 #include "DescriptorSet.h"
+#include "GpuTimer.h"
 #include <glm/glm.hpp>
 #include <imgui.h>
 
@@ -27,7 +28,9 @@ class GuiRenderer
     GuiRenderer(Context& ctx, ShaderManager& shaderManager, VkFormat colorFormat);
     ~GuiRenderer();
 
-    void draw(const VkCommandBuffer cmd, VkImageView swapchainImageView, VkViewport viewport);
+    // Timed as the "gui" scope when a GPU timer of the frame is given
+    void draw(const VkCommandBuffer cmd, VkImageView swapchainImageView, VkViewport viewport,
+              GpuTimer* gpuTimer = nullptr);
     void resize(uint32_t width, uint32_t height);
 
     auto update() -> bool;
@@ -0,0 +1,308 @@
+#include "HeadlessApplication.h"
+#include "Logger.h"
+
+#include <stb_image_write.h>
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <numeric>
+
+namespace hlab {
+
+HeadlessApplication::HeadlessApplication(const ApplicationConfig& config,
+                                         const HeadlessConfig& headlessConfig)
+    : headlessConfig_(headlessConfig),
+      framesInFlight_(std::clamp(headlessConfig.framesInFlight, 1u, kMaxFramesInFlight)),
+      ctx_({}, false), // No surface extensions, no VK_KHR_swapchain
+      shaderManager_(ctx_, kShaderPathPrefix, Renderer::pipelineShaders()),
+      readbackBuffer_(ctx_),
+      renderer_(ctx_, shaderManager_, kMaxFramesInFlight, kAssetsPathPrefix, kShaderPathPrefix)
+{
+    Profiler::instance().setThreadName("main"); // Before any worker thread starts
+
+    const uint32_t width = headlessConfig_.width;
+    const uint32_t height = headlessConfig_.height;
+
+    commandBuffers_ = ctx_.createGraphicsCommandBuffers(kMaxFramesInFlight);
+
+    colorTargets_.reserve(kMaxFramesInFlight);
+    for (uint32_t i = 0; i < kMaxFramesInFlight; i++) {
+        colorTargets_.emplace_back(ctx_);
+        colorTargets_.back().createImage(
+            kColorFormat, width, height, VK_SAMPLE_COUNT_1_BIT,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_IMAGE_ASPECT_COLOR_BIT, 1, 1, 0, VK_IMAGE_VIEW_TYPE_2D);
+    }
+
+    if (!headlessConfig_.capturePrefix.empty()) {
+        readbackBuffer_.createStagingBuffer(VkDeviceSize(width) * height * 4, nullptr);
+    }
+
+    VkSemaphoreTypeCreateInfo timelineCI{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+    timelineCI.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineCI.initialValue = 0;
+    VkSemaphoreCreateInfo timelineSemaphoreCI{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    timelineSemaphoreCI.pNext = &timelineCI;
+    check(vkCreateSemaphore(ctx_.device(), &timelineSemaphoreCI, nullptr, &frameTimeline_));
+    slotValues_.assign(kMaxFramesInFlight, 0);
+
+    benchmarkConfig_ = config.benchmark;
+    profilerConfig_ = config.profiler;
+    if (profilerConfig_.captureAtStart) {
+        traceFramesLeft_ = std::max(profilerConfig_.captureFrames, 1u);
+        Profiler::instance().startCapture(); // Includes loading
+    }
+
+    Application::setupCamera(camera_, config.camera, float(width) / height);
+    Application::loadModels(ctx_, kAssetsPathPrefix, config.models, models_);
+
+    renderer_.prepareForModels(models_, kColorFormat, ctx_.depthFormat(),
+                               ctx_.getMaxUsableSampleCount(), width, height);
+}
+
+HeadlessApplication::~HeadlessApplication()
+{
+    ctx_.waitIdle();
+
+    for (auto& cmd : commandBuffers_) {
+        cmd.cleanup();
+    }
+
+    vkDestroySemaphore(ctx_.device(), frameTimeline_, nullptr);
+
+    // Destructors of members automatically cleanup everything.
+}
+
+void HeadlessApplication::run()
+{
+    const HeadlessConfig& config = headlessConfig_;
+
+    VkViewport viewport{0.0f, 0.0f, float(config.width), float(config.height), 0.0f, 1.0f};
+    VkRect2D scissor{0, 0, config.width, config.height};
+
+    uint32_t frameCount = config.frameCount;
+    float deltaTime = config.frameDeltaTime;
+    if (benchmarkConfig_.enabled) {
+        benchmark_.start(benchmarkConfig_);
+        frameCount = benchmarkConfig_.warmupFrames + benchmarkConfig_.measuredFrames;
+        deltaTime = benchmark_.deltaTime();
+    }
+
+    frameTimesMs_.clear();
+    frameTimesMs_.reserve(frameCount);
+
+    uint32_t currentFrame = 0; // Frame slot: command buffers, color targets, uniforms
+    auto frameStart = std::chrono::steady_clock::now();
+
+    for (uint32_t frame = 0; frame < frameCount; frame++) {
+        {
+            HLAB_PROFILE_SCOPE("frame");
+            benchmark_.beginFrame();
+
+            // CPU time of the parts of the frame, reported by the benchmark
+            auto phaseStart = std::chrono::steady_clock::now();
+            const auto endPhase = [&](const char* name) {
+                const auto now = std::chrono::steady_clock::now();
+                HLAB_PROFILE_ZONE(name, phaseStart, now);
+                benchmark_.addPhase(name, std::chrono::duration<float, std::milli>(now - phaseStart)
+                                              .count());
+                phaseStart = now;
+            };
+
+            // The slot must be free, and at most framesInFlight_ frames (with this one) queued
+            const uint64_t queuedLimit =
+                frameValue_ + 1 > framesInFlight_ ? frameValue_ + 1 - framesInFlight_ : 0;
+            waitForFrame(std::max(slotValues_[currentFrame], queuedLimit));
+            endPhase("wait");
+
+            updateScene(currentFrame, frame * deltaTime, deltaTime);
+            endPhase("update");
+
+            CommandBuffer& cmd = commandBuffers_[currentFrame];
+            check(vkResetCommandBuffer(cmd.handle(), 0));
+            VkCommandBufferBeginInfo cmdBufferBeginInfo{
+                VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+            check(vkBeginCommandBuffer(cmd.handle(), &cmdBufferBeginInfo));
+
+            renderer_.beginFrame(cmd.handle(), currentFrame);
+            renderer_.makeShadowMap(cmd.handle(), currentFrame, models_);
+
+            Image2D& colorTarget = colorTargets_[currentFrame];
+            VkCommandBuffer frameCmd =
+                renderer_.draw(cmd.handle(), currentFrame, colorTarget.view(),
+                               colorTarget.barrierHelper(), models_, viewport, scissor);
+
+            const bool capture =
+                !config.capturePrefix.empty() &&
+                (config.captureInterval > 0 ? frame % config.captureInterval == 0
+                                            : frame + 1 == frameCount);
+            if (capture) {
+                recordReadback(frameCmd, colorTarget);
+            }
+            check(vkEndCommandBuffer(frameCmd));
+            endPhase("record");
+
+            // Nothing to acquire or present
+            frameValue_++;
+            slotValues_[currentFrame] = frameValue_;
+            renderer_.submitFrame(frameCmd, VK_NULL_HANDLE, VK_NULL_HANDLE, frameTimeline_,
+                                  frameValue_);
+            endPhase("submit");
+
+            // Stalls the pipeline, so captured frames also show up in the frame times
+            if (capture) {
+                waitForFrame(frameValue_);
+                writeCapture(frame);
+            }
+
+            currentFrame = (currentFrame + 1) % framesInFlight_;
+
+            const auto frameEnd = std::chrono::steady_clock::now();
+            frameTimesMs_.push_back(
+                std::chrono::duration<float, std::milli>(frameEnd - frameStart).count());
+            frameStart = frameEnd;
+
+            if (benchmark_.isActive()) {
+                renderer_.reportBenchmarkStats(benchmark_);
+                benchmark_.endFrame();
+            }
+        }
+
+        // After the "frame" zone above has been recorded, so the trace ends with a whole frame
+        if (traceFramesLeft_ > 0 && --traceFramesLeft_ == 0) {
+            finishTrace();
+        }
+    }
+
+    ctx_.waitIdle();
+
+    if (traceFramesLeft_ > 0) {
+        traceFramesLeft_ = 0;
+        finishTrace(); // Fewer frames than captureFrames
+    }
+
+    if (benchmark_.isFinished()) {
+        finishBenchmark();
+    }
+
+    if (!frameTimesMs_.empty()) {
+        const float totalMs = std::accumulate(frameTimesMs_.begin(), frameTimesMs_.end(), 0.0f);
+        const float averageMs = totalMs / frameTimesMs_.size();
+        printLog("Headless: {} frames of {}x{}, {:.3f} ms/frame ({:.1f} FPS)",
+                 frameTimesMs_.size(), config.width, config.height, averageMs,
+                 1000.0f / averageMs);
+    }
+}
+
+void HeadlessApplication::updateScene(uint32_t currentFrame, float time, float deltaTime)
+{
+    camera_.update(deltaTime);
+    if (benchmark_.isActive() && !benchmark_.cameraPath().empty()) {
+        const CameraKeyframe pose = benchmark_.cameraPath().sample(time);
+        camera_.position = pose.position;
+        camera_.setRotation(pose.rotation);
+    }
+    renderer_.setCamera(camera_);
+
+    for (auto& model : models_) {
+        if (model.hasAnimations()) {
+            model.updateAnimation(deltaTime);
+        }
+    }
+
+    renderer_.fitShadowsToScene(models_);
+
+    renderer_.update(camera_, currentFrame, time * 0.5f);
+    renderer_.updateBoneData(models_, currentFrame);
+
+    renderer_.cullScene(models_);
+
+    // Needs the world bounds above; uploaded with the next renderer_.update()
+    if (localLightsDirty_) {
+        renderer_.generateLocalLights(models_, headlessConfig_.localLightCount,
+                                      headlessConfig_.localLightRange,
+                                      headlessConfig_.localLightIntensity);
+        localLightsDirty_ = false;
+    }
+}
+
+void HeadlessApplication::waitForFrame(uint64_t value)
+{
+    VkSemaphoreWaitInfo waitInfo{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &frameTimeline_;
+    waitInfo.pValues = &value;
+    check(vkWaitSemaphores(ctx_.device(), &waitInfo, UINT64_MAX));
+}
+
+void HeadlessApplication::recordReadback(VkCommandBuffer cmd, Image2D& colorTarget)
+{
+    colorTarget.transitionToTransferSrc(cmd);
+
+    VkBufferImageCopy copyRegion{};
+    copyRegion.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    copyRegion.imageExtent = {colorTarget.width(), colorTarget.height(), 1};
+    vkCmdCopyImageToBuffer(cmd, colorTarget.image(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           readbackBuffer_.buffer(), 1, &copyRegion);
+
+    // Makes the copy visible to the host once the frame timeline is signaled
+    VkMemoryBarrier2 hostBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    hostBarrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    hostBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    hostBarrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+    VkDependencyInfo dependencyInfo{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependencyInfo.memoryBarrierCount = 1;
+    dependencyInfo.pMemoryBarriers = &hostBarrier;
+    vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+}
+
+void HeadlessApplication::writeCapture(uint32_t frame)
+{
+    const uint32_t width = headlessConfig_.width;
+    const uint32_t height = headlessConfig_.height;
+    const string filename = std::format("{}{:04}.png", headlessConfig_.capturePrefix, frame);
+
+    // kColorFormat is RGBA8 (sRGB encoded), rows tightly packed
+    if (!stbi_write_png(filename.c_str(), width, height, 4, readbackBuffer_.mapped(),
+                        width * 4)) {
+        exitWithMessage("Failed to write headless capture: {}", filename);
+    }
+    printLog("Captured frame {} to {}", frame, filename);
+}
+
+void HeadlessApplication::finishBenchmark()
+{
+    const Context::MemoryUsage memory = ctx_.deviceMemoryUsage();
+
+    benchmark_.setInfo("device", ctx_.deviceName());
+    benchmark_.setInfo("resolution",
+                       std::format("{}x{}", headlessConfig_.width, headlessConfig_.height));
+    benchmark_.setInfo("renderPath",
+                       renderer_.renderPath() == RenderPath::Forward ? "Forward" : "Deferred");
+    benchmark_.setInfo("msaaSamples", std::format("{}", int(ctx_.getMaxUsableSampleCount())));
+    benchmark_.setInfo("framesInFlight", std::format("{}", framesInFlight_));
+    benchmark_.setInfo("presentMode", "headless");
+    benchmark_.setMemory("deviceLocalUsed", memory.usedBytes);
+    benchmark_.setMemory("deviceLocalBudget", memory.budgetBytes);
+    benchmark_.setMemory("transientTargets", renderer_.renderGraphStats().allocatedBytes);
+    benchmark_.writeJson(benchmark_.config().outputFile);
+}
+
+void HeadlessApplication::finishTrace()
+{
+    Profiler::instance().stopCapture();
+    Profiler::instance().writeChromeTrace(profilerConfig_.outputFile);
+}
+
+auto HeadlessApplication::renderer() -> Renderer&
+{
+    return renderer_;
+}
+
+auto HeadlessApplication::frameTimesMs() const -> const vector<float>&
+{
+    return frameTimesMs_;
+}
+
+} // namespace hlab
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Application.h"
+#include "Camera.h"
+#include "CommandBuffer.h"
+#include "Context.h"
+#include "Image2D.h"
+#include "MappedBuffer.h"
+#include "Model.h"
+#include "Renderer.h"
+#include "ShaderManager.h"
+
+#include <string>
+#include <vector>
+
+namespace hlab {
+
+struct HeadlessConfig
+{
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    uint32_t frameCount = 300;
+    uint32_t framesInFlight = 2;
+
+    // Animation and renderer time advance by a fixed step per frame, so frame n shows the same
+    // scene on every machine regardless of how fast it renders
+    float frameDeltaTime = 1.0f / 60.0f;
+
+    // Frames read back to "<capturePrefix><frame>.png". Empty: nothing is read back.
+    string capturePrefix;
+    uint32_t captureInterval = 0; // Every n-th frame; 0: the last frame only
+
+    int localLightCount = 256;
+    float localLightRange = 4.0f;
+    float localLightIntensity = 20.0f;
+};
+
+// Runs the Renderer without a window or a swapchain: no surface extensions are needed, so it
+// works on machines without a display and on software drivers (lavapipe, selected with
+// VK_ICD_FILENAMES). Frames are drawn into offscreen color images, one per frame slot, and
+// submitted back to back with the same timeline pacing as Application but nothing to present.
+class HeadlessApplication
+{
+  public:
+    HeadlessApplication(const ApplicationConfig& config, const HeadlessConfig& headlessConfig);
+    HeadlessApplication(const HeadlessApplication&) = delete;
+    HeadlessApplication& operator=(const HeadlessApplication&) = delete;
+    ~HeadlessApplication();
+
+    // Renders headlessConfig.frameCount frames and waits for the GPU. With
+    // ApplicationConfig::benchmark enabled, renders the benchmark frames instead and writes
+    // its results.
+    void run();
+
+    // Render options (path, culling, ...) can be set before run()
+    auto renderer() -> Renderer&;
+
+    // CPU time of every frame of the last run(), from the start of one frame to the next
+    auto frameTimesMs() const -> const vector<float>&;
+
+  private:
+    const uint32_t kMaxFramesInFlight = 3;
+    const string kAssetsPathPrefix = "../../assets/";
+    const string kShaderPathPrefix = kAssetsPathPrefix + "shaders/";
+    const VkFormat kColorFormat = VK_FORMAT_R8G8B8A8_SRGB; // Read back as RGBA8 without swizzle
+
+    HeadlessConfig headlessConfig_;
+    uint32_t framesInFlight_{2};
+
+    Context ctx_;
+    ShaderManager shaderManager_;
+
+    Camera camera_;
+    vector<Model> models_{};
+
+    vector<CommandBuffer> commandBuffers_{};
+    vector<Image2D> colorTargets_{}; // Per frame slot, in place of the swapchain images
+    MappedBuffer readbackBuffer_;
+
+    // Same frame timeline as Application: frame k sets it to k when the GPU is done with it
+    VkSemaphore frameTimeline_{VK_NULL_HANDLE};
+    uint64_t frameValue_{0};
+    vector<uint64_t> slotValues_{};
+
+    Renderer renderer_;
+
+    vector<float> frameTimesMs_{};
+    bool localLightsDirty_{true};
+
+    BenchmarkConfig benchmarkConfig_;
+    Benchmark benchmark_;
+
+    ProfilerConfig profilerConfig_; // Only captureAtStart: no hotkey without a window
+    uint32_t traceFramesLeft_{0};
+
+    void updateScene(uint32_t currentFrame, float time, float deltaTime);
+    void waitForFrame(uint64_t value);
+    void recordReadback(VkCommandBuffer cmd, Image2D& colorTarget);
+    void writeCapture(uint32_t frame); // Once the frame with the readback is done
+    void finishBenchmark();
+    void finishTrace();
+};
+
+} // namespace hlab
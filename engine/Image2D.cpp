@@ -23,7 +23,7 @@ Image2D::Image2D(Context& ctx) : ctx_(ctx)
 Image2D::Image2D(Image2D&& other) noexcept
     : ctx_(other.ctx_), image_(other.image_), memory_(other.memory_), imageView_(other.imageView_),
       format_(other.format_), width_(other.width_), height_(other.height_),
-      usageFlags_(other.usageFlags_)
+      usageFlags_(other.usageFlags_), sharedWithCompute_(other.sharedWithCompute_)
 {
     // Reset the moved-from object to a safe state
     other.image_ = VK_NULL_HANDLE;
@@ -305,10 +305,69 @@ void Image2D::createGeneralStorage(uint16_t width, uint32_t height)
                 VK_IMAGE_ASPECT_COLOR_BIT, 1, 1, 0, VK_IMAGE_VIEW_TYPE_2D);
 }
 
+void Image2D::createRenderTarget(VkFormat format, uint32_t width, uint32_t height)
+{
+    // Single-sample color attachment that is sampled by a later pass (e.g. G-buffer)
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    createImage(format, width, height, VK_SAMPLE_COUNT_1_BIT, usage, VK_IMAGE_ASPECT_COLOR_BIT, 1,
+                1, 0, VK_IMAGE_VIEW_TYPE_2D);
+}
+
+void Image2D::createStorage(VkFormat format, uint32_t width, uint32_t height)
+{
+    // Compute-only intermediate that always stays in GENERAL layout (bound as a storage image).
+    // Only formats with mandatory storage support (r32f, rg32f, rgba8, rgba16f, ...) are portable.
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    createImage(format, width, height, VK_SAMPLE_COUNT_1_BIT, usage, VK_IMAGE_ASPECT_COLOR_BIT, 1,
+                1, 0, VK_IMAGE_VIEW_TYPE_2D);
+
+    // Move to GENERAL right away so that descriptor sets created afterwards use STORAGE_IMAGE
+    CommandBuffer cmd = ctx_.createGraphicsCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+    transitionToGeneral(cmd.handle(), VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+                        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    cmd.submitAndWait();
+}
+
 void Image2D::createImage(VkFormat format, uint32_t width, uint32_t height,
                           VkSampleCountFlagBits sampleCount, VkImageUsageFlags usage,
                           VkImageAspectFlags aspectMask, uint32_t mipLevels, uint32_t arrayLayers,
                           VkImageCreateFlags flags, VkImageViewType viewType)
+{
+    createHandle(format, width, height, sampleCount, usage, mipLevels, arrayLayers, flags);
+
+    // Allocate memory
+    VkMemoryRequirements memReqs;
+    vkGetImageMemoryRequirements(ctx_.device(), image_, &memReqs);
+
+    VkMemoryAllocateInfo memAllocInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    memAllocInfo.allocationSize = memReqs.size;
+    memAllocInfo.memoryTypeIndex =
+        ctx_.getMemoryTypeIndex(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    check(vkAllocateMemory(ctx_.device(), &memAllocInfo, nullptr, &memory_));
+    check(vkBindImageMemory(ctx_.device(), image_, memory_, 0));
+
+    createView(aspectMask, mipLevels, arrayLayers, viewType);
+}
+
+void Image2D::createUnbound(VkFormat format, uint32_t width, uint32_t height,
+                            VkSampleCountFlagBits sampleCount, VkImageUsageFlags usage)
+{
+    createHandle(format, width, height, sampleCount, usage, 1, 1, 0);
+}
+
+void Image2D::bindMemory(VkDeviceMemory memory, VkDeviceSize offset)
+{
+    // The memory belongs to the caller, memory_ stays null so cleanup() does not free it
+    check(vkBindImageMemory(ctx_.device(), image_, memory, offset));
+
+    createView(VK_IMAGE_ASPECT_COLOR_BIT, 1, 1, VK_IMAGE_VIEW_TYPE_2D);
+}
+
+void Image2D::createHandle(VkFormat format, uint32_t width, uint32_t height,
+                           VkSampleCountFlagBits sampleCount, VkImageUsageFlags usage,
+                           uint32_t mipLevels, uint32_t arrayLayers, VkImageCreateFlags flags)
 {
     if (width == 0 || height == 0) {
         exitWithMessage("Image dimensions must be greater than zero");
@@ -337,19 +396,20 @@ void Image2D::createImage(VkFormat format, uint32_t width, uint32_t height,
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     imageInfo.flags = flags;
 
-    check(vkCreateImage(ctx_.device(), &imageInfo, nullptr, &image_));
-
-    // Allocate memory
-    VkMemoryRequirements memReqs;
-    vkGetImageMemoryRequirements(ctx_.device(), image_, &memReqs);
+    const vector<uint32_t> queueFamilies =
+        sharedWithCompute_ ? ctx_.sharedQueueFamilyIndices() : vector<uint32_t>{};
+    if (!queueFamilies.empty()) {
+        imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+        imageInfo.pQueueFamilyIndices = queueFamilies.data();
+    }
 
-    VkMemoryAllocateInfo memAllocInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-    memAllocInfo.allocationSize = memReqs.size;
-    memAllocInfo.memoryTypeIndex =
-        ctx_.getMemoryTypeIndex(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    check(vkAllocateMemory(ctx_.device(), &memAllocInfo, nullptr, &memory_));
-    check(vkBindImageMemory(ctx_.device(), image_, memory_, 0));
+    check(vkCreateImage(ctx_.device(), &imageInfo, nullptr, &image_));
+}
 
+void Image2D::createView(VkImageAspectFlags aspectMask, uint32_t mipLevels, uint32_t arrayLayers,
+                         VkImageViewType viewType)
+{
     // Create image view
     VkImageViewCreateInfo viewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
     viewInfo.image = image_;
@@ -367,7 +427,7 @@ void Image2D::createImage(VkFormat format, uint32_t width, uint32_t height,
     resourceBinding_.imageView_ = imageView_;
     resourceBinding_.descriptorCount_ = 1;
     resourceBinding_.update();
-    resourceBinding_.barrierHelper_.update(image_, format, mipLevels, arrayLayers);
+    resourceBinding_.barrierHelper_.update(image_, format_, mipLevels, arrayLayers);
 }
 
 void Image2D::cleanup()
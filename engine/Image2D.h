@@ -27,10 +27,19 @@ class Image2D
     void createRGBA16F(uint16_t width, uint32_t height);
     void createMsaaColorBuffer(uint16_t width, uint32_t height, VkSampleCountFlagBits sampleCount);
     void createGeneralStorage(uint16_t width, uint32_t height);
+    void createRenderTarget(VkFormat format, uint32_t width, uint32_t height);
+    void createStorage(VkFormat format, uint32_t width, uint32_t height);
     void createImage(VkFormat format, uint32_t width, uint32_t height,
                      VkSampleCountFlagBits sampleCount, VkImageUsageFlags usage,
                      VkImageAspectFlags aspectMask, uint32_t mipLevels, uint32_t arrayLayers,
                      VkImageCreateFlags flags, VkImageViewType viewType);
+
+    // Single level 2D image without memory, for memory shared by several images (RenderGraph).
+    // bindMemory() binds it and creates the view; the memory is not freed by cleanup().
+    void createUnbound(VkFormat format, uint32_t width, uint32_t height,
+                       VkSampleCountFlagBits sampleCount, VkImageUsageFlags usage);
+    void bindMemory(VkDeviceMemory memory, VkDeviceSize offset);
+
     void cleanup();
 
     auto image() const -> VkImage;
@@ -48,6 +57,13 @@ class Image2D
         resourceBinding_.setSampler(sampler);
     }
 
+    // Used by both the graphics and the compute queue: created with concurrent sharing when
+    // the queues are of different families. Call before creating the image.
+    void shareWithComputeQueue()
+    {
+        sharedWithCompute_ = true;
+    }
+
     // Primary transition method with automatic ResourceBinding updates
     void transitionTo(VkCommandBuffer cmd, VkAccessFlags2 newAccess, VkImageLayout newLayout,
                       VkPipelineStageFlags2 newStage)
@@ -127,8 +143,15 @@ class Image2D
     uint32_t height_{0};
 
     VkImageUsageFlags usageFlags_{0};
+    bool sharedWithCompute_{false};
     ResourceBinding resourceBinding_;
 
+    void createHandle(VkFormat format, uint32_t width, uint32_t height,
+                      VkSampleCountFlagBits sampleCount, VkImageUsageFlags usage,
+                      uint32_t mipLevels, uint32_t arrayLayers, VkImageCreateFlags flags);
+    void createView(VkImageAspectFlags aspectMask, uint32_t mipLevels, uint32_t arrayLayers,
+                    VkImageViewType viewType);
+
     // Helper method to update ResourceBinding after layout transitions
     void updateResourceBindingAfterTransition()
     {
@@ -99,4 +99,17 @@ void exitWithMessage(std::format_string<Args...> fmt, Args&&... args)
     exit(EXIT_FAILURE);
 }
 
+// Quotes and backslashes escaped, for the JSON files written by Benchmark and Profiler
+inline auto escapeJson(const string& text) -> string
+{
+    string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
 } // namespace hlab
\ No newline at end of file
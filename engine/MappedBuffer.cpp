@@ -161,6 +161,32 @@ void MappedBuffer::createUniformBuffer(VkDeviceSize size, void* data)
     resourceBinding_.update();
 }
 
+// Storage: Coherent (written by the CPU every frame or read back after the fence)
+void MappedBuffer::createStorageBuffer(VkDeviceSize size, void* data)
+{
+    create(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, size, data);
+
+    resourceBinding_.descriptorType_ = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    resourceBinding_.buffer_ = buffer_;
+    resourceBinding_.bufferSize_ = dataSize_;
+    resourceBinding_.descriptorCount_ = 1;
+    resourceBinding_.update();
+}
+
+// Indirect: draw commands written by the CPU, patched by compute shaders (also a storage buffer)
+void MappedBuffer::createIndirectBuffer(VkDeviceSize size, void* data)
+{
+    create(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, size, data);
+
+    resourceBinding_.descriptorType_ = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    resourceBinding_.buffer_ = buffer_;
+    resourceBinding_.bufferSize_ = dataSize_;
+    resourceBinding_.descriptorCount_ = 1;
+    resourceBinding_.update();
+}
+
 void MappedBuffer::updateData(const void* data, VkDeviceSize size, VkDeviceSize offset)
 {
     if (!mapped_ || !data) {
@@ -34,6 +34,8 @@ class MappedBuffer
     void createIndexBuffer(VkDeviceSize size, void* data);
     void createStagingBuffer(VkDeviceSize size, void* data);
     void createUniformBuffer(VkDeviceSize size, void* data);
+    void createStorageBuffer(VkDeviceSize size, void* data);
+    void createIndirectBuffer(VkDeviceSize size, void* data);
     void updateData(const void* data, VkDeviceSize size, VkDeviceSize offset);
     void flush() const;
 
@@ -186,4 +186,20 @@ void Material::writeToCache(const string& cachePath)
     }
 }
 
+void Material::classify()
+{
+    flags_ &= ~sAlphaTested;
+    if (!(flags_ & sTransparent) && ubo_.opacityTextureIndex_ >= 0) {
+        flags_ |= sAlphaTested;
+    }
+}
+
+auto Material::alphaMode() const -> AlphaMode
+{
+    if (flags_ & sTransparent) {
+        return AlphaMode::Blended;
+    }
+    return (flags_ & sAlphaTested) ? AlphaMode::AlphaTested : AlphaMode::Opaque;
+}
+
 } // namespace hlab
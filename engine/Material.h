@@ -59,8 +59,12 @@ class Material
         sCastShadow = 0x1,
         sReceiveShadow = 0x2,
         sTransparent = 0x4,
+        sAlphaTested = 0x8, // Set by classify()
     };
 
+    // Selects the pipeline variant: only AlphaTested and Blended shaders may discard
+    enum class AlphaMode : uint32_t { Opaque = 0, AlphaTested = 1, Blended = 2 };
+
     MaterialUBO ubo_;
     uint32_t flags_ = sCastShadow | sReceiveShadow;
 
@@ -69,6 +73,11 @@ class Material
     void loadFromCache(const string& cachePath);
     void writeToCache(const string& cachePath);
 
+    // Call once loaded: sTransparent means blended, otherwise an opacity texture means
+    // alpha-tested
+    void classify();
+    auto alphaMode() const -> AlphaMode;
+
   private:
 };
 
@@ -99,12 +99,59 @@ void Mesh::calculateBounds()
         minBounds = min(minBounds, vertex.position);
         maxBounds = max(maxBounds, vertex.position);
     }
+
+    // Same influences as the skinning in pbrForward.vert (at most 256 bones, weight > 0)
+    constexpr int32_t kMaxBones = 256;
+    vector<AABB> perBone;
+    unskinnedBounds = AABB(vec3(FLT_MAX), vec3(-FLT_MAX));
+    for (const auto& vertex : vertices_) {
+        bool skinned = false;
+        for (int i = 0; i < 4; i++) {
+            const int32_t bone = vertex.boneIndices[i];
+            if (bone < 0 || bone >= kMaxBones || vertex.boneWeights[i] <= 0.0f) {
+                continue;
+            }
+            if (bone >= int32_t(perBone.size())) {
+                perBone.resize(bone + 1, AABB(vec3(FLT_MAX), vec3(-FLT_MAX)));
+            }
+            perBone[bone].min = min(perBone[bone].min, vertex.position);
+            perBone[bone].max = max(perBone[bone].max, vertex.position);
+            skinned = true;
+        }
+        if (!skinned) {
+            unskinnedBounds.min = min(unskinnedBounds.min, vertex.position);
+            unskinnedBounds.max = max(unskinnedBounds.max, vertex.position);
+        }
+    }
+
+    boneBounds.clear();
+    for (uint32_t bone = 0; bone < uint32_t(perBone.size()); bone++) {
+        if (perBone[bone].min.x <= perBone[bone].max.x) {
+            boneBounds.push_back({bone, perBone[bone]});
+        }
+    }
 }
 
-// Update Mesh::updateWorldBounds implementation
-void Mesh::updateWorldBounds(const glm::mat4& modelMatrix)
+void Mesh::updateWorldBounds(const glm::mat4& modelMatrix, const vector<mat4>& boneMatrices)
 {
-    AABB localBounds(minBounds, maxBounds);
+    if (boneMatrices.empty() || boneBounds.empty()) {
+        AABB localBounds(minBounds, maxBounds);
+        worldBounds = localBounds.transform(modelMatrix);
+        return;
+    }
+
+    AABB localBounds = unskinnedBounds;
+    for (const BoneBounds& b : boneBounds) {
+        const AABB posed =
+            b.bone < boneMatrices.size() ? b.bounds.transform(boneMatrices[b.bone]) : b.bounds;
+        localBounds.min = min(localBounds.min, posed.min);
+        localBounds.max = max(localBounds.max, posed.max);
+    }
+
+    // pbrForward.vert moves skinned vertices by up to 0.01 in y (debug indicator)
+    localBounds.min.y -= 0.01f;
+    localBounds.max.y += 0.01f;
+
     worldBounds = localBounds.transform(modelMatrix);
 }
 
@@ -30,8 +30,11 @@ class Mesh
           indices_(std::move(other.indices_)), materialIndex_(other.materialIndex_),
           vertexBuffer_(other.vertexBuffer_), vertexMemory_(other.vertexMemory_),
           indexBuffer_(other.indexBuffer_), indexMemory_(other.indexMemory_),
-          minBounds(other.minBounds), maxBounds(other.maxBounds), worldBounds(other.worldBounds),
-          isCulled(other.isCulled), noTextureCoords(other.noTextureCoords)
+          minBounds(other.minBounds), maxBounds(other.maxBounds),
+          boneBounds(std::move(other.boneBounds)), unskinnedBounds(other.unskinnedBounds),
+          worldBounds(other.worldBounds),
+          isCulled(other.isCulled), shadowCascadeMask(other.shadowCascadeMask),
+          noTextureCoords(other.noTextureCoords)
     {
         // Reset moved-from object to safe state
         other.vertexBuffer_ = VK_NULL_HANDLE;
@@ -42,6 +45,7 @@ class Mesh
         other.minBounds = vec3(FLT_MAX);
         other.maxBounds = vec3(-FLT_MAX);
         other.isCulled = false;
+        other.shadowCascadeMask = ~0u;
         other.noTextureCoords = false;
     }
 
@@ -67,8 +71,11 @@ class Mesh
             // Copy other members
             minBounds = other.minBounds;
             maxBounds = other.maxBounds;
+            boneBounds = std::move(other.boneBounds);
+            unskinnedBounds = other.unskinnedBounds;
             worldBounds = other.worldBounds;
             isCulled = other.isCulled;
+            shadowCascadeMask = other.shadowCascadeMask;
             noTextureCoords = other.noTextureCoords;
 
             // Reset moved-from object to safe state
@@ -80,6 +87,7 @@ class Mesh
             other.minBounds = vec3(FLT_MAX);
             other.maxBounds = vec3(-FLT_MAX);
             other.isCulled = false;
+            other.shadowCascadeMask = ~0u;
             other.noTextureCoords = false;
         }
         return *this;
@@ -100,18 +108,31 @@ class Mesh
     vec3 minBounds = vec3(FLT_MAX);
     vec3 maxBounds = vec3(-FLT_MAX);
 
+    // Bind pose bounds of the vertices each bone moves. A skinned vertex is a weighted average
+    // of its bones' transforms, so it stays within the union of the posed bone boxes.
+    struct BoneBounds
+    {
+        uint32_t bone;
+        AABB bounds;
+    };
+    vector<BoneBounds> boneBounds{};
+    AABB unskinnedBounds{vec3(FLT_MAX), vec3(-FLT_MAX)}; // Vertices without bone weights
+
     void createBuffers(Context& ctx);
     void cleanup(VkDevice device);
-    void calculateBounds(); // Made public
+    void calculateBounds(); // Bind pose and per bone bounds
 
-    // Update Mesh::updateWorldBounds implementation
-    void updateWorldBounds(const glm::mat4& modelMatrix);
+    // With boneMatrices (the current pose of a skinned model) the bounds follow the pose, in
+    // O(bones) instead of O(vertices). Otherwise the bind pose bounds are transformed.
+    void updateWorldBounds(const glm::mat4& modelMatrix,
+                           const vector<mat4>& boneMatrices = vector<mat4>{});
 
     // World-space bounding box (updated when model matrix changes)
     AABB worldBounds{};
 
     // Check if mesh should be culled
     bool isCulled = false;
+    uint32_t shadowCascadeMask = ~0u; // Bit c: drawn into shadow cascade c (not saved to files)
     bool noTextureCoords = false;
 
     // Binary file I/O methods
@@ -32,8 +32,9 @@ Model::Model(Model&& other) noexcept
       globalInverseTransform_(other.globalInverseTransform_),
       boundingBoxMin_(other.boundingBoxMin_), boundingBoxMax_(other.boundingBoxMax_),
       materialUBO_(std::move(other.materialUBO_)),
-      materialDescriptorSets_(std::move(other.materialDescriptorSets_)), visible_(other.visible_),
-      modelMatrix_(other.modelMatrix_)
+      materialDescriptorSets_(std::move(other.materialDescriptorSets_)),
+      geometryKeys_(std::move(other.geometryKeys_)), materialKeys_(std::move(other.materialKeys_)),
+      visible_(other.visible_), modelMatrix_(other.modelMatrix_)
 {
     // Reset moved-from object to safe state
     other.globalInverseTransform_ = mat4(1.0f);
@@ -96,12 +97,65 @@ void Model::createVulkanResources()
     //    material.createUniformBuffer(ctx_);
     //    material.updateUniformBuffer();
     //}
+
+    calculateInstancingKeys();
+}
+
+// FNV-1a
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+void Model::calculateInstancingKeys()
+{
+    constexpr uint64_t kSeed = 0xcbf29ce484222325ull;
+
+    geometryKeys_.resize(meshes_.size());
+    for (size_t i = 0; i < meshes_.size(); i++) {
+        const Mesh& mesh = meshes_[i];
+        uint64_t hash = hashBytes(kSeed, mesh.vertices_.data(),
+                                  mesh.vertices_.size() * sizeof(Vertex));
+        hash = hashBytes(hash, mesh.indices_.data(), mesh.indices_.size() * sizeof(uint32_t));
+        geometryKeys_[i] = hash;
+    }
+
+    // Field by field (MaterialUBO has padding), textures by file name
+    materialKeys_.resize(materials_.size());
+    for (size_t i = 0; i < materials_.size(); i++) {
+        const Material& mat = materials_[i];
+        const MaterialUBO& ubo = mat.ubo_;
+        uint64_t hash = hashBytes(kSeed, &ubo.emissiveFactor_, sizeof(ubo.emissiveFactor_));
+        hash = hashBytes(hash, &ubo.baseColorFactor_, sizeof(ubo.baseColorFactor_));
+        const float factors[] = {ubo.roughness_, ubo.transparencyFactor_, ubo.discardAlpha_,
+                                 ubo.metallicFactor_};
+        hash = hashBytes(hash, factors, sizeof(factors));
+        hash = hashBytes(hash, &mat.flags_, sizeof(mat.flags_));
+
+        for (int index : {ubo.baseColorTextureIndex_, ubo.emissiveTextureIndex_,
+                          ubo.normalTextureIndex_, ubo.opacityTextureIndex_,
+                          ubo.metallicRoughnessTextureIndex_, ubo.occlusionTextureIndex_}) {
+            if (index >= 0 && index < int(textureFilenames_.size())) {
+                const string& filename = textureFilenames_[index];
+                hash = hashBytes(hash, filename.data(), filename.size());
+            }
+            hash = hashBytes(hash, &index, sizeof(index));
+        }
+        materialKeys_[i] = hash;
+    }
 }
 
 void Model::loadFromModelFile(const string& modelFilename, bool readBistroObj)
 {
     ModelLoader modelLoader(*this);
     modelLoader.loadFromModelFile(modelFilename, readBistroObj);
+    for (Material& material : materials_) {
+        material.classify(); // Also for materials read from older caches
+    }
     createVulkanResources();
 }
 
@@ -75,6 +75,11 @@ class Model
         if (animation_)
             animation_->stop();
     }
+    void resetAnimationTime() // Keeps playing, e.g. to start a benchmark from the same pose
+    {
+        if (animation_)
+            animation_->setCurrentTime(0.0f);
+    }
     bool isAnimationPlaying() const
     {
         return animation_ && animation_->isPlaying();
@@ -110,6 +115,10 @@ class Model
     {
         return meshes_;
     }
+    const vector<Mesh>& meshes() const
+    {
+        return meshes_;
+    }
     vector<Material>& materials()
     {
         return materials_;
@@ -144,6 +153,18 @@ class Model
         return materialDescriptorSets_[mat_index];
     }
 
+    // Content hashes: equal keys mean identical geometry/material (e.g. the same file loaded
+    // into several models), so their draws can be merged into one instanced draw. Geometry
+    // with equal keys is still compared byte by byte before merging (Renderer).
+    uint64_t geometryKey(uint32_t meshIndex) const
+    {
+        return geometryKeys_[meshIndex];
+    }
+    uint64_t materialKey(uint32_t materialIndex) const
+    {
+        return materialKeys_[materialIndex];
+    }
+
     void loadFromModelFile(const string& modelFilename, bool readBistroObj);
 
     auto name() -> string&
@@ -160,6 +181,10 @@ class Model
     {
         return modelMatrix_;
     }
+    auto modelMatrix() const -> const mat4&
+    {
+        return modelMatrix_;
+    }
 
     auto coeffs() -> float*
     {
@@ -189,12 +214,16 @@ class Model
     vector<UniformBuffer<MaterialUBO>> materialUBO_{};
     vector<DescriptorSet> materialDescriptorSets_{};
 
+    vector<uint64_t> geometryKeys_{}; // Per mesh
+    vector<uint64_t> materialKeys_{}; // Per material
+
     string name_{};
     bool visible_ = true;
     mat4 modelMatrix_ = mat4(1.0f);
     float coeffs_[16] = {0.0f}; // 여러가지 옵션에 사용
 
     void calculateBoundingBox();
+    void calculateInstancingKeys();
 };
 
 } // namespace hlab
\ No newline at end of file
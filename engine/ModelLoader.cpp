@@ -1,5 +1,6 @@
 #include "ModelLoader.h"
 #include "Model.h"
+#include "Profiler.h"
 #include <chrono>
 #include <filesystem>
 #include <stb_image.h>
@@ -14,6 +15,8 @@ ModelLoader::ModelLoader(Model& model) : model_(model)
 
 void ModelLoader::loadFromModelFile(const string& modelFilename, bool readBistroObj)
 {
+    HLAB_PROFILE_SCOPE("loadModel");
+
     // Start timer for loading time measurement
     auto startTime = std::chrono::high_resolution_clock::now();
 
@@ -39,6 +42,7 @@ void ModelLoader::loadFromModelFile(const string& modelFilename, bool readBistro
             // Load textures after successful cache load
             model_.textures_.reserve(model_.textureFilenames_.size());
             for (auto& filename : model_.textureFilenames_) {
+                HLAB_PROFILE_SCOPE("loadTexture");
                 string prefix = readBistroObj ? directory_ + "/LowRes/" : "";
                 model_.textures_.emplace_back(model_.ctx_);
                 model_.textures_.back().createTextureFromImage(
@@ -73,7 +77,11 @@ void ModelLoader::loadFromModelFile(const string& modelFilename, bool readBistro
                       aiProcess_FindInvalidData | aiProcess_GenUVCoords;
     }
 
-    const aiScene* scene = importer_.ReadFile(modelFilename, importFlags);
+    const aiScene* scene = nullptr;
+    {
+        HLAB_PROFILE_SCOPE("importModel");
+        scene = importer_.ReadFile(modelFilename, importFlags);
+    }
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         exitWithMessage("ERROR::ASSIMP: {}", importer_.GetErrorString());
@@ -118,12 +126,16 @@ void ModelLoader::loadFromModelFile(const string& modelFilename, bool readBistro
     }
 
     // Now process nodes and meshes - they can use the global bone indices
-    processNode(scene->mRootNode, scene);
+    {
+        HLAB_PROFILE_SCOPE("processNodes");
+        processNode(scene->mRootNode, scene);
+    }
     model_.calculateBoundingBox();
 
     // 안내: Bistro 모델은 파이썬 스크립트로 전처리한 저해상도 텍스쳐를 읽어들입니다.
     model_.textures_.reserve(model_.textureFilenames_.size());
     for (auto& filename : model_.textureFilenames_) {
+        HLAB_PROFILE_SCOPE("loadTexture");
         string prefix = readBistroObj ? directory_ + "/LowRes/" : directory_ + "/";
         model_.textures_.emplace_back(model_.ctx_);
         // Check if this is an embedded texture (indicated by * prefix)
@@ -227,6 +239,8 @@ void ModelLoader::loadFromModelFile(const string& modelFilename, bool readBistro
 
 void ModelLoader::loadFromCache(const string& cacheFilename)
 {
+    HLAB_PROFILE_SCOPE("loadModelCache");
+
     std::ifstream stream(cacheFilename, std::ios::binary);
     if (!stream.is_open()) {
         // Cache file doesn't exist or cannot be opened
@@ -403,6 +417,8 @@ void ModelLoader::loadFromCache(const string& cacheFilename)
 
 void ModelLoader::writeToCache(const string& cacheFilename)
 {
+    HLAB_PROFILE_SCOPE("writeModelCache");
+
     std::ofstream stream(cacheFilename, std::ios::binary);
     if (!stream.is_open()) {
         return; // Cannot create cache file
@@ -1061,6 +1077,8 @@ void ModelLoader::debugWriteEmbeddedTextures() const
 
 void ModelLoader::optimizeMeshesBistro()
 {
+    HLAB_PROFILE_SCOPE("optimizeMeshes");
+
     auto& meshes = model_.meshes_;
     auto& materials = model_.materials_;
 
@@ -46,18 +46,41 @@ void Pipeline::createByName(string pipelineName, optional<VkFormat> outColorForm
         } else {
             exitWithMessage("outColorFormat, depthFormat, and msaaSamples required for {}", name_);
         }
-    } else if (name_ == "shadowMap") {
+    } else if (name_ == "shadowMap" || name_ == "shadowMapAlphaTest") {
         createShadowMap();
-    } else if (name_ == "pbrForward") {
+    } else if (name_ == "pbrForward" || name_ == "pbrForwardAlphaTest" ||
+               name_ == "pbrForwardBlend" || name_ == "pbrForwardDepthEqual") {
         if (outColorFormat.has_value() && depthFormat.has_value() && msaaSamples.has_value()) {
-            createPbrForward(outColorFormat.value(), depthFormat.value(), msaaSamples.value());
+            createPbrForward(outColorFormat.value(), depthFormat.value(), msaaSamples.value(),
+                             name_ == "pbrForwardDepthEqual", name_ == "pbrForwardBlend");
         } else {
             exitWithMessage("outColorFormat, depthFormat, and msaaSamples required for {}", name_);
         }
-    } else if (name_ == "pbrDeferred") {
-        createPbrDeferred();
-    } else if (name_ == "ssao") {
+    } else if (name_ == "depthPrepass") {
+        if (depthFormat.has_value() && msaaSamples.has_value()) {
+            createDepthPrepass(depthFormat.value(), msaaSamples.value());
+        } else {
+            exitWithMessage("depthFormat and msaaSamples required for {}", name_);
+        }
+    } else if (name_ == "pbrDeferred" || name_ == "pbrDeferredAlphaTest") {
+        if (depthFormat.has_value()) {
+            createPbrDeferred(depthFormat.value());
+        } else {
+            exitWithMessage("depthFormat required for {}", name_);
+        }
+    } else if (name_ == "deferredLighting") {
+        // Fullscreen pass without depth attachment (depth is sampled from the G-buffer pass)
+        if (outColorFormat.has_value()) {
+            createPost(outColorFormat.value(), VK_FORMAT_UNDEFINED);
+        } else {
+            exitWithMessage("outColorFormat required for {}", name_);
+        }
+    } else if (name_ == "ssaoDownsample" || name_ == "ssao" || name_ == "ssaoTemporal" ||
+               name_ == "ssaoUpsample") {
         createSsao();
+    } else if (name_ == "clusterLights" || name_ == "depthPyramid" ||
+               name_ == "occlusionCull") {
+        createCompute(); // Layout from reflection (createCommon)
     } else {
         exitWithMessage("Pipeline name not available: {}", pipelineName);
     }
@@ -73,6 +96,11 @@ VkPipelineLayout Pipeline::pipelineLayout() const
     return pipelineLayout_;
 }
 
+VkShaderStageFlags Pipeline::pushConstantStages() const
+{
+    return pushConstantStages_;
+}
+
 ShaderManager& Pipeline::shaderManager()
 {
     return shaderManager_;
@@ -84,6 +112,7 @@ void Pipeline::createCommon()
 
     vector<VkDescriptorSetLayout> layouts = ctx_.descriptorPool().layoutsForPipeline(name_);
     VkPushConstantRange pushConstantRanges = shaderManager_.pushConstantsRange(name_);
+    pushConstantStages_ = pushConstantRanges.size > 0 ? pushConstantRanges.stageFlags : 0;
 
     VkPipelineLayoutCreateInfo pipelineLayoutCI{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
     pipelineLayoutCI.setLayoutCount = uint32_t(layouts.size());
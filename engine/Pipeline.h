@@ -31,7 +31,8 @@ class Pipeline
 
     Pipeline(Pipeline&& other) noexcept
         : ctx_(other.ctx_), name_(std::move(other.name_)), pipelineLayout_(other.pipelineLayout_),
-          pipeline_(other.pipeline_), shaderManager_(other.shaderManager_)
+          pipeline_(other.pipeline_), shaderManager_(other.shaderManager_),
+          pushConstantStages_(other.pushConstantStages_)
     {
         other.pipelineLayout_ = VK_NULL_HANDLE;
         other.pipeline_ = VK_NULL_HANDLE;
@@ -44,6 +45,7 @@ class Pipeline
             name_ = std::move(other.name_);
             pipelineLayout_ = other.pipelineLayout_;
             pipeline_ = other.pipeline_;
+            pushConstantStages_ = other.pushConstantStages_;
             other.pipelineLayout_ = VK_NULL_HANDLE;
             other.pipeline_ = VK_NULL_HANDLE;
             other.name_.clear();
@@ -70,9 +72,13 @@ class Pipeline
     void createSky(VkFormat outColorFormat, VkFormat depthFormat,
                    VkSampleCountFlagBits msaaSamples);
     void createShadowMap();
+    // depthEqual: shading pass after the depth pre-pass (EQUAL test, no depth writes)
+    // alphaBlend: transparent materials (alpha blending)
     void createPbrForward(VkFormat outColorFormat, VkFormat depthFormat,
-                          VkSampleCountFlagBits msaaSamples);
-    void createPbrDeferred();
+                          VkSampleCountFlagBits msaaSamples, bool depthEqual = false,
+                          bool alphaBlend = false);
+    void createDepthPrepass(VkFormat depthFormat, VkSampleCountFlagBits msaaSamples);
+    void createPbrDeferred(VkFormat depthFormat);
     void createSsao();
     void createTriangle(VkFormat outColorFormat);
 
@@ -112,8 +118,13 @@ class Pipeline
     //    vkCmdDraw(cmd, vertexCount, 1, 0, 0);
     //}
 
+    // G-buffer layout shared by the pbrDeferred pipeline and Renderer's render targets
+    // 0: albedo (sRGB), 1: octahedral normal, 2: ao/roughness/metallic/model index, 3: emissive
+    static auto gBufferFormats(Context& ctx) -> array<VkFormat, 4>;
+
     auto pipeline() const -> VkPipeline;
     auto pipelineLayout() const -> VkPipelineLayout;
+    auto pushConstantStages() const -> VkShaderStageFlags; // 0 without push constants
     auto shaderManager() -> ShaderManager&;
 
   private:
@@ -122,6 +133,7 @@ class Pipeline
 
     VkPipelineLayout pipelineLayout_{VK_NULL_HANDLE};
     VkPipeline pipeline_{VK_NULL_HANDLE};
+    VkShaderStageFlags pushConstantStages_{0};
 
     string name_{};
 };
@@ -1,9 +1,190 @@
 #include "Pipeline.h"
+#include "Vertex.h"
+#include <glm/glm.hpp>
 
 namespace hlab {
 
-void Pipeline::createPbrDeferred()
+auto Pipeline::gBufferFormats(Context& ctx) -> array<VkFormat, 4>
 {
+    // 주의: R16G16_SNORM과 B10G11R11 컬러 어태치먼트는 필수 지원 포맷이 아닙니다.
+    //      노멀은 R16G16_SFLOAT에 [-1, 1] 범위로 저장하고, 이미시브는 없으면 RGBA16F를 씁니다.
+    VkFormat emissiveFormat = VK_FORMAT_B10G11R11_UFLOAT_PACK32;
+    VkFormatProperties formatProps;
+    vkGetPhysicalDeviceFormatProperties(ctx.physicalDevice(), emissiveFormat, &formatProps);
+    if (!(formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT)) {
+        emissiveFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    }
+
+    return {VK_FORMAT_R8G8B8A8_SRGB,  // albedo.rgb
+            VK_FORMAT_R16G16_SFLOAT,  // octahedral normal
+            VK_FORMAT_R8G8B8A8_UNORM, // ao, roughness, metallic, model index / 255
+            emissiveFormat};
+}
+
+void Pipeline::createPbrDeferred(VkFormat depthFormat)
+{
+    // G-buffer pass: same vertex shader and descriptor sets as pbrForward, no MSAA
+    // name_ is "pbrDeferred" or "pbrDeferredAlphaTest" (fragment shader variant)
+
+    const VkDevice device = ctx_.device();
+
+    printLog("Creating a graphics pipeline: {}\n", name_);
+
+    vector<VkVertexInputAttributeDescription> vertexInputAttributes =
+        Vertex::getAttributeDescriptions();
+
+    vector<VkPipelineShaderStageCreateInfo> shaderStagesCI =
+        shaderManager_.createPipelineShaderStageCIs(name_);
+
+    const array<VkFormat, 4> gBuffer = gBufferFormats(ctx_);
+    vector<VkFormat> outColorFormats(gBuffer.begin(), gBuffer.end());
+
+    vector<VkVertexInputBindingDescription> vertexInputBindingDesc;
+    vertexInputBindingDesc.resize(1); // Assuming one binding for simplicity
+    vertexInputBindingDesc[0].binding = 0;
+    vertexInputBindingDesc[0].stride = sizeof(Vertex);
+    vertexInputBindingDesc[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    VkPipelineVertexInputStateCreateInfo vertexInputStateCI;
+    vertexInputStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputStateCI.pNext = nullptr;
+    vertexInputStateCI.flags = 0;
+    vertexInputStateCI.vertexBindingDescriptionCount = uint32_t(vertexInputBindingDesc.size());
+    vertexInputStateCI.pVertexBindingDescriptions = vertexInputBindingDesc.data();
+    vertexInputStateCI.vertexAttributeDescriptionCount =
+        static_cast<uint32_t>(vertexInputAttributes.size());
+    vertexInputStateCI.pVertexAttributeDescriptions = vertexInputAttributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCI;
+    inputAssemblyStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssemblyStateCI.pNext = nullptr;
+    inputAssemblyStateCI.flags = 0;
+    inputAssemblyStateCI.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssemblyStateCI.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineRasterizationStateCreateInfo rasterStateCI;
+    rasterStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterStateCI.pNext = nullptr;
+    rasterStateCI.flags = 0;
+    rasterStateCI.depthClampEnable = VK_FALSE;
+    rasterStateCI.rasterizerDiscardEnable = VK_FALSE;
+    rasterStateCI.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterStateCI.cullMode = VK_CULL_MODE_NONE;
+    rasterStateCI.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    rasterStateCI.depthBiasEnable = VK_FALSE;
+    rasterStateCI.depthBiasConstantFactor = 0.0f;
+    rasterStateCI.depthBiasClamp = 0.0f;
+    rasterStateCI.depthBiasSlopeFactor = 0.0f;
+    rasterStateCI.lineWidth = 1.0f;
+
+    VkPipelineColorBlendAttachmentState blendAttachmentState;
+    blendAttachmentState.blendEnable = VK_FALSE;
+    blendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    blendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+    blendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+    blendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    blendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    blendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+    blendAttachmentState.colorWriteMask = 0xf;
+
+    vector<VkPipelineColorBlendAttachmentState> blendAttachmentStates(outColorFormats.size(),
+                                                                      blendAttachmentState);
+
+    VkPipelineColorBlendStateCreateInfo colorBlendStateCI;
+    colorBlendStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlendStateCI.pNext = nullptr;
+    colorBlendStateCI.flags = 0;
+    colorBlendStateCI.logicOpEnable = VK_FALSE;
+    colorBlendStateCI.logicOp = VK_LOGIC_OP_COPY;
+    colorBlendStateCI.attachmentCount = static_cast<uint32_t>(blendAttachmentStates.size());
+    colorBlendStateCI.pAttachments = blendAttachmentStates.data();
+    colorBlendStateCI.blendConstants[0] = 0.0f;
+    colorBlendStateCI.blendConstants[1] = 0.0f;
+    colorBlendStateCI.blendConstants[2] = 0.0f;
+    colorBlendStateCI.blendConstants[3] = 0.0f;
+
+    VkPipelineViewportStateCreateInfo viewportStateCI;
+    viewportStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportStateCI.pNext = nullptr;
+    viewportStateCI.flags = 0;
+    viewportStateCI.viewportCount = 1;
+    viewportStateCI.pViewports = nullptr; // Dynamic
+    viewportStateCI.scissorCount = 1;
+    viewportStateCI.pScissors = nullptr; // Dynamic
+
+    vector<VkDynamicState> dynamicStateEnables_;
+    dynamicStateEnables_ = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+    VkPipelineDynamicStateCreateInfo dynamicStateCI;
+    dynamicStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicStateCI.pNext = nullptr;
+    dynamicStateCI.flags = 0;
+    dynamicStateCI.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables_.size());
+    dynamicStateCI.pDynamicStates = dynamicStateEnables_.data();
+
+    VkPipelineDepthStencilStateCreateInfo depthStencilStateCI;
+    depthStencilStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencilStateCI.pNext = nullptr;
+    depthStencilStateCI.flags = 0;
+    depthStencilStateCI.depthTestEnable = VK_TRUE;
+    depthStencilStateCI.depthWriteEnable = VK_TRUE;
+    depthStencilStateCI.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    depthStencilStateCI.depthBoundsTestEnable = VK_FALSE;
+    depthStencilStateCI.stencilTestEnable = VK_FALSE;
+    depthStencilStateCI.front.failOp = VK_STENCIL_OP_KEEP;
+    depthStencilStateCI.front.passOp = VK_STENCIL_OP_KEEP;
+    depthStencilStateCI.front.depthFailOp = VK_STENCIL_OP_KEEP;
+    depthStencilStateCI.front.compareOp = VK_COMPARE_OP_ALWAYS;
+    depthStencilStateCI.front.compareMask = 0;
+    depthStencilStateCI.front.writeMask = 0;
+    depthStencilStateCI.front.reference = 0;
+    depthStencilStateCI.back = depthStencilStateCI.front;
+    depthStencilStateCI.minDepthBounds = 0.0f;
+    depthStencilStateCI.maxDepthBounds = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisampleStateCI;
+    multisampleStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampleStateCI.pNext = nullptr;
+    multisampleStateCI.flags = 0;
+    multisampleStateCI.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampleStateCI.sampleShadingEnable = VK_FALSE;
+    multisampleStateCI.minSampleShading = 1.0f;
+    multisampleStateCI.pSampleMask = nullptr;
+    multisampleStateCI.alphaToCoverageEnable = VK_FALSE;
+    multisampleStateCI.alphaToOneEnable = VK_FALSE;
+
+    VkPipelineRenderingCreateInfo pipelineRenderingCI;
+    pipelineRenderingCI.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    pipelineRenderingCI.pNext = nullptr;
+    pipelineRenderingCI.viewMask = 0;
+    pipelineRenderingCI.colorAttachmentCount = static_cast<uint32_t>(outColorFormats.size());
+    pipelineRenderingCI.pColorAttachmentFormats = outColorFormats.data();
+    pipelineRenderingCI.depthAttachmentFormat = depthFormat;
+    pipelineRenderingCI.stencilAttachmentFormat = depthFormat;
+
+    VkGraphicsPipelineCreateInfo pipelineCI;
+    pipelineCI.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineCI.pNext = &pipelineRenderingCI;
+    pipelineCI.flags = 0;
+    pipelineCI.stageCount = static_cast<uint32_t>(shaderStagesCI.size());
+    pipelineCI.pStages = shaderStagesCI.data();
+    pipelineCI.pVertexInputState = &vertexInputStateCI;
+    pipelineCI.pInputAssemblyState = &inputAssemblyStateCI;
+    pipelineCI.pTessellationState = nullptr;
+    pipelineCI.pViewportState = &viewportStateCI;
+    pipelineCI.pRasterizationState = &rasterStateCI;
+    pipelineCI.pMultisampleState = &multisampleStateCI;
+    pipelineCI.pDepthStencilState = &depthStencilStateCI;
+    pipelineCI.pColorBlendState = &colorBlendStateCI;
+    pipelineCI.pDynamicState = &dynamicStateCI;
+    pipelineCI.layout = pipelineLayout_;
+    pipelineCI.renderPass = VK_NULL_HANDLE;
+    pipelineCI.subpass = 0;
+    pipelineCI.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineCI.basePipelineIndex = -1;
+
+    check(vkCreateGraphicsPipelines(device, ctx_.pipelineCache(), 1, &pipelineCI, nullptr,
+                                    &pipeline_));
 }
 
 } // namespace hlab
\ No newline at end of file
@@ -5,9 +5,11 @@
 namespace hlab {
 
 void Pipeline::createPbrForward(VkFormat outColorFormat, VkFormat depthFormat,
-                                VkSampleCountFlagBits msaaSamples)
+                                VkSampleCountFlagBits msaaSamples, bool depthEqual,
+                                bool alphaBlend)
 {
-    name_ = "pbrForward";
+    // name_ is "pbrForward", "pbrForwardAlphaTest", "pbrForwardBlend" or "pbrForwardDepthEqual"
+    // (see createByName). They differ in the fragment shader variant and the state below.
 
     const VkDevice device = ctx_.device();
 
@@ -71,12 +73,15 @@ void Pipeline::createPbrForward(VkFormat outColorFormat, VkFormat depthFormat,
     rasterStateCI.lineWidth = 1.0f;
 
     VkPipelineColorBlendAttachmentState blendAttachmentState;
-    blendAttachmentState.blendEnable = VK_FALSE;
-    blendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-    blendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+    blendAttachmentState.blendEnable = alphaBlend ? VK_TRUE : VK_FALSE;
+    blendAttachmentState.srcColorBlendFactor =
+        alphaBlend ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+    blendAttachmentState.dstColorBlendFactor =
+        alphaBlend ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
     blendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
     blendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    blendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    blendAttachmentState.dstAlphaBlendFactor =
+        alphaBlend ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
     blendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
     blendAttachmentState.colorWriteMask = 0xf;
 
@@ -117,8 +122,11 @@ void Pipeline::createPbrForward(VkFormat outColorFormat, VkFormat depthFormat,
     depthStencilStateCI.pNext = nullptr;
     depthStencilStateCI.flags = 0;
     depthStencilStateCI.depthTestEnable = VK_TRUE;
-    depthStencilStateCI.depthWriteEnable = VK_TRUE;
-    depthStencilStateCI.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    // Blended draws keep writing depth: they are sorted back to front, and the sky that is
+    // drawn after the queue must not cover them
+    depthStencilStateCI.depthWriteEnable = depthEqual ? VK_FALSE : VK_TRUE;
+    depthStencilStateCI.depthCompareOp =
+        depthEqual ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS_OR_EQUAL;
     depthStencilStateCI.depthBoundsTestEnable = VK_FALSE;
     depthStencilStateCI.stencilTestEnable = VK_FALSE;
     depthStencilStateCI.front.failOp = VK_STENCIL_OP_KEEP;
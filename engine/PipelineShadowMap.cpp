@@ -6,7 +6,7 @@ namespace hlab {
 
 void Pipeline::createShadowMap()
 {
-    name_ = "shadowMap";
+    // name_ is "shadowMap" or "shadowMapAlphaTest" (opacity cut-out, same state)
 
     const VkDevice device = ctx_.device();
 
@@ -4,6 +4,9 @@ namespace hlab {
 
 void Pipeline::createSsao()
 {
+    // Every SSAO stage (ssaoDownsample, ssao, ssaoTemporal, ssaoUpsample) is a plain compute
+    // pipeline, the layout comes from reflection in createCommon().
+    createCompute();
 }
 
 } // namespace hlab
\ No newline at end of file
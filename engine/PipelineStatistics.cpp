@@ -0,0 +1,147 @@
+#include "PipelineStatistics.h"
+#include "Context.h"
+#include "VulkanTools.h"
+#include "Logger.h"
+#include <algorithm>
+
+namespace hlab {
+
+PipelineStatistics::PipelineStatistics(Context& ctx) : ctx_(ctx)
+{
+}
+
+PipelineStatistics::~PipelineStatistics()
+{
+    cleanup();
+}
+
+void PipelineStatistics::create(uint32_t framesInFlight, uint32_t maxPassesPerFrame)
+{
+    cleanup();
+
+    // Enabled by Context when the device supports it
+    supported_ = ctx_.enabledFeatures().pipelineStatisticsQuery == VK_TRUE;
+    if (!supported_) {
+        printLog("Pipeline statistics queries are not supported on this device");
+        return;
+    }
+
+    maxQueriesPerFrame_ = maxPassesPerFrame;
+
+    VkQueryPoolCreateInfo queryPoolCI{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    queryPoolCI.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    queryPoolCI.queryCount = maxQueriesPerFrame_ * framesInFlight;
+    queryPoolCI.pipelineStatistics = kStatisticFlags;
+    check(vkCreateQueryPool(ctx_.device(), &queryPoolCI, nullptr, &queryPool_));
+
+    framePasses_.resize(framesInFlight);
+}
+
+void PipelineStatistics::cleanup()
+{
+    if (queryPool_ != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(ctx_.device(), queryPool_, nullptr);
+        queryPool_ = VK_NULL_HANDLE;
+    }
+    framePasses_.clear();
+    passOpen_ = false;
+}
+
+void PipelineStatistics::collect(uint32_t frameIndex)
+{
+    if (!supported_ || framePasses_[frameIndex].empty()) {
+        return;
+    }
+
+    const vector<Pass>& passes = framePasses_[frameIndex];
+    const uint32_t firstQuery = frameIndex * maxQueriesPerFrame_;
+    const uint32_t queryCount = passes.back().query - firstQuery + 1;
+
+    // Five statistics and the availability per query
+    constexpr uint32_t kValuesPerQuery = 6;
+    vector<uint64_t> results(queryCount * kValuesPerQuery, 0);
+    VkResult result = vkGetQueryPoolResults(
+        ctx_.device(), queryPool_, firstQuery, queryCount, results.size() * sizeof(uint64_t),
+        results.data(), sizeof(uint64_t) * kValuesPerQuery,
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {
+        check(result);
+    }
+
+    resolvedPasses_.clear();
+    for (const Pass& pass : passes) {
+        const uint64_t* values = &results[(pass.query - firstQuery) * kValuesPerQuery];
+        if (values[5] == 0) {
+            continue; // Not available yet
+        }
+        resolvedPasses_.emplace_back(
+            pass.name, PipelineStats{values[0], values[1], values[2], values[3], values[4]});
+    }
+}
+
+void PipelineStatistics::beginFrame(VkCommandBuffer cmd, uint32_t frameIndex)
+{
+    if (!supported_) {
+        return;
+    }
+
+    frameIndex_ = frameIndex;
+    nextQuery_ = frameIndex * maxQueriesPerFrame_;
+    framePasses_[frameIndex].clear();
+    passOpen_ = false;
+
+    vkCmdResetQueryPool(cmd, queryPool_, nextQuery_, maxQueriesPerFrame_);
+}
+
+void PipelineStatistics::begin(VkCommandBuffer cmd, const string& name)
+{
+    if (!supported_) {
+        return;
+    }
+
+    if (passOpen_) {
+        exitWithMessage("PipelineStatistics: {} begins inside another pass", name);
+    }
+    if (nextQuery_ + 1 > (frameIndex_ + 1) * maxQueriesPerFrame_) {
+        exitWithMessage("PipelineStatistics: too many passes in a frame ({})", name);
+    }
+
+    framePasses_[frameIndex_].push_back(Pass{name, nextQuery_++});
+    passOpen_ = true;
+
+    vkCmdBeginQuery(cmd, queryPool_, framePasses_[frameIndex_].back().query, 0);
+}
+
+void PipelineStatistics::end(VkCommandBuffer cmd)
+{
+    if (!supported_) {
+        return;
+    }
+
+    if (!passOpen_) {
+        exitWithMessage("PipelineStatistics: end() without matching begin()");
+    }
+    passOpen_ = false;
+
+    vkCmdEndQuery(cmd, queryPool_, framePasses_[frameIndex_].back().query);
+}
+
+auto PipelineStatistics::isSupported() const -> bool
+{
+    return supported_;
+}
+
+auto PipelineStatistics::stats(const string& name) const -> PipelineStats
+{
+    auto it = std::find_if(resolvedPasses_.begin(), resolvedPasses_.end(),
+                           [&](const auto& pass) { return pass.first == name; });
+    return it != resolvedPasses_.end() ? it->second : PipelineStats{};
+}
+
+auto PipelineStatistics::resolvedPasses() const -> const vector<pair<string, PipelineStats>>&
+{
+    return resolvedPasses_;
+}
+
+} // namespace hlab
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hlab {
+
+using namespace std;
+
+class Context; // Forward declaration
+
+struct PipelineStats
+{
+    uint64_t inputPrimitives = 0;     // Input assembly
+    uint64_t vertexInvocations = 0;   // Vertex shader
+    uint64_t clippingInvocations = 0; // Primitives that reached clipping (after culling)
+    uint64_t clippingPrimitives = 0;  // Primitives that left clipping
+    uint64_t fragmentInvocations = 0; // Fragment shader, includes overdraw and helper lanes
+};
+
+// VK_QUERY_TYPE_PIPELINE_STATISTICS queries per pass, with the same per frame slot query
+// ranges as GpuTimer: results are read without stalls after the slot's frame has finished.
+// Only one pipeline statistics query can be active at a time, so passes cannot nest.
+// Everything is a no-op when the device lacks pipelineStatisticsQuery.
+class PipelineStatistics
+{
+  public:
+    // Order of the results, see PipelineStats
+    static constexpr VkQueryPipelineStatisticFlags kStatisticFlags =
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+    PipelineStatistics(Context& ctx);
+    PipelineStatistics(const PipelineStatistics&) = delete;
+    PipelineStatistics& operator=(const PipelineStatistics&) = delete;
+    ~PipelineStatistics();
+
+    void create(uint32_t framesInFlight, uint32_t maxPassesPerFrame = 16);
+    void cleanup();
+
+    // Call once the frame of frameIndex has finished on the GPU
+    void collect(uint32_t frameIndex);
+
+    // Resets the query range of frameIndex. Must be recorded before any begin()/end().
+    void beginFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+
+    // Graphics queue only. Render passes executing secondary command buffers inside the pass
+    // need the inheritedQueries feature (see CommandRecorder).
+    void begin(VkCommandBuffer cmd, const string& name);
+    void end(VkCommandBuffer cmd);
+
+    auto isSupported() const -> bool;
+    auto stats(const string& name) const -> PipelineStats; // Last resolved, zero if unknown
+
+    // Passes resolved by the last collect(), in recording order
+    auto resolvedPasses() const -> const vector<pair<string, PipelineStats>>&;
+
+  private:
+    struct Pass
+    {
+        string name;
+        uint32_t query = 0;
+    };
+
+    Context& ctx_;
+
+    VkQueryPool queryPool_{VK_NULL_HANDLE};
+    uint32_t maxQueriesPerFrame_{0};
+    bool supported_{false};
+
+    uint32_t frameIndex_{0};
+    uint32_t nextQuery_{0};
+    bool passOpen_{false};
+    vector<vector<Pass>> framePasses_; // Recorded passes per frame slot
+
+    vector<pair<string, PipelineStats>> resolvedPasses_;
+};
+
+} // namespace hlab
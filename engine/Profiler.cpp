@@ -0,0 +1,108 @@
+#include "Profiler.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+
+namespace hlab {
+
+auto Profiler::instance() -> Profiler&
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::startCapture()
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        for (auto& buffer : threads_) {
+            buffer->written.store(0, memory_order_relaxed);
+        }
+    }
+    captureStart_ = Clock::now();
+    capturing_.store(true, memory_order_release);
+}
+
+void Profiler::stopCapture()
+{
+    capturing_.store(false, memory_order_release);
+}
+
+void Profiler::record(const char* name, Clock::time_point begin, Clock::time_point end)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    const uint64_t index = buffer.written.load(memory_order_relaxed);
+    buffer.zones[index % kZonesPerThread] = Zone{name, begin, end};
+    buffer.written.store(index + 1, memory_order_release);
+}
+
+void Profiler::setThreadName(const string& name)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    lock_guard<mutex> lock(mutex_);
+    buffer.name = name;
+}
+
+auto Profiler::threadBuffer() -> ThreadBuffer&
+{
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        auto newBuffer = make_unique<ThreadBuffer>();
+        newBuffer->zones.resize(kZonesPerThread);
+
+        lock_guard<mutex> lock(mutex_);
+        newBuffer->id = uint32_t(threads_.size());
+        newBuffer->name = std::format("thread {}", newBuffer->id); // Until setThreadName()
+        buffer = newBuffer.get();
+        threads_.push_back(std::move(newBuffer));
+    }
+    return *buffer;
+}
+
+auto Profiler::writeChromeTrace(const string& filename) const -> bool
+{
+    ofstream file(filename);
+    if (!file.is_open()) {
+        printLog("Could not write CPU trace to {}", filename);
+        return false;
+    }
+
+    const auto toUs = [&](Clock::time_point t) {
+        return chrono::duration<double, micro>(t - captureStart_).count();
+    };
+
+    lock_guard<mutex> lock(mutex_);
+    uint64_t zoneCount = 0;
+    bool first = true;
+    file << "{\"traceEvents\": [";
+    for (const auto& buffer : threads_) {
+        file << std::format("{}\n{{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, "
+                            "\"tid\": {}, \"args\": {{\"name\": \"{}\"}}}}",
+                            first ? "" : ",", buffer->id, escapeJson(buffer->name));
+        first = false;
+
+        // Oldest first; zones of earlier captures were discarded by startCapture()
+        const uint64_t written = buffer->written.load(memory_order_acquire);
+        const uint64_t count = std::min(written, uint64_t(kZonesPerThread));
+        for (uint64_t i = written - count; i < written; i++) {
+            const Zone& zone = buffer->zones[i % kZonesPerThread];
+            if (zone.begin < captureStart_) {
+                continue; // Opened before the capture started
+            }
+            file << std::format(",\n{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": 0, \"tid\": {}, "
+                                "\"ts\": {:.3f}, \"dur\": {:.3f}}}",
+                                escapeJson(zone.name), buffer->id, toUs(zone.begin),
+                                toUs(zone.end) - toUs(zone.begin));
+        }
+        zoneCount += count;
+    }
+    file << "\n]}\n";
+
+    printLog("CPU trace: {} zones of {} threads written to {}", zoneCount, threads_.size(),
+             filename);
+    return true;
+}
+
+} // namespace hlab
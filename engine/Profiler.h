@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hlab {
+
+using namespace std;
+
+struct ProfilerConfig
+{
+    bool captureAtStart = false; // e.g. from the command line; otherwise started with F9
+    uint32_t captureFrames = 120;
+    string outputFile = "trace.json"; // Open in chrome://tracing or ui.perfetto.dev
+};
+
+// CPU zone profiler. HLAB_PROFILE_SCOPE("name") records the enclosing scope into a ring buffer
+// of the calling thread, so worker threads never contend for a lock. Zones are only recorded
+// during a capture; otherwise a zone costs one relaxed atomic load. Without HLAB_PROFILER
+// (CMake option of the same name) the macros compile to nothing.
+//
+// Start and stop captures and write the trace between frames, while no other thread records.
+class Profiler
+{
+  public:
+    using Clock = chrono::steady_clock;
+
+    static auto instance() -> Profiler&;
+
+    void startCapture(); // Discards zones of the previous capture
+    void stopCapture();
+    auto isCapturing() const -> bool
+    {
+        return capturing_.load(memory_order_relaxed);
+    }
+
+    void record(const char* name, Clock::time_point begin, Clock::time_point end);
+    // Of the calling thread, shown in the trace. Ids follow the order in which threads first
+    // record or name themselves, so the main thread names itself at startup as well.
+    void setThreadName(const string& name);
+
+    // Chrome trace event format ("X" complete events, one track per thread)
+    auto writeChromeTrace(const string& filename) const -> bool;
+
+  private:
+    static constexpr uint32_t kZonesPerThread = 1 << 16; // Oldest zones are overwritten
+
+    struct Zone
+    {
+        const char* name; // String literals only, the trace is written later
+        Clock::time_point begin;
+        Clock::time_point end;
+    };
+
+    struct ThreadBuffer
+    {
+        string name;
+        uint32_t id = 0;
+        vector<Zone> zones;
+        atomic<uint64_t> written{0};
+    };
+
+    atomic<bool> capturing_{false};
+    Clock::time_point captureStart_;
+
+    mutable mutex mutex_; // Guards threads_
+    vector<unique_ptr<ThreadBuffer>> threads_; // Outlive their threads
+
+    auto threadBuffer() -> ThreadBuffer&;
+};
+
+class ProfileZone
+{
+  public:
+    explicit ProfileZone(const char* name)
+        : name_(Profiler::instance().isCapturing() ? name : nullptr)
+    {
+        if (name_) {
+            begin_ = Profiler::Clock::now();
+        }
+    }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+    ~ProfileZone()
+    {
+        if (name_) {
+            Profiler::instance().record(name_, begin_, Profiler::Clock::now());
+        }
+    }
+
+  private:
+    const char* name_;
+    Profiler::Clock::time_point begin_;
+};
+
+} // namespace hlab
+
+#if defined(HLAB_PROFILER)
+#define HLAB_PROFILE_CONCAT_IMPL(a, b) a##b
+#define HLAB_PROFILE_CONCAT(a, b) HLAB_PROFILE_CONCAT_IMPL(a, b)
+#define HLAB_PROFILE_SCOPE(name)                                                                   \
+    ::hlab::ProfileZone HLAB_PROFILE_CONCAT(profileZone, __LINE__)(name)
+// Zone measured by the caller, e.g. a phase between two existing time points
+#define HLAB_PROFILE_ZONE(name, begin, end)                                                        \
+    do {                                                                                           \
+        if (::hlab::Profiler::instance().isCapturing()) {                                          \
+            ::hlab::Profiler::instance().record(name, begin, end);                                 \
+        }                                                                                          \
+    } while (0)
+#else
+#define HLAB_PROFILE_SCOPE(name)
+#define HLAB_PROFILE_ZONE(name, begin, end)
+#endif
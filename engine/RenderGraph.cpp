@@ -0,0 +1,359 @@
+#include "RenderGraph.h"
+#include "Context.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <map>
+
+namespace hlab {
+
+RenderGraph::RenderGraph(Context& ctx) : ctx_(ctx)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+    cleanup();
+}
+
+struct UsageState
+{
+    VkImageLayout layout;
+    VkPipelineStageFlags2 stage;
+    VkAccessFlags2 access;
+};
+
+static auto usageState(RenderGraph::Usage usage) -> UsageState
+{
+    switch (usage) {
+    case RenderGraph::Usage::ColorAttachment:
+        return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT};
+    case RenderGraph::Usage::DepthAttachment:
+        return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                    VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+    case RenderGraph::Usage::DepthResolve:
+        // The multisample depth resolve writes it in the color attachment output stage
+        return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                    VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                    VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT};
+    case RenderGraph::Usage::DepthReadOnly:
+        return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
+                    VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                    VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT};
+    case RenderGraph::Usage::SampledFragment:
+        return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_2_SHADER_READ_BIT};
+    case RenderGraph::Usage::SampledCompute:
+        return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                VK_ACCESS_2_SHADER_READ_BIT};
+    }
+    return {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+            VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT};
+}
+
+static auto isWrite(VkAccessFlags2 access) -> bool
+{
+    const VkAccessFlags2 writes =
+        VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+        VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+    return (access & writes) != 0;
+}
+
+auto RenderGraph::importImage(const string& name, BarrierHelper& barrierHelper) -> uint32_t
+{
+    Resource resource;
+    resource.name = name;
+    resource.barrierHelper = &barrierHelper;
+    resources_.push_back(std::move(resource));
+    return uint32_t(resources_.size() - 1);
+}
+
+auto RenderGraph::addTransientImage(const string& name, Image2D& image, bool lazy) -> uint32_t
+{
+    Resource resource;
+    resource.name = name;
+    resource.barrierHelper = &image.barrierHelper();
+    resource.image = image.image();
+    resource.bindMemory = [&image](VkDeviceMemory memory, VkDeviceSize offset) {
+        image.bindMemory(memory, offset);
+    };
+    resource.lazy = lazy;
+    resources_.push_back(std::move(resource));
+    return uint32_t(resources_.size() - 1);
+}
+
+auto RenderGraph::addTransientImage(const string& name, DepthStencil& image, bool lazy)
+    -> uint32_t
+{
+    Resource resource;
+    resource.name = name;
+    resource.barrierHelper = &image.barrierHelper_;
+    resource.image = image.image;
+    resource.bindMemory = [&image](VkDeviceMemory memory, VkDeviceSize offset) {
+        image.bindMemory(memory, offset);
+    };
+    resource.lazy = lazy;
+    resources_.push_back(std::move(resource));
+    return uint32_t(resources_.size() - 1);
+}
+
+auto RenderGraph::addPass(const string& name, vector<Access> accesses) -> uint32_t
+{
+    for (const Access& access : accesses) {
+        if (access.resource >= resources_.size()) {
+            exitWithMessage("Render graph pass {} uses an unknown resource", name);
+        }
+    }
+
+    passes_.push_back({name, std::move(accesses)});
+    return uint32_t(passes_.size() - 1);
+}
+
+auto RenderGraph::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) -> uint32_t
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(ctx_.physicalDevice(), &memoryProperties);
+
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeBits & (1u << i)) != 0 &&
+            (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    return uint32_t(-1);
+}
+
+void RenderGraph::compile()
+{
+    const VkDevice device = ctx_.device();
+
+    // Lifetime of a transient image: from the first to the last pass that uses it
+    for (Resource& resource : resources_) {
+        resource.firstPass = uint32_t(passes_.size());
+        resource.lastPass = 0;
+    }
+    for (uint32_t p = 0; p < uint32_t(passes_.size()); p++) {
+        for (const Access& access : passes_[p].accesses) {
+            Resource& resource = resources_[access.resource];
+            resource.firstPass = std::min(resource.firstPass, p);
+            resource.lastPass = std::max(resource.lastPass, p);
+        }
+    }
+
+    stats_ = Stats{};
+    map<uint32_t, vector<uint32_t>> heaps; // Transient images per memory type
+
+    for (uint32_t r = 0; r < uint32_t(resources_.size()); r++) {
+        Resource& resource = resources_[r];
+        if (!resource.isTransient()) {
+            continue;
+        }
+        if (resource.firstPass > resource.lastPass) {
+            // Not used by any pass, keep it apart from everything
+            resource.firstPass = 0;
+            resource.lastPass = uint32_t(passes_.size());
+        }
+
+        vkGetImageMemoryRequirements(device, resource.image, &resource.requirements);
+        stats_.transientBytes += resource.requirements.size;
+
+        if (resource.lazy) {
+            const uint32_t lazyType = findMemoryType(resource.requirements.memoryTypeBits,
+                                                     VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+            if (lazyType != uint32_t(-1)) {
+                VkMemoryAllocateInfo memAlloc{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+                memAlloc.allocationSize = resource.requirements.size;
+                memAlloc.memoryTypeIndex = lazyType;
+                VkDeviceMemory memory{VK_NULL_HANDLE};
+                check(vkAllocateMemory(device, &memAlloc, nullptr, &memory));
+                memory_.push_back(memory);
+
+                resource.bindMemory(memory, 0);
+                stats_.allocatedBytes += resource.requirements.size;
+                stats_.lazyBytes += resource.requirements.size;
+                continue;
+            }
+        }
+
+        const uint32_t memoryType = ctx_.getMemoryTypeIndex(resource.requirements.memoryTypeBits,
+                                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        heaps[memoryType].push_back(r);
+    }
+
+    const auto lifetimesOverlap = [&](const Resource& a, const Resource& b) {
+        return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+    };
+    const auto memoryOverlaps = [&](const Resource& a, const Resource& b) {
+        return a.offset < b.offset + b.requirements.size &&
+               b.offset < a.offset + a.requirements.size;
+    };
+
+    for (auto& [memoryType, members] : heaps) {
+        // Largest first; each image takes the lowest offset that no image alive at the same
+        // time occupies
+        std::sort(members.begin(), members.end(), [&](uint32_t a, uint32_t b) {
+            return resources_[a].requirements.size > resources_[b].requirements.size;
+        });
+
+        VkDeviceSize heapSize = 0;
+        for (size_t i = 0; i < members.size(); i++) {
+            Resource& resource = resources_[members[i]];
+            const VkDeviceSize alignment = resource.requirements.alignment;
+            resource.offset = 0;
+
+            bool moved = true;
+            while (moved) {
+                moved = false;
+                for (size_t j = 0; j < i; j++) {
+                    const Resource& placed = resources_[members[j]];
+                    if (lifetimesOverlap(resource, placed) && memoryOverlaps(resource, placed)) {
+                        const VkDeviceSize end = placed.offset + placed.requirements.size;
+                        resource.offset = (end + alignment - 1) / alignment * alignment;
+                        moved = true;
+                    }
+                }
+            }
+            heapSize = std::max(heapSize, resource.offset + resource.requirements.size);
+        }
+
+        VkMemoryAllocateInfo memAlloc{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+        memAlloc.allocationSize = heapSize;
+        memAlloc.memoryTypeIndex = memoryType;
+        VkDeviceMemory memory{VK_NULL_HANDLE};
+        check(vkAllocateMemory(device, &memAlloc, nullptr, &memory));
+        memory_.push_back(memory);
+        stats_.allocatedBytes += heapSize;
+
+        for (uint32_t r : members) {
+            Resource& resource = resources_[r];
+            resource.bindMemory(memory, resource.offset);
+            for (uint32_t other : members) {
+                if (other != r && memoryOverlaps(resource, resources_[other])) {
+                    resource.aliases.push_back(other);
+                }
+            }
+        }
+    }
+
+    const double toMb = 1.0 / (1024.0 * 1024.0);
+    printLog("Render graph: {} passes, transient images {:.1f} MB in {:.1f} MB ({:.1f} MB lazy)",
+             passes_.size(), double(stats_.transientBytes) * toMb,
+             double(stats_.allocatedBytes) * toMb, double(stats_.lazyBytes) * toMb);
+}
+
+void RenderGraph::cleanup()
+{
+    for (VkDeviceMemory memory : memory_) {
+        vkFreeMemory(ctx_.device(), memory, nullptr);
+    }
+    memory_.clear();
+
+    resources_.clear();
+    passes_.clear();
+    nextPass_ = 0;
+    frameStats_ = Stats{};
+    stats_ = Stats{};
+}
+
+void RenderGraph::beginFrame()
+{
+    stats_.barriers = frameStats_.barriers;
+    stats_.barrierBatches = frameStats_.barrierBatches;
+    frameStats_ = Stats{};
+
+    for (Resource& resource : resources_) {
+        resource.used = false;
+    }
+    nextPass_ = 0;
+}
+
+void RenderGraph::beginPass(VkCommandBuffer cmd, uint32_t pass, BarrierBatch& barriers)
+{
+    if (pass < nextPass_) {
+        exitWithMessage("Render graph pass {} is recorded out of order", passes_[pass].name);
+    }
+    nextPass_ = pass + 1;
+
+    uint32_t derived = 0;
+    for (const Access& access : passes_[pass].accesses) {
+        Resource& resource = resources_[access.resource];
+        BarrierHelper& helper = *resource.barrierHelper;
+        const UsageState state = usageState(access.usage);
+
+        if (helper.currentStage() != resource.trackedStage ||
+            helper.currentAccess() != resource.trackedAccess ||
+            helper.currentLayout() != resource.trackedLayout) {
+            resource.visibleStages = VK_PIPELINE_STAGE_2_NONE;
+            resource.visibleAccess = VK_ACCESS_2_NONE;
+        }
+
+        if (resource.isTransient() && !resource.used) {
+            // Contents are not needed, but the last users of the memory have to be done
+            VkPipelineStageFlags2 stage = helper.currentStage();
+            VkAccessFlags2 accessMask = helper.currentAccess();
+            for (uint32_t alias : resource.aliases) {
+                stage |= resources_[alias].barrierHelper->currentStage();
+                accessMask |= resources_[alias].barrierHelper->currentAccess();
+            }
+            helper.currentLayout() = VK_IMAGE_LAYOUT_UNDEFINED;
+            helper.currentStage() = stage;
+            helper.currentAccess() = accessMask;
+            barriers.add(helper.prepareBarrier(state.layout, state.access, state.stage));
+            resource.visibleStages = state.stage;
+            resource.visibleAccess = state.access;
+            derived++;
+        } else if (helper.currentLayout() != state.layout || isWrite(state.access) ||
+                   isWrite(helper.currentAccess())) {
+            barriers.add(helper.prepareBarrier(state.layout, state.access, state.stage));
+            resource.visibleStages = state.stage;
+            resource.visibleAccess = state.access;
+            derived++;
+        } else if ((state.stage & ~resource.visibleStages) != 0 ||
+                   (state.access & ~resource.visibleAccess) != 0) {
+            // Read after read in the same layout, but the last write is not visible to this
+            // stage yet. The earlier reads waited for the write, so waiting for them chains
+            // the dependency; the next writer then waits for all readers.
+            const VkPipelineStageFlags2 readStages = helper.currentStage();
+            const VkAccessFlags2 readAccess = helper.currentAccess();
+            barriers.add(helper.prepareBarrier(state.layout, state.access, state.stage));
+            helper.currentStage() |= readStages;
+            helper.currentAccess() |= readAccess;
+            resource.visibleStages |= state.stage;
+            resource.visibleAccess |= state.access;
+            derived++;
+        } else {
+            // Read after read that the last write is already visible to
+            helper.currentStage() |= state.stage;
+            helper.currentAccess() |= state.access;
+        }
+        resource.used = true;
+        resource.trackedStage = helper.currentStage();
+        resource.trackedAccess = helper.currentAccess();
+        resource.trackedLayout = helper.currentLayout();
+    }
+
+    if (barriers.empty()) {
+        return;
+    }
+    barriers.flush(cmd);
+
+    frameStats_.barriers += derived;
+    frameStats_.barrierBatches++;
+}
+
+auto RenderGraph::stats() const -> const Stats&
+{
+    return stats_;
+}
+
+} // namespace hlab
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "BarrierHelper.h"
+#include "DepthStencil.h"
+#include "Image2D.h"
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace hlab {
+
+using namespace std;
+
+// Frame graph of the main passes. Passes declare how they use each image, and beginPass()
+// records the barriers derived from that as one batched vkCmdPipelineBarrier2, together with
+// the barriers the caller has collected for the pass.
+//
+// The passes are declared once in execution order and may be skipped per frame (e.g. forward
+// or deferred), but not reordered. Transient images do not keep their contents between frames:
+// their first use in a frame starts from UNDEFINED, and transient images whose passes never
+// overlap share memory. With lazy, a transient attachment gets lazily allocated memory when the
+// device has it (tile based GPUs keep MSAA attachments on chip).
+class RenderGraph
+{
+  public:
+    // How a pass uses an image; determines layout, stages and accesses
+    enum class Usage {
+        ColorAttachment, // Written (and resolved into) by the color attachment output
+        DepthAttachment, // Depth test and write
+        DepthResolve,    // Target of a multisample depth resolve
+        DepthReadOnly,   // Read-only depth attachment, sampled at the same time
+        SampledFragment,
+        SampledCompute,
+    };
+
+    struct Access
+    {
+        uint32_t resource;
+        Usage usage;
+    };
+
+    struct Stats
+    {
+        uint32_t barriers{0};       // Image barriers derived in the last frame
+        uint32_t barrierBatches{0}; // vkCmdPipelineBarrier2 calls of beginPass()
+        VkDeviceSize transientBytes{0}; // Transient images with a dedicated allocation each
+        VkDeviceSize allocatedBytes{0}; // Memory actually allocated for them
+        VkDeviceSize lazyBytes{0};      // Part of allocatedBytes that is lazily allocated
+    };
+
+    RenderGraph(Context& ctx);
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+    ~RenderGraph();
+
+    // Persistent image, transitioned through its own barrier helper so that code outside of
+    // the graph sees the same state
+    auto importImage(const string& name, BarrierHelper& barrierHelper) -> uint32_t;
+
+    // Created with createUnbound(), the graph binds the memory in compile()
+    auto addTransientImage(const string& name, Image2D& image, bool lazy = false) -> uint32_t;
+    auto addTransientImage(const string& name, DepthStencil& image, bool lazy = false)
+        -> uint32_t;
+
+    auto addPass(const string& name, vector<Access> accesses) -> uint32_t;
+
+    // Lifetimes of the transient images and their memory. Call after all passes are added.
+    void compile();
+    void cleanup();
+
+    void beginFrame();
+    void beginPass(VkCommandBuffer cmd, uint32_t pass, BarrierBatch& barriers);
+
+    auto stats() const -> const Stats&;
+
+  private:
+    struct Resource
+    {
+        string name;
+        BarrierHelper* barrierHelper{nullptr};
+
+        // Transient images only
+        VkImage image{VK_NULL_HANDLE};
+        function<void(VkDeviceMemory, VkDeviceSize)> bindMemory;
+        bool lazy{false};
+        uint32_t firstPass{0};
+        uint32_t lastPass{0};
+        VkMemoryRequirements requirements{};
+        VkDeviceSize offset{0};
+        vector<uint32_t> aliases; // Transient images sharing some of its memory
+        bool used{false};         // Used in this frame
+
+        // Reads the last write has been made visible to, and the helper state the graph left
+        // (a barrier recorded outside of the graph makes them unknown)
+        VkPipelineStageFlags2 visibleStages{VK_PIPELINE_STAGE_2_NONE};
+        VkAccessFlags2 visibleAccess{VK_ACCESS_2_NONE};
+        VkPipelineStageFlags2 trackedStage{VK_PIPELINE_STAGE_2_NONE};
+        VkAccessFlags2 trackedAccess{VK_ACCESS_2_NONE};
+        VkImageLayout trackedLayout{VK_IMAGE_LAYOUT_UNDEFINED};
+
+        auto isTransient() const -> bool
+        {
+            return bool(bindMemory);
+        }
+    };
+
+    struct Pass
+    {
+        string name;
+        vector<Access> accesses;
+    };
+
+    Context& ctx_;
+
+    vector<Resource> resources_;
+    vector<Pass> passes_;
+    vector<VkDeviceMemory> memory_;
+
+    uint32_t nextPass_{0};
+    Stats frameStats_; // Being recorded
+    Stats stats_;      // Last frame
+
+    auto findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) -> uint32_t;
+};
+
+} // namespace hlab
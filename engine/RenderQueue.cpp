@@ -0,0 +1,115 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <array>
+
+namespace hlab {
+
+auto RenderQueueStats::operator+=(const RenderQueueStats& other) -> RenderQueueStats&
+{
+    draws += other.draws;
+    instances += other.instances;
+    pipelineBinds += other.pipelineBinds;
+    descriptorSetBinds += other.descriptorSetBinds;
+    pushConstantUpdates += other.pushConstantUpdates;
+    vertexBufferBinds += other.vertexBufferBinds;
+    indexBufferBinds += other.indexBufferBinds;
+    skippedBinds += other.skippedBinds;
+    secondaryCommandBuffers += other.secondaryCommandBuffers;
+    passesRecorded += other.passesRecorded;
+    passesReused += other.passesReused;
+    recordMs += other.recordMs;
+    return *this;
+}
+
+auto RenderQueue::makeKey(Queue queue, uint32_t variant, uint32_t material, uint32_t geometry,
+                          float depth01) -> uint64_t
+{
+    const uint64_t depthMax = (1ull << kDepthBits) - 1;
+    const uint64_t depth = uint64_t(std::clamp(depth01, 0.0f, 1.0f) * float(depthMax));
+
+    const uint64_t v = variant & ((1u << kVariantBits) - 1);
+    const uint64_t m = material & ((1u << kMaterialBits) - 1);
+    const uint64_t g = geometry & ((1u << kGeometryBits) - 1);
+    const uint64_t state = (v << (kMaterialBits + kGeometryBits)) | (m << kGeometryBits) | g;
+
+    if (queue == Queue::Transparent) {
+        // Back to front: farther draws get smaller keys
+        return (uint64_t(queue) << 62) | ((depthMax - depth) << 46) | state;
+    }
+    return (uint64_t(queue) << 62) | (state << kDepthBits) | depth;
+}
+
+auto RenderQueue::queueOf(uint64_t key) -> Queue
+{
+    return Queue(key >> 62);
+}
+
+auto RenderQueue::variantOf(uint64_t key) -> uint32_t
+{
+    const uint32_t shift = queueOf(key) == Queue::Transparent
+                               ? kMaterialBits + kGeometryBits
+                               : kMaterialBits + kGeometryBits + kDepthBits;
+    return uint32_t(key >> shift) & ((1u << kVariantBits) - 1);
+}
+
+auto RenderQueue::stateOf(uint64_t key) -> uint64_t
+{
+    const uint64_t depthMax = (1ull << kDepthBits) - 1;
+    return queueOf(key) == Queue::Transparent ? key & ~(depthMax << 46) : key & ~depthMax;
+}
+
+void RenderQueue::clear()
+{
+    items_.clear();
+}
+
+void RenderQueue::add(uint64_t key, uint32_t modelIndex, uint32_t meshIndex)
+{
+    items_.push_back({key, modelIndex, meshIndex});
+}
+
+void RenderQueue::sort()
+{
+    const size_t count = items_.size();
+    if (count < 2) {
+        return;
+    }
+
+    // Histograms of all eight bytes in one pass
+    array<array<uint32_t, 256>, 8> histograms{};
+    for (const DrawItem& item : items_) {
+        for (uint32_t b = 0; b < 8; b++) {
+            histograms[b][(item.key >> (b * 8)) & 0xff]++;
+        }
+    }
+
+    scratch_.resize(count);
+    for (uint32_t b = 0; b < 8; b++) {
+        auto& histogram = histograms[b];
+
+        // Every key has the same byte here (common for the unused high bits): nothing to do
+        if (histogram[(items_[0].key >> (b * 8)) & 0xff] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t& bucket : histogram) {
+            const uint32_t bucketCount = bucket;
+            bucket = offset;
+            offset += bucketCount;
+        }
+
+        for (const DrawItem& item : items_) {
+            scratch_[histogram[(item.key >> (b * 8)) & 0xff]++] = item;
+        }
+        items_.swap(scratch_);
+    }
+}
+
+auto RenderQueue::items() const -> const vector<DrawItem>&
+{
+    return items_;
+}
+
+} // namespace hlab
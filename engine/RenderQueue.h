@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace hlab {
+
+using namespace std;
+
+// One visible mesh of one model
+struct DrawItem
+{
+    uint64_t key = 0;
+    uint32_t modelIndex = 0;
+    uint32_t meshIndex = 0;
+};
+
+// Commands recorded from the render queue in one frame (all passes)
+struct RenderQueueStats
+{
+    uint32_t draws = 0;     // Draw calls
+    uint32_t instances = 0; // Meshes drawn (more than draws when instancing merges them)
+    uint32_t pipelineBinds = 0;
+    uint32_t descriptorSetBinds = 0; // vkCmdBindDescriptorSets calls
+    uint32_t pushConstantUpdates = 0;
+    uint32_t vertexBufferBinds = 0;
+    uint32_t indexBufferBinds = 0;
+    uint32_t skippedBinds = 0; // Binds avoided because the previous draw used the same state
+    uint32_t secondaryCommandBuffers = 0; // Zero when every pass was recorded inline
+    uint32_t passesRecorded = 0;          // Passes whose commands were recorded this frame
+    uint32_t passesReused = 0;            // Passes that executed cached secondaries
+    float recordMs = 0.0f;                // CPU time spent recording the queues
+
+    auto operator+=(const RenderQueueStats& other) -> RenderQueueStats&;
+};
+
+// Draws ordered by 64-bit sort keys (MSB first):
+//   Opaque:      queue(2) | variant(6) | material(20) | geometry(20) | depth(16), front to back
+//   Transparent: queue(2) | inverted depth(16) | variant(6) | material(20) | geometry(20)
+// so that state changes are minimized for opaque draws and blending order is kept for
+// transparent ones. Material and geometry ids wrap around; that only affects grouping.
+class RenderQueue
+{
+  public:
+    enum class Queue : uint32_t { Opaque = 0, Transparent = 1 };
+
+    static constexpr uint32_t kVariantBits = 6;
+    static constexpr uint32_t kMaterialBits = 20;
+    static constexpr uint32_t kGeometryBits = 20;
+    static constexpr uint32_t kDepthBits = 16;
+
+    // depth01: normalized view depth, 0 at the near plane
+    static auto makeKey(Queue queue, uint32_t variant, uint32_t material, uint32_t geometry,
+                        float depth01) -> uint64_t;
+    static auto queueOf(uint64_t key) -> Queue;
+    static auto variantOf(uint64_t key) -> uint32_t;
+    static auto stateOf(uint64_t key) -> uint64_t; // Key without depth: queue, pipeline, material
+
+    void clear();
+    void add(uint64_t key, uint32_t modelIndex, uint32_t meshIndex);
+    void sort(); // Stable LSD radix sort on the keys
+
+    auto items() const -> const vector<DrawItem>&;
+
+  private:
+    vector<DrawItem> items_;
+    vector<DrawItem> scratch_; // Kept to avoid reallocating every frame
+};
+
+} // namespace hlab
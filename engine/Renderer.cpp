@@ -1,5 +1,13 @@
 #include "Renderer.h"
+#include "Profiler.h"
 #include <stb_image.h>
+#include <glm/gtc/constants.hpp>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <random>
+#include <tuple>
 
 namespace hlab {
 
@@ -9,18 +17,80 @@ Renderer::Renderer(Context& ctx, ShaderManager& shaderManager, const uint32_t& k
       kAssetsPathPrefix_(kAssetsPathPrefix), kShaderPathPrefix_(kShaderPathPrefix_),
       dummyTexture_(ctx), msaaColorBuffer_(ctx), depthStencil_(ctx), msaaDepthStencil_(ctx),
       skyTextures_(ctx), shadowMap_(ctx), samplerLinearRepeat_(ctx), samplerLinearClamp_(ctx),
-      samplerAnisoRepeat_(ctx), samplerAnisoClamp_(ctx), forwardToCompute_(ctx), computeToPost_(ctx)
+      samplerAnisoRepeat_(ctx), samplerAnisoClamp_(ctx), forwardToCompute_(ctx),
+      gBufferAlbedo_(ctx), gBufferNormal_(ctx), gBufferMaterial_(ctx), gBufferEmissive_(ctx),
+      ssaoDepth_(ctx), ssaoNormal_(ctx), ssaoRaw_(ctx), ssaoHistory_{ctx, ctx}, ssaoFull_(ctx),
+      renderGraph_(ctx), clusterLightCounts_(ctx), clusterLightIndices_(ctx),
+      gpuTimer_(ctx), pipelineStatistics_(ctx), depthPyramid_(ctx), visibilityHistory_(ctx),
+      commandRecorder_(ctx, workerPool_)
 {
 }
 
+auto Renderer::pipelineShaders() -> vector<pair<string, vector<string>>>
+{
+    return {{"shadowMap", {"shadowMap.vert.spv", "shadowMap.frag.spv"}},
+            {"shadowMapAlphaTest", {"shadowMapAlphaTest.vert.spv", "shadowMapAlphaTest.frag.spv"}},
+            {"pbrForward", {"pbrForward.vert.spv", "pbrForward.frag.spv"}},
+            {"pbrForwardAlphaTest", {"pbrForward.vert.spv", "pbrForwardAlphaTest.frag.spv"}},
+            {"pbrForwardBlend", {"pbrForward.vert.spv", "pbrForwardBlend.frag.spv"}},
+            {"pbrForwardDepthEqual", {"pbrForward.vert.spv", "pbrForward.frag.spv"}},
+            {"depthPrepass", {"depthPrepass.vert.spv", "shadowMap.frag.spv"}},
+            {"pbrDeferred", {"pbrForward.vert.spv", "pbrDeferred.frag.spv"}},
+            {"pbrDeferredAlphaTest", {"pbrForward.vert.spv", "pbrDeferredAlphaTest.frag.spv"}},
+            {"deferredLighting", {"post.vert.spv", "deferredLighting.frag.spv"}},
+            {"sky", {"skybox.vert.spv", "skybox.frag.spv"}},
+            {"ssaoDownsample", {"ssaoDownsample.comp.spv"}},
+            {"ssao", {"ssao.comp.spv"}},
+            {"ssaoTemporal", {"ssaoTemporal.comp.spv"}},
+            {"ssaoUpsample", {"ssaoUpsample.comp.spv"}},
+            {"clusterLights", {"clusterLights.comp.spv"}},
+            {"depthPyramid", {"depthPyramid.comp.spv"}},
+            {"occlusionCull", {"occlusionCull.comp.spv"}},
+            {"post", {"post.vert.spv", "post.frag.spv"}}};
+}
+
 void Renderer::prepareForModels(vector<Model>& models, VkFormat outColorFormat,
                                 VkFormat depthFormat, VkSampleCountFlagBits msaaSamples,
                                 uint32_t swapChainWidth, uint32_t swapChainHeight)
 {
+    HLAB_PROFILE_SCOPE("Renderer::prepareForModels");
+
+    // Instances and the G-buffer address the per-model lighting coefficients by model index
+    if (models.size() > ModelCoeffsUniform::kMaxModels) {
+        exitWithMessage("Renderer: {} models, at most {} are supported", models.size(),
+                        ModelCoeffsUniform::kMaxModels);
+    }
+
     createPipelines(outColorFormat, depthFormat, msaaSamples);
     createTextures(swapChainWidth, swapChainHeight, msaaSamples);
+    assignInstancingIds(models); // Sizes the instance buffers
+    selectSoftwareOccluders(models);
     createUniformBuffers();
 
+    gpuTimer_.create(kMaxFramesInFlight_);
+    pipelineStatistics_.create(kMaxFramesInFlight_);
+    workerPool_.create();
+    commandRecorder_.create(kMaxFramesInFlight_);
+    softwareOcclusion_.create(workerPool_);
+    passCaches_.resize(kMaxFramesInFlight_);
+    std::fill(std::begin(staticShadowSignatures_), std::end(staticShadowSignatures_), 0);
+
+    if (isAsyncComputeAvailable()) {
+        asyncGraphicsCommandBuffers_ = ctx_.createGraphicsCommandBuffers(kMaxFramesInFlight_ * 2);
+        computeCommandBuffers_.clear();
+        for (uint32_t i = 0; i < kMaxFramesInFlight_; i++) {
+            computeCommandBuffers_.push_back(
+                ctx_.createComputeCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY));
+        }
+
+        VkSemaphoreTypeCreateInfo timelineCI{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+        timelineCI.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        timelineCI.initialValue = timelineValue_;
+        VkSemaphoreCreateInfo semaphoreCI{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        semaphoreCI.pNext = &timelineCI;
+        check(vkCreateSemaphore(ctx_.device(), &semaphoreCI, nullptr, &timelineSemaphore_));
+    }
+
     for (Model& m : models) {
         m.createDescriptorSets(samplerLinearRepeat_, dummyTexture_);
     }
@@ -62,6 +132,12 @@ void Renderer::createUniformBuffers()
         boneDataUniforms_.emplace_back(ctx_, boneDataUBO_);
     }
 
+    modelCoeffsUniforms_.clear();
+    modelCoeffsUniforms_.reserve(kMaxFramesInFlight_);
+    for (uint32_t i = 0; i < kMaxFramesInFlight_; ++i) {
+        modelCoeffsUniforms_.emplace_back(ctx_, modelCoeffsUBO_);
+    }
+
     sceneSkyOptionsSets_.resize(kMaxFramesInFlight_);
     for (size_t i = 0; i < kMaxFramesInFlight_; i++) {
         sceneSkyOptionsSets_[i].create(
@@ -74,16 +150,114 @@ void Renderer::createUniformBuffers()
             ctx_, {forwardToCompute_.resourceBinding(), postOptionsUniforms_[i].resourceBinding()});
     }
 
+    instanceBuffers_.clear();
+    instanceBuffers_.reserve(kMaxFramesInFlight_);
+    for (uint32_t i = 0; i < kMaxFramesInFlight_; ++i) {
+        instanceBuffers_.emplace_back(ctx_);
+        instanceBuffers_.back().createStorageBuffer(sizeof(InstanceData) * instanceCapacity_,
+                                                    nullptr);
+    }
+
     sceneOptionsBoneDataSets_.resize(kMaxFramesInFlight_);
     for (size_t i = 0; i < kMaxFramesInFlight_; i++) {
         sceneOptionsBoneDataSets_[i].create(ctx_, {sceneUniforms_[i].resourceBinding(),
                                                    optionsUniforms_[i].resourceBinding(),
-                                                   boneDataUniforms_[i].resourceBinding()});
+                                                   boneDataUniforms_[i].resourceBinding(),
+                                                   instanceBuffers_[i].resourceBinding()});
+    }
+
+    sceneOptionsModelCoeffsSets_.resize(kMaxFramesInFlight_);
+    for (size_t i = 0; i < kMaxFramesInFlight_; i++) {
+        sceneOptionsModelCoeffsSets_[i].create(ctx_, {sceneUniforms_[i].resourceBinding(),
+                                                      optionsUniforms_[i].resourceBinding(),
+                                                      modelCoeffsUniforms_[i].resourceBinding()});
+    }
+
+    // Set 0 of the SSAO compute pipelines
+    sceneOptionsSets_.resize(kMaxFramesInFlight_);
+    for (size_t i = 0; i < kMaxFramesInFlight_; i++) {
+        sceneOptionsSets_[i].create(
+            ctx_, {sceneUniforms_[i].resourceBinding(), optionsUniforms_[i].resourceBinding()});
+    }
+
+    // Clustered lighting
+    clusterUniforms_.clear();
+    clusterUniforms_.reserve(kMaxFramesInFlight_);
+    localLightBuffers_.clear();
+    localLightBuffers_.reserve(kMaxFramesInFlight_);
+    clusterStatsBuffers_.clear();
+    clusterStatsBuffers_.reserve(kMaxFramesInFlight_);
+    for (uint32_t i = 0; i < kMaxFramesInFlight_; ++i) {
+        clusterUniforms_.emplace_back(ctx_, clusterUBO_);
+
+        localLightBuffers_.emplace_back(ctx_);
+        localLightBuffers_.back().createStorageBuffer(
+            sizeof(LocalLight) * ClusterUniform::kMaxLights, nullptr);
+
+        ClusterStatsData zeroStats{};
+        clusterStatsBuffers_.emplace_back(ctx_);
+        clusterStatsBuffers_.back().createStorageBuffer(sizeof(ClusterStatsData), &zeroStats);
+    }
+
+    // 안내: 그리드와 인덱스 목록은 같은 큐에서 순서대로 쓰고 읽으므로 프레임마다 둘 필요가
+    //      없습니다. (buildLightClusters()의 배리어 참고)
+    clusterLightCounts_.create(sizeof(uint32_t) * ClusterUniform::kClusterCount);
+    clusterLightIndices_.create(sizeof(uint32_t) * ClusterUniform::kClusterCount *
+                                ClusterUniform::kMaxLightsPerCluster);
+
+    clusterSets_.resize(kMaxFramesInFlight_);
+    clusterStatsSets_.resize(kMaxFramesInFlight_);
+    for (size_t i = 0; i < kMaxFramesInFlight_; i++) {
+        clusterSets_[i].create(ctx_, {clusterUniforms_[i].resourceBinding(),
+                                      localLightBuffers_[i].resourceBinding(),
+                                      clusterLightCounts_.resourceBinding(),
+                                      clusterLightIndices_.resourceBinding()});
+        clusterStatsSets_[i].create(ctx_, {clusterStatsBuffers_[i].resourceBinding()});
+    }
+
+    // Occlusion culling (the depth pyramid is created with the other render targets)
+    occlusionDrawBuffers_.clear();
+    occlusionDrawBuffers_.reserve(kMaxFramesInFlight_);
+    indirectCommandBuffers_.clear();
+    indirectCommandBuffers_.reserve(kMaxFramesInFlight_);
+    occlusionStatsBuffers_.clear();
+    occlusionStatsBuffers_.reserve(kMaxFramesInFlight_);
+    for (uint32_t i = 0; i < kMaxFramesInFlight_; ++i) {
+        occlusionDrawBuffers_.emplace_back(ctx_);
+        occlusionDrawBuffers_.back().createStorageBuffer(sizeof(OcclusionDraw) * instanceCapacity_,
+                                                         nullptr);
+
+        indirectCommandBuffers_.emplace_back(ctx_);
+        indirectCommandBuffers_.back().createIndirectBuffer(
+            sizeof(VkDrawIndexedIndirectCommand) * instanceCapacity_ * 2, nullptr);
+
+        OcclusionStatsData zeroStats{};
+        occlusionStatsBuffers_.emplace_back(ctx_);
+        occlusionStatsBuffers_.back().createStorageBuffer(sizeof(OcclusionStatsData), &zeroStats);
+    }
+
+    visibilityHistory_.create(sizeof(uint32_t) * std::max(meshCount_, 1u));
+    occlusionHistoryValid_ = false;
+
+    occlusionSets_.resize(kMaxFramesInFlight_);
+    for (size_t i = 0; i < kMaxFramesInFlight_; i++) {
+        occlusionSets_[i].create(ctx_, {occlusionDrawBuffers_[i].resourceBinding(),
+                                        indirectCommandBuffers_[i].resourceBinding(),
+                                        visibilityHistory_.resourceBinding(),
+                                        occlusionStatsBuffers_[i].resourceBinding(),
+                                        depthPyramid_.resourceBinding()});
     }
 }
 
 void Renderer::update(Camera& camera, uint32_t currentFrame, double time)
 {
+    HLAB_PROFILE_SCOPE("Renderer::update");
+
+    // The fence of currentFrame has been waited on, so its timestamps are ready
+    gpuTimer_.collect(currentFrame);
+    pipelineStatistics_.collect(currentFrame);
+
+    sceneUBO_.inverseViewProjection = glm::inverse(sceneUBO_.projection * sceneUBO_.view);
     sceneUniforms_[currentFrame].updateData();
 
     optionsUniforms_[currentFrame].updateData();
@@ -91,6 +265,50 @@ void Renderer::update(Camera& camera, uint32_t currentFrame, double time)
     skyOptionsUniforms_[currentFrame].updateData();
 
     postOptionsUniforms_[currentFrame].updateData();
+
+    // Stats of the cluster build submitted with this frame index, then reset for the next one
+    {
+        auto* data = static_cast<ClusterStatsData*>(clusterStatsBuffers_[currentFrame].mapped());
+        const float clusterCount = float(ClusterUniform::kClusterCount);
+        clusterStats_.averageLightsPerCluster = float(data->totalLightRefs) / clusterCount;
+        clusterStats_.averageLightsPerNonEmptyCluster =
+            data->nonEmptyClusters > 0
+                ? float(data->totalLightRefs) / float(data->nonEmptyClusters)
+                : 0.0f;
+        clusterStats_.maxLightsPerCluster = data->maxLightsPerCluster;
+        clusterStats_.overflowedClusters = data->overflowedClusters;
+        *data = ClusterStatsData{};
+    }
+
+    // Same for occlusion culling (zero when it was off)
+    {
+        auto* data =
+            static_cast<OcclusionStatsData*>(occlusionStatsBuffers_[currentFrame].mapped());
+        cullingStats_.occludedMeshes = data->occludedMeshes;
+        cullingStats_.occludedDraws = data->occludedDraws;
+        cullingStats_.secondPassMeshes = data->secondPassMeshes;
+        *data = OcclusionStatsData{};
+    }
+
+    const uint32_t lightCount =
+        std::min(static_cast<uint32_t>(localLights_.size()), ClusterUniform::kMaxLights);
+    clusterStats_.lightCount = lightCount;
+    if (lightCount > 0) {
+        localLightBuffers_[currentFrame].updateData(localLights_.data(),
+                                                    sizeof(LocalLight) * lightCount, 0);
+    }
+
+    // Exponential depth slices: slice = log(z) * scale - bias
+    const float zNear = sceneUBO_.projection[3][2] / sceneUBO_.projection[2][2];
+    const float zFar = sceneUBO_.projection[3][2] / (1.0f + sceneUBO_.projection[2][2]);
+    const float logRatio = std::log(zFar / zNear);
+    clusterUBO_.view = sceneUBO_.view;
+    clusterUBO_.inverseProjection = glm::inverse(sceneUBO_.projection);
+    clusterUBO_.gridSize.w = lightCount;
+    clusterUBO_.zParams =
+        glm::vec4(zNear, zFar, float(ClusterUniform::kGridZ) / logRatio,
+                  float(ClusterUniform::kGridZ) * std::log(zNear) / logRatio);
+    clusterUniforms_[currentFrame].updateData();
 }
 
 void Renderer::updateBoneData(const vector<Model>& models, uint32_t currentFrame)
@@ -133,110 +351,73 @@ void Renderer::updateBoneData(const vector<Model>& models, uint32_t currentFrame
     boneDataUniforms_[currentFrame].updateData();
 }
 
-void Renderer::draw(VkCommandBuffer cmd, uint32_t currentFrame, VkImageView swapchainImageView,
-                    vector<Model>& models, VkViewport viewport, VkRect2D scissor)
+void Renderer::beginFrame(VkCommandBuffer cmd, uint32_t currentFrame)
 {
-    VkRect2D renderArea = {0, 0, scissor.extent.width, scissor.extent.height};
-
-    // Forward rendering pass
-    {
-        forwardToCompute_.resourceBinding().barrierHelper().transitionTo(
-            cmd, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-        msaaColorBuffer_.barrierHelper().transitionTo(
-            cmd, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-        msaaDepthStencil_.barrierHelper_.transitionTo(
-            cmd, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-            VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT);
-
-        depthStencil_.barrierHelper_.transitionTo(
-            cmd, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-            VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT);
-
-        auto colorAttachment = createColorAttachment(
-            msaaColorBuffer_.view(), VK_ATTACHMENT_LOAD_OP_CLEAR, {0.0f, 0.0f, 0.5f, 0.0f},
-            forwardToCompute_.view(), VK_RESOLVE_MODE_AVERAGE_BIT);
-        auto depthAttachment =
-            createDepthAttachment(msaaDepthStencil_.view, VK_ATTACHMENT_LOAD_OP_CLEAR, 1.0f,
-                                  depthStencil_.view, VK_RESOLVE_MODE_SAMPLE_ZERO_BIT);
-        auto renderingInfo = createRenderingInfo(renderArea, &colorAttachment, &depthAttachment);
-
-        vkCmdBeginRendering(cmd, &renderingInfo);
-        vkCmdSetViewport(cmd, 0, 1, &viewport);
-        vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-        VkDeviceSize offsets[1]{0};
-
-        // Render models
-        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          pipelines_.at("pbrForward").pipeline());
-
-        for (size_t j = 0; j < models.size(); j++) {
-            if (!models[j].visible()) {
-                continue;
-            }
-
-            vkCmdPushConstants(cmd, pipelines_.at("pbrForward").pipelineLayout(),
-                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
-                               sizeof(models[j].modelMatrix()), &models[j].modelMatrix());
-            vkCmdPushConstants(cmd, pipelines_.at("pbrForward").pipelineLayout(),
-                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                               sizeof(models[j].modelMatrix()), sizeof(float) * 16,
-                               models[j].coeffs());
-
-            for (size_t i = 0; i < models[j].meshes().size(); i++) {
-
-                auto& mesh = models[j].meshes()[i];
-                
-                // Skip culled meshes
-                if (mesh.isCulled) {
-                    continue;
-                }
-                
-                uint32_t matIndex = mesh.materialIndex_;
-
-                const auto descriptorSets =
-                    vector{sceneOptionsBoneDataSets_[currentFrame]
-                               .handle(), // Now includes scene, options, and bone data
-                           models[j].materialDescriptorSet(matIndex).handle(),
-                           skyDescriptorSet_.handle(), shadowMapSet_.handle()};
-
-                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                        pipelines_.at("pbrForward").pipelineLayout(), 0,
-                                        static_cast<uint32_t>(descriptorSets.size()),
-                                        descriptorSets.data(), 0, nullptr);
-
-                vkCmdBindVertexBuffers(cmd, 0, 1, &mesh.vertexBuffer_, offsets);
-                vkCmdBindIndexBuffer(cmd, mesh.indexBuffer_, 0, VK_INDEX_TYPE_UINT32);
-                vkCmdDrawIndexed(cmd, static_cast<uint32_t>(mesh.indices_.size()), 1, 0, 0, 0);
-            }
+    gpuTimer_.beginFrame(cmd, currentFrame);
+    framePipelineStatistics_ = pipelineStatisticsEnabled_ && isPipelineStatisticsAvailable();
+    if (framePipelineStatistics_) {
+        pipelineStatistics_.beginFrame(cmd, currentFrame);
+    }
+    commandRecorder_.beginFrame(currentFrame);
+    renderGraph_.beginFrame();
+    barrierCalls_ = barrierCallCounter().exchange(0);
+
+    instanceCount_ = 0;
+    renderQueueStats_ = RenderQueueStats{};
+
+    // Chosen here because makeShadowMap() records differently with async compute
+    framePath_ = renderPath_;
+    if (alternateRenderPaths_) {
+        alternateFlip_ = !alternateFlip_;
+        if (alternateFlip_) {
+            framePath_ =
+                framePath_ == RenderPath::Forward ? RenderPath::Deferred : RenderPath::Forward;
         }
+    }
+    asyncFrame_ = asyncComputeEnabled_ && framePath_ == RenderPath::Deferred &&
+                  optionsUBO_.ssaoOn != 0;
+    gBufferBatch_ = VK_NULL_HANDLE;
+    shadowBatch_ = VK_NULL_HANDLE;
+}
 
-        // Sky rendering pass
-        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines_.at("sky").pipeline());
+auto Renderer::draw(VkCommandBuffer cmd, uint32_t currentFrame, VkImageView swapchainImageView,
+                    BarrierHelper& swapchainBarrierHelper, vector<Model>& models,
+                    VkViewport viewport, VkRect2D scissor) -> VkCommandBuffer
+{
+    HLAB_PROFILE_SCOPE("Renderer::draw");
 
-        const auto skyDescriptorSets = vector{
-            sceneSkyOptionsSets_[currentFrame].handle(), // Set 0: scene + sky options
-            skyDescriptorSet_.handle()                   // Set 1: sky textures
-        };
+    VkRect2D renderArea = {0, 0, scissor.extent.width, scissor.extent.height};
 
-        vkCmdBindDescriptorSets(
-            cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines_.at("sky").pipelineLayout(), 0,
-            static_cast<uint32_t>(skyDescriptorSets.size()), skyDescriptorSets.data(), 0, nullptr);
-        vkCmdDraw(cmd, 36, 1, 0, 0);
-        vkCmdEndRendering(cmd);
+    const RenderPath path = framePath_;
+
+    const bool depthPrepass = depthPrepassEnabled_ && !occlusionCullingEnabled_;
+    buildRenderQueue(models, path == RenderPath::Forward && depthPrepass);
+    buildLightClusters(cmd, currentFrame);
+
+    // Both paths leave the HDR result in forwardToCompute_
+    if (path == RenderPath::Deferred) {
+        gpuTimer_.begin(cmd, "deferred");
+        drawDeferred(cmd, currentFrame, models, viewport, scissor);
+        gpuTimer_.end(cmd);
+    } else {
+        // Timed under separate names so that both modes can be compared after toggling
+        gpuTimer_.begin(cmd, depthPrepass ? "forwardPrepassed" : "forward");
+        beginPassStatistics(cmd, "forward"); // With the depth pre-pass
+        drawForward(cmd, currentFrame, models, viewport, scissor);
+        endPassStatistics(cmd);
+        gpuTimer_.end(cmd);
     }
 
     // Post-processing pass
     {
-        forwardToCompute_.resourceBinding().barrierHelper().transitionTo(
-            cmd, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-            VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+        gpuTimer_.begin(cmd, "post");
+        beginPassStatistics(cmd, "post");
+
+        // After the acquire semaphore wait, which only the last batch of the frame has
+        pendingBarriers_.transition(swapchainBarrierHelper, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                    VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+        renderGraph_.beginPass(cmd, graphPasses_.post, pendingBarriers_);
 
         auto colorAttachment = createColorAttachment(
             swapchainImageView, VK_ATTACHMENT_LOAD_OP_CLEAR, {0.0f, 0.0f, 1.0f, 0.0f});
@@ -258,204 +439,1851 @@ void Renderer::draw(VkCommandBuffer cmd, uint32_t currentFrame, VkImageView swap
 
         vkCmdDraw(cmd, 6, 1, 0, 0);
         vkCmdEndRendering(cmd);
+
+        endPassStatistics(cmd);
+        gpuTimer_.end(cmd);
     }
+
+    return cmd;
 }
 
-void Renderer::makeShadowMap(VkCommandBuffer cmd, uint32_t currentFrame, vector<Model>& models)
+void Renderer::submitFrame(VkCommandBuffer cmd, VkSemaphore imageAcquired,
+                           VkSemaphore renderDone, VkSemaphore frameTimeline, uint64_t frameValue)
 {
-    // Transition shadow map image to depth-stencil attachment layout
-    VkImageMemoryBarrier2 shadowMapBarrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
-    shadowMapBarrier.srcStageMask = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT;
-    shadowMapBarrier.dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT;
-    shadowMapBarrier.srcAccessMask = VK_ACCESS_2_NONE;
-    shadowMapBarrier.dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    shadowMapBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    shadowMapBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-    shadowMapBarrier.image = shadowMap_.image();
-    shadowMapBarrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
-    shadowMapBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    shadowMapBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-    VkDependencyInfo depInfo{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
-    depInfo.imageMemoryBarrierCount = 1;
-    depInfo.pImageMemoryBarriers = &shadowMapBarrier;
-    vkCmdPipelineBarrier2(cmd, &depInfo);
-
-    VkRenderingAttachmentInfo shadowDepthAttachment{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
-    shadowDepthAttachment.imageView = shadowMap_.imageView();
-    shadowDepthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-    shadowDepthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    shadowDepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    shadowDepthAttachment.clearValue.depthStencil = {1.0f, 0};
+    VkSemaphoreSubmitInfo acquireWait{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    acquireWait.semaphore = imageAcquired;
+    acquireWait.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+    VkSemaphoreSubmitInfo ssaoWait{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    ssaoWait.semaphore = timelineSemaphore_;
+    ssaoWait.value = ssaoDoneValue_;
+    ssaoWait.stageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT; // Lighting reads ssaoFull_
+
+    VkSemaphoreSubmitInfo gBufferSignal{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    gBufferSignal.semaphore = timelineSemaphore_;
+    gBufferSignal.value = gBufferDoneValue_;
+    gBufferSignal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+    VkSemaphoreSubmitInfo renderDoneSignal{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    renderDoneSignal.semaphore = renderDone;
+    renderDoneSignal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+    VkSemaphoreSubmitInfo frameSignal{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    frameSignal.semaphore = frameTimeline;
+    frameSignal.value = frameValue;
+    frameSignal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+    // Without a swapchain (headless) there is nothing to wait for or to present
+    vector<VkSemaphoreSubmitInfo> lastWaits;
+    if (imageAcquired != VK_NULL_HANDLE) {
+        lastWaits.push_back(acquireWait);
+    }
+    if (asyncFrame_) {
+        lastWaits.push_back(ssaoWait);
+    }
+    // Signal operations cover all commands submitted before them on the queue
+    vector<VkSemaphoreSubmitInfo> lastSignals{frameSignal};
+    if (renderDone != VK_NULL_HANDLE) {
+        lastSignals.push_back(renderDoneSignal);
+    }
 
-    VkRenderingInfo shadowRenderingInfo{VK_STRUCTURE_TYPE_RENDERING_INFO_KHR};
-    shadowRenderingInfo.renderArea = {0, 0, shadowMap_.width(), shadowMap_.height()};
-    shadowRenderingInfo.layerCount = 1;
-    shadowRenderingInfo.colorAttachmentCount = 0;
-    shadowRenderingInfo.pDepthAttachment = &shadowDepthAttachment;
+    array<VkCommandBufferSubmitInfo, 3> cmdInfos{};
+    for (auto& cmdInfo : cmdInfos) {
+        cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    }
+    array<VkSubmitInfo2, 3> submits{};
+    for (auto& submit : submits) {
+        submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    }
+    uint32_t submitCount = 0;
+
+    auto addBatch = [&](VkCommandBuffer batch) -> VkSubmitInfo2& {
+        cmdInfos[submitCount].commandBuffer = batch;
+        submits[submitCount].commandBufferInfoCount = 1;
+        submits[submitCount].pCommandBufferInfos = &cmdInfos[submitCount];
+        return submits[submitCount++];
+    };
+
+    if (asyncFrame_) {
+        // The first batch is the G-buffer, ended by computeSsaoAsync()
+        VkSubmitInfo2& gBuffer = addBatch(gBufferBatch_);
+        gBuffer.signalSemaphoreInfoCount = 1;
+        gBuffer.pSignalSemaphoreInfos = &gBufferSignal;
+        addBatch(shadowBatch_);
+    }
+    VkSubmitInfo2& last = addBatch(cmd);
+    last.waitSemaphoreInfoCount = static_cast<uint32_t>(lastWaits.size());
+    last.pWaitSemaphoreInfos = lastWaits.data();
+    last.signalSemaphoreInfoCount = static_cast<uint32_t>(lastSignals.size());
+    last.pSignalSemaphoreInfos = lastSignals.data();
+
+    // The last batch also waits for the compute queue, so frameValue covers all of the frame
+    check(vkQueueSubmit2(ctx_.graphicsQueue(), submitCount, submits.data(), VK_NULL_HANDLE));
+}
 
-    VkViewport shadowViewport{0.0f, 0.0f, (float)shadowMap_.width(), (float)shadowMap_.height(),
-                              0.0f, 1.0f};
-    VkRect2D shadowScissor{0, 0, shadowMap_.width(), shadowMap_.height()};
+auto Renderer::beginBatch(CommandBuffer& commandBuffer) -> VkCommandBuffer
+{
+    VkCommandBuffer cmd = commandBuffer.handle();
+    check(vkResetCommandBuffer(cmd, 0));
+    VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    check(vkBeginCommandBuffer(cmd, &beginInfo));
+    return cmd;
+}
 
-    vkCmdBeginRendering(cmd, &shadowRenderingInfo);
-    vkCmdSetViewport(cmd, 0, 1, &shadowViewport);
-    vkCmdSetScissor(cmd, 0, 1, &shadowScissor);
+void Renderer::drawForward(VkCommandBuffer cmd, uint32_t currentFrame, vector<Model>& models,
+                           VkViewport viewport, VkRect2D scissor)
+{
+    VkRect2D renderArea = {0, 0, scissor.extent.width, scissor.extent.height};
 
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines_.at("shadowMap").pipeline());
+    // Forward rendering pass
+    {
+        const bool depthPrepass = depthPrepassEnabled_ && !occlusionCullingEnabled_;
+        auto colorAttachment = createColorAttachment(
+            msaaColorBuffer_.view(), VK_ATTACHMENT_LOAD_OP_CLEAR, {0.0f, 0.0f, 0.5f, 0.0f},
+            forwardToCompute_.view(), VK_RESOLVE_MODE_AVERAGE_BIT);
+        const auto setState = [&](VkCommandBuffer stateCmd) {
+            vkCmdSetViewport(stateCmd, 0, 1, &viewport);
+            vkCmdSetScissor(stateCmd, 0, 1, &scissor);
+        };
 
-    const auto descriptorSets = vector{sceneOptionsBoneDataSets_[currentFrame].handle()};
+        if (depthPrepass) {
+            // Same order as renderQueue_ would break instancing; group by geometry instead
+            depthPrepassQueue_.clear();
+            for (const DrawItem& item : renderQueue_.items()) {
+                if (RenderQueue::variantOf(item.key) == kVariantDepthEqual) {
+                    depthPrepassQueue_.add(
+                        RenderQueue::makeKey(RenderQueue::Queue::Opaque, 0, 0,
+                                             geometryIds_[item.modelIndex][item.meshIndex],
+                                             0.0f),
+                        item.modelIndex, item.meshIndex);
+                }
+            }
+            depthPrepassQueue_.sort();
 
-    vkCmdBindDescriptorSets(
-        cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines_.at("shadowMap").pipelineLayout(), 0,
-        static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+            gpuTimer_.begin(cmd, "depthPrepass");
+            renderGraph_.beginPass(cmd, graphPasses_.depthPrepass, pendingBarriers_);
 
-    vkCmdSetDepthBias(cmd,
-                      1.1f,  // Constant factor
-                      0.0f,  // Clamp value
-                      2.0f); // Slope factor
+            auto prepassDepthAttachment =
+                createDepthAttachment(msaaDepthStencil_.view, VK_ATTACHMENT_LOAD_OP_CLEAR, 1.0f);
+            prepassDepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            auto prepassRenderingInfo =
+                createRenderingInfo(renderArea, nullptr, &prepassDepthAttachment);
+            const auto prepassInheritanceInfo = createInheritanceInfo(
+                nullptr, 0, depthFormat_, depthFormat_, msaaSamples_);
 
-    // Render all visible models to shadow map
-    VkDeviceSize offsets[1]{0};
+            recordRenderQueue(cmd, currentFrame, CachedPass::DepthPrepass, prepassRenderingInfo,
+                              prepassInheritanceInfo, setState, depthPrepassQueue_,
+                              {&pipelines_.at("depthPrepass")}, models, {}, 0);
 
-    for (size_t j = 0; j < models.size(); j++) {
-        if (!models[j].visible()) {
-            continue;
+            gpuTimer_.end(cmd);
         }
 
-        vkCmdPushConstants(cmd, pipelines_.at("shadowMap").pipelineLayout(),
-                           VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(models[j].modelMatrix()),
-                           &models[j].modelMatrix());
+        // The shading pass tests against the pre-pass depth (the graph orders the writes)
+        renderGraph_.beginPass(cmd, graphPasses_.forward, pendingBarriers_);
 
-        // Render all meshes in this model
-        // 주의: 카메라 frustum 컬링(mesh.isCulled)을 shadow pass에서 사용하면 안 됨.
-        // 카메라 시야 밖에 있어도 그림자가 카메라 시야 내로 떨어질 수 있어 깜빡임 발생.
-        for (size_t i = 0; i < models[j].meshes().size(); i++) {
-            auto& mesh = models[j].meshes()[i];
+        auto depthAttachment = createDepthAttachment(
+            msaaDepthStencil_.view,
+            depthPrepass ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR, 1.0f,
+            depthStencil_.view, VK_RESOLVE_MODE_SAMPLE_ZERO_BIT);
+        auto renderingInfo = createRenderingInfo(renderArea, &colorAttachment, &depthAttachment);
 
-            // Bind vertex and index buffers
-            vkCmdBindVertexBuffers(cmd, 0, 1, &mesh.vertexBuffer_, offsets);
-            vkCmdBindIndexBuffer(cmd, mesh.indexBuffer_, 0, VK_INDEX_TYPE_UINT32);
+        const VkFormat colorFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+        const auto inheritanceInfo =
+            createInheritanceInfo(&colorFormat, 1, depthFormat_, depthFormat_, msaaSamples_);
 
-            // Draw the mesh
-            vkCmdDrawIndexed(cmd, static_cast<uint32_t>(mesh.indices_.size()), 1, 0, 0, 0);
-        }
-    }
+        // Indexed by the sort key variant
+        const vector<const Pipeline*> forwardPipelines{
+            &pipelines_.at("pbrForward"), &pipelines_.at("pbrForwardAlphaTest"),
+            &pipelines_.at("pbrForwardBlend"), &pipelines_.at("pbrForwardDepthEqual")};
 
-    vkCmdEndRendering(cmd);
+        // Sky rendering pass
+        const auto drawSky = [&](VkCommandBuffer skyCmd) {
+            vkCmdBindPipeline(skyCmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              pipelines_.at("sky").pipeline());
+
+            const auto skyDescriptorSets = vector{
+                sceneSkyOptionsSets_[currentFrame].handle(), // Set 0: scene + sky options
+                skyDescriptorSet_.handle()                   // Set 1: sky textures
+            };
+
+            vkCmdBindDescriptorSets(skyCmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    pipelines_.at("sky").pipelineLayout(), 0,
+                                    static_cast<uint32_t>(skyDescriptorSets.size()),
+                                    skyDescriptorSets.data(), 0, nullptr);
+            vkCmdDraw(skyCmd, 36, 1, 0, 0);
+        };
 
-    // Transition shadow map to shader read-only for sampling in main render pass
-    VkImageMemoryBarrier2 shadowMapReadBarrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
-    shadowMapReadBarrier.srcStageMask = VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
-    shadowMapReadBarrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
-    shadowMapReadBarrier.srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    shadowMapReadBarrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
-    shadowMapReadBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-    shadowMapReadBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    shadowMapReadBarrier.image = shadowMap_.image();
-    shadowMapReadBarrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
-    shadowMapReadBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    shadowMapReadBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        const vector<VkDescriptorSet> forwardSets{skyDescriptorSet_.handle(),
+                                                  shadowMapSet_.handle(),
+                                                  clusterSets_[currentFrame].handle()};
+
+        if (!occlusionCullingEnabled_) {
+            // Render models in sort-key order (opaque front to back, then transparent back to
+            // front)
+            recordRenderQueue(cmd, currentFrame, CachedPass::Forward, renderingInfo,
+                              inheritanceInfo, setState, renderQueue_, forwardPipelines, models,
+                              forwardSets, kAllVariants, OcclusionPhase::None, drawSky);
+            return;
+        }
 
-    VkDependencyInfo readDepInfo{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
-    readDepInfo.imageMemoryBarrierCount = 1;
-    readDepInfo.pImageMemoryBarriers = &shadowMapReadBarrier;
-    vkCmdPipelineBarrier2(cmd, &readDepInfo);
+        prepareOcclusionDraws(currentFrame, renderQueue_, forwardPipelines, models, kAllVariants);
+        cullOcclusion(cmd, currentFrame, OcclusionPhase::First);
+
+        // First pass: opaque meshes visible last frame. The second pass continues in the same
+        // multisample targets, only the depth is resolved for the pyramid.
+        auto firstColorAttachment = colorAttachment;
+        firstColorAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+        firstColorAttachment.resolveImageView = VK_NULL_HANDLE;
+        auto firstDepthAttachment = depthAttachment;
+        firstDepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        const auto firstRenderingInfo =
+            createRenderingInfo(renderArea, &firstColorAttachment, &firstDepthAttachment);
+
+        recordRenderQueue(cmd, currentFrame, CachedPass::Forward, firstRenderingInfo,
+                          inheritanceInfo, setState, renderQueue_, forwardPipelines, models,
+                          forwardSets, kAllVariants, OcclusionPhase::First);
+
+        gpuTimer_.begin(cmd, "occlusionCull");
+        buildDepthPyramid(cmd);
+        cullOcclusion(cmd, currentFrame, OcclusionPhase::Second);
+        gpuTimer_.end(cmd);
+
+        // Attachments keep their layouts, so the barrier helpers would skip these
+        BarrierBatch secondPassBarriers;
+        secondPassBarriers.addMemory(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                         VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                                     VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+                                         VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                                     VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                         VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                                         VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                                     VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT |
+                                         VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+                                         VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                         VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+        secondPassBarriers.transition(
+            depthStencil_.barrierHelper_,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+        secondPassBarriers.flush(cmd);
+
+        // Second pass: newly visible opaque meshes, visible transparent ones and the sky
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        recordRenderQueue(cmd, currentFrame, CachedPass::ForwardSecond, renderingInfo,
+                          inheritanceInfo, setState, renderQueue_, forwardPipelines, models,
+                          forwardSets, kAllVariants, OcclusionPhase::Second, drawSky);
+    }
 }
 
-void Renderer::createPipelines(const VkFormat swapChainColorFormat, const VkFormat depthFormat,
-                               VkSampleCountFlagBits msaaSamples)
+void Renderer::drawDeferred(VkCommandBuffer& cmd, uint32_t currentFrame, vector<Model>& models,
+                            VkViewport viewport, VkRect2D scissor)
 {
-    pipelines_.emplace("pbrForward",
-                       Pipeline(ctx_, shaderManager_, "pbrForward", VK_FORMAT_R16G16B16A16_SFLOAT,
-                                depthFormat, msaaSamples));
-    pipelines_.emplace("sky", Pipeline(ctx_, shaderManager_, "sky", VK_FORMAT_R16G16B16A16_SFLOAT,
-                                       depthFormat, msaaSamples));
-    pipelines_.emplace("post", Pipeline(ctx_, shaderManager_, "post", swapChainColorFormat,
-                                        depthFormat, VK_SAMPLE_COUNT_1_BIT));
-    pipelines_.emplace("shadowMap", Pipeline(ctx_, shaderManager_, "shadowMap", VK_FORMAT_D16_UNORM,
-                                             VK_FORMAT_D16_UNORM, VK_SAMPLE_COUNT_1_BIT));
-}
+    VkRect2D renderArea = {0, 0, scissor.extent.width, scissor.extent.height};
 
-void Renderer::createTextures(uint32_t swapchainWidth, uint32_t swapchainHeight,
-                              VkSampleCountFlagBits msaaSamples)
-{
-    samplerLinearRepeat_.createLinearRepeat();
-    samplerLinearClamp_.createLinearClamp();
-    samplerAnisoRepeat_.createAnisoRepeat();
-    samplerAnisoClamp_.createAnisoClamp();
+    // Lighting pass reads specular/diffuse weights and shadow offset per model index
+    // (at most kMaxModels, see prepareForModels())
+    for (uint32_t j = 0; j < uint32_t(models.size()); j++) {
+        const float* coeffs = models[j].coeffs();
+        modelCoeffsUBO_.coeffs[j] = glm::vec4(coeffs[0], coeffs[1], coeffs[3], 0.0f);
+    }
+    modelCoeffsUniforms_[currentFrame].updateData();
 
-    string dummyImagePath = kAssetsPathPrefix_ + "textures/blender_uv_grid_2k.png";
+    Image2D* gBuffer[] = {&gBufferAlbedo_, &gBufferNormal_, &gBufferMaterial_, &gBufferEmissive_};
 
-    // Load texture from file using stb_image
+    // G-buffer pass
     {
-        int width, height, channels;
-        unsigned char* pixels =
-            stbi_load(dummyImagePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        gpuTimer_.begin(cmd, "gBuffer");
+        beginPassStatistics(cmd, "gBuffer");
+        renderGraph_.beginPass(cmd, graphPasses_.gBuffer, pendingBarriers_);
 
-        if (!pixels) {
-            exitWithMessage("Failed to load texture image: {}", dummyImagePath);
+        array<VkRenderingAttachmentInfo, 4> colorAttachments;
+        for (size_t i = 0; i < colorAttachments.size(); i++) {
+            colorAttachments[i] = createColorAttachment(gBuffer[i]->view());
         }
+        auto depthAttachment = createDepthAttachment(depthStencil_.view);
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // Sampled by the lighting pass
+        auto renderingInfo =
+            createRenderingInfo(renderArea, colorAttachments.data(), &depthAttachment,
+                                static_cast<uint32_t>(colorAttachments.size()));
+
+        const auto gBufferFormats = Pipeline::gBufferFormats(ctx_);
+        const auto inheritanceInfo =
+            createInheritanceInfo(gBufferFormats.data(), uint32_t(gBufferFormats.size()),
+                                  depthFormat_, depthFormat_, VK_SAMPLE_COUNT_1_BIT);
+
+        const auto setState = [&](VkCommandBuffer stateCmd) {
+            vkCmdSetViewport(stateCmd, 0, 1, &viewport);
+            vkCmdSetScissor(stateCmd, 0, 1, &scissor);
+        };
 
-        dummyTexture_.createFromPixelData(pixels, width, height, channels, true);
-
-        // Free the loaded image data (only if we loaded from file)
-        if (pixels != nullptr && dummyImagePath.find(".png") != string::npos) {
-            stbi_image_free(pixels);
+        // The G-buffer cannot blend: blended materials are written like alpha-tested ones
+        const vector<const Pipeline*> gBufferPipelines{&pipelines_.at("pbrDeferred"),
+                                                       &pipelines_.at("pbrDeferredAlphaTest"),
+                                                       &pipelines_.at("pbrDeferredAlphaTest")};
+
+        // The instance buffer carries the model index into the G-buffer
+        if (!occlusionCullingEnabled_) {
+            recordRenderQueue(cmd, currentFrame, CachedPass::GBuffer, renderingInfo,
+                              inheritanceInfo, setState, renderQueue_, gBufferPipelines, models,
+                              {}, kAllVariants);
+        } else {
+            prepareOcclusionDraws(currentFrame, renderQueue_, gBufferPipelines, models,
+                                  kAllVariants);
+            cullOcclusion(cmd, currentFrame, OcclusionPhase::First);
+
+            recordRenderQueue(cmd, currentFrame, CachedPass::GBuffer, renderingInfo,
+                              inheritanceInfo, setState, renderQueue_, gBufferPipelines, models,
+                              {}, kAllVariants, OcclusionPhase::First);
+
+            gpuTimer_.begin(cmd, "occlusionCull");
+            buildDepthPyramid(cmd);
+            cullOcclusion(cmd, currentFrame, OcclusionPhase::Second);
+            gpuTimer_.end(cmd);
+
+            // The G-buffer images stay in their layout, so the barrier helpers would skip this
+            BarrierBatch secondPassBarriers;
+            secondPassBarriers.addMemory(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                         VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                                         VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                         VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT |
+                                             VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+            secondPassBarriers.transition(depthStencil_.barrierHelper_,
+                                          VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                                          VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                                          VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                                              VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT);
+            secondPassBarriers.flush(cmd);
+
+            // Newly visible meshes (transparent ones are written like alpha-tested)
+            for (VkRenderingAttachmentInfo& attachment : colorAttachments) {
+                attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+            }
+            depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+            recordRenderQueue(cmd, currentFrame, CachedPass::GBufferSecond, renderingInfo,
+                              inheritanceInfo, setState, renderQueue_, gBufferPipelines, models,
+                              {}, kAllVariants, OcclusionPhase::Second);
         }
 
-        dummyTexture_.setSampler(samplerLinearRepeat_.handle());
+        endPassStatistics(cmd);
+        gpuTimer_.end(cmd);
     }
 
-    // Initialize IBL textures for PBR
-    string path = kAssetsPathPrefix_ + "textures/golden_gate_hills_4k/";
-    skyTextures_.loadKtxMaps(path + "specularGGX.ktx2", path + "diffuseLambertian.ktx2",
-                             path + "outputLUT.png");
+    if (optionsUBO_.ssaoOn != 0) {
+        renderGraph_.beginPass(cmd, graphPasses_.ssao, pendingBarriers_);
+        if (asyncFrame_) {
+            cmd = computeSsaoAsync(cmd, currentFrame);
+        } else {
+            computeSsao(cmd, currentFrame);
+        }
+    } else {
+        ssaoHistoryValid_ = false;
+    }
 
-    // Create render targets
-    msaaColorBuffer_.createMsaaColorBuffer(swapchainWidth, swapchainHeight, msaaSamples);
-    msaaDepthStencil_.create(swapchainWidth, swapchainHeight, msaaSamples);
-    depthStencil_.create(swapchainWidth, swapchainHeight, VK_SAMPLE_COUNT_1_BIT);
-    forwardToCompute_.createGeneralStorage(swapchainWidth, swapchainHeight);
-    computeToPost_.createGeneralStorage(swapchainWidth, swapchainHeight);
+    // Lighting pass (fullscreen) + sky
+    {
+        gpuTimer_.begin(cmd, "lighting");
+        beginPassStatistics(cmd, "lighting"); // With the sky
+        renderGraph_.beginPass(cmd, graphPasses_.lighting, pendingBarriers_);
 
-    // Set samplers
-    forwardToCompute_.setSampler(samplerLinearRepeat_.handle());
+        auto colorAttachment = createColorAttachment(
+            forwardToCompute_.view(), VK_ATTACHMENT_LOAD_OP_CLEAR, {0.0f, 0.0f, 0.5f, 0.0f});
+        auto renderingInfo = createRenderingInfo(renderArea, &colorAttachment, nullptr);
 
-    // Create descriptor sets for sky textures (set 1 for sky pipeline)
-    skyDescriptorSet_.create(ctx_, {skyTextures_.prefiltered().resourceBinding(),
-                                    skyTextures_.irradiance().resourceBinding(),
-                                    skyTextures_.brdfLUT().resourceBinding()});
+        vkCmdBeginRendering(cmd, &renderingInfo);
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
 
-    // Create descriptor set for shadow mapping
-    shadowMapSet_.create(ctx_, {shadowMap_.resourceBinding()});
-}
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          pipelines_.at("deferredLighting").pipeline());
 
-void Renderer::updateViewFrustum(const glm::mat4& viewProjection)
-{
-    if (frustumCullingEnabled_) {
-        viewFrustum_.extractFromViewProjection(viewProjection);
+        const auto lightingDescriptorSets =
+            vector{sceneOptionsModelCoeffsSets_[currentFrame].handle(), gBufferSet_.handle(),
+                   skyDescriptorSet_.handle(), shadowMapSet_.handle(),
+                   clusterSets_[currentFrame].handle()};
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                pipelines_.at("deferredLighting").pipelineLayout(), 0,
+                                static_cast<uint32_t>(lightingDescriptorSets.size()),
+                                lightingDescriptorSets.data(), 0, nullptr);
+
+        vkCmdDraw(cmd, 6, 1, 0, 0);
+        vkCmdEndRendering(cmd);
+
+        // Sky rendering pass (depth test against the G-buffer depth, no depth writes)
+        gpuTimer_.begin(cmd, "sky");
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        auto depthAttachment =
+            createDepthAttachment(depthStencil_.view, VK_ATTACHMENT_LOAD_OP_LOAD);
+        depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_NONE;
+        renderingInfo = createRenderingInfo(renderArea, &colorAttachment, &depthAttachment);
+
+        vkCmdBeginRendering(cmd, &renderingInfo);
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          pipelines_.at("skyDeferred").pipeline());
+
+        const auto skyDescriptorSets = vector{sceneSkyOptionsSets_[currentFrame].handle(),
+                                              skyDescriptorSet_.handle()};
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                pipelines_.at("skyDeferred").pipelineLayout(), 0,
+                                static_cast<uint32_t>(skyDescriptorSets.size()),
+                                skyDescriptorSets.data(), 0, nullptr);
+        vkCmdDraw(cmd, 36, 1, 0, 0);
+        vkCmdEndRendering(cmd);
+        gpuTimer_.end(cmd);
+
+        endPassStatistics(cmd);
+        gpuTimer_.end(cmd);
     }
 }
 
-void Renderer::performFrustumCulling(vector<Model>& models)
+static auto isSameGeometry(const Mesh& a, const Mesh& b) -> bool
 {
-    cullingStats_.totalMeshes = 0;
-    cullingStats_.culledMeshes = 0;
-    cullingStats_.renderedMeshes = 0;
+    return a.vertices_.size() == b.vertices_.size() && a.indices_.size() == b.indices_.size() &&
+           std::memcmp(a.vertices_.data(), b.vertices_.data(),
+                       a.vertices_.size() * sizeof(Vertex)) == 0 &&
+           std::memcmp(a.indices_.data(), b.indices_.data(),
+                       a.indices_.size() * sizeof(uint32_t)) == 0;
+}
 
-    if (!frustumCullingEnabled_) {
-        for (auto& model : models) {
-            for (auto& mesh : model.meshes()) {
-                mesh.isCulled = false;
-                cullingStats_.totalMeshes++;
-                cullingStats_.renderedMeshes++;
+void Renderer::assignInstancingIds(vector<Model>& models)
+{
+    // Meshes with equal keys are compared byte by byte, so a hash collision cannot make one
+    // mesh draw with another's geometry
+    unordered_map<uint64_t, vector<pair<const Mesh*, uint32_t>>> geometries; // Key: mesh, id
+    uint32_t geometryCount = 0;
+    unordered_map<uint64_t, uint32_t> materialIds;
+    uint32_t meshCount = 0;
+
+    geometryIds_.resize(models.size());
+    materialIds_.resize(models.size());
+    meshOffsets_.resize(models.size());
+    for (size_t j = 0; j < models.size(); j++) {
+        Model& model = models[j];
+        meshOffsets_[j] = meshCount;
+
+        geometryIds_[j].resize(model.meshes().size());
+        for (uint32_t i = 0; i < uint32_t(model.meshes().size()); i++) {
+            const Mesh& mesh = model.meshes()[i];
+            auto& candidates = geometries[model.geometryKey(i)];
+            auto it = std::find_if(candidates.begin(), candidates.end(), [&](const auto& c) {
+                return isSameGeometry(*c.first, mesh);
+            });
+            if (it == candidates.end()) {
+                candidates.emplace_back(&mesh, geometryCount++);
+                it = candidates.end() - 1;
             }
+            geometryIds_[j][i] = it->second;
         }
-        return;
-    }
 
-    for (auto& model : models) {
+        materialIds_[j].resize(model.numMaterials());
+        for (uint32_t i = 0; i < model.numMaterials(); i++) {
+            materialIds_[j][i] =
+                materialIds.try_emplace(model.materialKey(i), uint32_t(materialIds.size()))
+                    .first->second;
+        }
+
+        meshCount += uint32_t(model.meshes().size());
+    }
+
+    meshCount_ = meshCount;
+    instanceCapacity_ = std::max(meshCount, 1u) * kMaxInstancedPassesPerFrame;
+    instanceOverflowLogged_ = false;
+
+    printLog("Instancing: {} meshes, {} unique geometries, {} unique materials", meshCount,
+             geometryCount, materialIds.size());
+}
+
+void Renderer::selectSoftwareOccluders(vector<Model>& models)
+{
+    struct Candidate
+    {
+        uint32_t modelIndex;
+        uint32_t meshIndex;
+        float area; // Surface area of the world bounds
+    };
+
+    // Skinned meshes move away from their bounds and alpha-tested ones have holes
+    vector<Candidate> candidates;
+    for (uint32_t j = 0; j < uint32_t(models.size()); j++) {
+        Model& model = models[j];
+        if (model.hasBones()) {
+            continue;
+        }
+        for (uint32_t i = 0; i < uint32_t(model.meshes().size()); i++) {
+            const Mesh& mesh = model.meshes()[i];
+            const size_t triangles = mesh.indices_.size() / 3;
+            if (triangles == 0 || triangles > kMaxOccluderTriangles ||
+                model.materials()[mesh.materialIndex_].alphaMode() != Material::AlphaMode::Opaque) {
+                continue;
+            }
+            const glm::vec3 size =
+                AABB(mesh.minBounds, mesh.maxBounds).transform(model.modelMatrix()).getExtents();
+            candidates.push_back({j, i, size.x * size.y + size.y * size.z + size.z * size.x});
+        }
+    }
+
+    const size_t count = std::min(candidates.size(), size_t(kMaxSoftwareOccluders));
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+                      [](const Candidate& a, const Candidate& b) { return a.area > b.area; });
+
+    softwareOcclusion_.clearOccluders();
+    softwareOccluders_.clear();
+    isSoftwareOccluder_.assign(meshCount_, 0);
+
+    // Position-only copies with the vertices that differ in other attributes welded
+    uint32_t triangleCount = 0;
+    for (size_t c = 0; c < count; c++) {
+        const Candidate& candidate = candidates[c];
+        const Mesh& mesh = models[candidate.modelIndex].meshes()[candidate.meshIndex];
+
+        map<tuple<float, float, float>, uint32_t> welded;
+        vector<uint32_t> remap(mesh.vertices_.size());
+        vector<glm::vec3> positions;
+        for (size_t v = 0; v < mesh.vertices_.size(); v++) {
+            const glm::vec3& p = mesh.vertices_[v].position;
+            const auto [it, inserted] =
+                welded.try_emplace(make_tuple(p.x, p.y, p.z), uint32_t(positions.size()));
+            if (inserted) {
+                positions.push_back(p);
+            }
+            remap[v] = it->second;
+        }
+
+        vector<uint32_t> indices;
+        indices.reserve(mesh.indices_.size());
+        for (size_t k = 0; k + 2 < mesh.indices_.size(); k += 3) {
+            const uint32_t a = remap[mesh.indices_[k]];
+            const uint32_t b = remap[mesh.indices_[k + 1]];
+            const uint32_t d = remap[mesh.indices_[k + 2]];
+            if (a != b && b != d && d != a) {
+                indices.insert(indices.end(), {a, b, d});
+            }
+        }
+
+        triangleCount += uint32_t(indices.size() / 3);
+        softwareOccluders_.push_back({candidate.modelIndex, candidate.meshIndex,
+                                      softwareOcclusion_.addOccluder(positions, indices)});
+        isSoftwareOccluder_[meshOffsets_[candidate.modelIndex] + candidate.meshIndex] = 1;
+    }
+
+    printLog("Software occluders: {} meshes, {} triangles", softwareOccluders_.size(),
+             triangleCount);
+}
+
+void Renderer::buildRenderQueue(vector<Model>& models, bool depthPrepass)
+{
+    renderQueue_.clear();
+
+    // Logarithmic depth (same distribution as the light cluster slices)
+    const float zNear = sceneUBO_.projection[3][2] / sceneUBO_.projection[2][2];
+    const float zFar = sceneUBO_.projection[3][2] / (1.0f + sceneUBO_.projection[2][2]);
+    const float invLogRatio = 1.0f / std::log(zFar / zNear);
+
+    for (uint32_t j = 0; j < uint32_t(models.size()); j++) {
+        Model& model = models[j];
+        if (!model.visible()) {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < uint32_t(model.meshes().size()); i++) {
+            const Mesh& mesh = model.meshes()[i];
+            if (mesh.isCulled) {
+                continue;
+            }
+
+            const Material& material = model.materials()[mesh.materialIndex_];
+            const RenderQueue::Queue queue = (material.flags_ & Material::sTransparent)
+                                                 ? RenderQueue::Queue::Transparent
+                                                 : RenderQueue::Queue::Opaque;
+
+            // The pre-pass has no material, so alpha-tested meshes must write their own depth.
+            // Skinned meshes too: pbrForward.vert offsets animated vertices (debug indicator).
+            const uint32_t alphaMode = uint32_t(material.alphaMode());
+            const bool prepassed = depthPrepass && alphaMode == kVariantOpaque && !model.hasBones();
+            const uint32_t variant = prepassed ? kVariantDepthEqual : alphaMode;
+
+            const glm::vec4 center = glm::vec4(mesh.worldBounds.getCenter(), 1.0f);
+            const float viewDepth = std::max(-(sceneUBO_.view * center).z, zNear);
+            float depth01 = std::log(viewDepth / zNear) * invLogRatio;
+
+            // Opaque draws of equal state become one instanced draw, so their order only
+            // matters for the cached commands: keep it independent of the camera
+            if (queue == RenderQueue::Queue::Opaque && commandCachingEnabled_ &&
+                instancingEnabled_) {
+                depth01 = 0.0f;
+            }
+
+            renderQueue_.add(RenderQueue::makeKey(queue, variant,
+                                                  materialIds_[j][mesh.materialIndex_],
+                                                  geometryIds_[j][i], depth01),
+                             j, i);
+        }
+    }
+
+    renderQueue_.sort();
+}
+
+// FNV-1a over the bytes of a value
+template <typename T>
+static void hashValue(uint64_t& hash, const T& value)
+{
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    for (size_t i = 0; i < sizeof(T); i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+}
+
+void Renderer::recordRenderQueue(VkCommandBuffer cmd, uint32_t currentFrame, CachedPass pass,
+                                 const VkRenderingInfo& renderingInfo,
+                                 const VkCommandBufferInheritanceRenderingInfo& inheritanceInfo,
+                                 const function<void(VkCommandBuffer)>& setState,
+                                 const RenderQueue& queue,
+                                 const vector<const Pipeline*>& pipelines,
+                                 vector<Model>& models, const vector<VkDescriptorSet>& passSets,
+                                 uint32_t materialVariants, OcclusionPhase occlusion,
+                                 const function<void(VkCommandBuffer)>& recordAfter)
+{
+    const auto recordStart = chrono::steady_clock::now();
+    const vector<DrawItem>& items = queue.items();
+
+    uint32_t itemCount = 0;
+    uint32_t instanceBase = 0;
+    VkBuffer indirectBuffer = VK_NULL_HANDLE;
+    VkDeviceSize indirectOffset = 0;
+    if (occlusion == OcclusionPhase::None) {
+        itemCount = reserveInstances(items.size(), instanceBase);
+
+        // Transforms are dynamic data, written every frame even when the commands are reused
+        const uint32_t cascade =
+            pass >= CachedPass::Shadow
+                ? (uint32_t(pass) - uint32_t(CachedPass::Shadow)) % ShadowMap::kCascadeCount
+                : 0;
+        writeInstanceData(currentFrame, items, itemCount, instanceBase, cascade, models);
+    } else {
+        // Both phases share the slots and draws set up by prepareOcclusionDraws()
+        instanceBase = occlusionInstanceBase_;
+        indirectBuffer = indirectCommandBuffers_[currentFrame].buffer();
+        if (occlusion == OcclusionPhase::First) {
+            // Opaque draws come first in the queue, transparent ones never write depth
+            while (itemCount < occlusionItemCount_ &&
+                   RenderQueue::queueOf(items[itemCount].key) == RenderQueue::Queue::Opaque) {
+                itemCount++;
+            }
+        } else {
+            itemCount = occlusionItemCount_;
+            indirectOffset = sizeof(VkDrawIndexedIndirectCommand) * instanceCapacity_;
+        }
+    }
+
+    // Merged draws are only needed when commands are recorded; the occlusion draws have them
+    vector<uint32_t>& drawSizes =
+        occlusion == OcclusionPhase::None ? drawSizes_ : occlusionDrawSizes_;
+    const auto prepareDraws = [&]() {
+        if (occlusion == OcclusionPhase::None) {
+            mergeDraws(items, itemCount, pipelines, models, materialVariants, drawSizes);
+        }
+    };
+
+    uint32_t chunkCount = 0;
+    if (parallelRecordingEnabled_) {
+        chunkCount = std::min(commandRecorder_.threadCount(), itemCount / kMinDrawsPerChunk);
+    }
+    if (commandCachingEnabled_) {
+        chunkCount = std::max(chunkCount, 1u); // Only secondaries can be kept
+    }
+
+    if (chunkCount == 0 || (chunkCount == 1 && !commandCachingEnabled_)) {
+        prepareDraws();
+        vkCmdBeginRendering(cmd, &renderingInfo);
+        setState(cmd);
+        recordDrawRange(cmd, currentFrame, items, drawSizes, 0, itemCount, instanceBase,
+                        pipelines, models, passSets, materialVariants, indirectBuffer,
+                        indirectOffset, renderQueueStats_);
+        if (recordAfter) {
+            recordAfter(cmd);
+        }
+        vkCmdEndRendering(cmd);
+        renderQueueStats_.passesRecorded++;
+    } else {
+        // recordAfter gets a secondary of its own after the draw chunks
+        const uint32_t secondaryCount = chunkCount + (recordAfter ? 1 : 0);
+
+        PassCommandCache* cache = nullptr;
+        uint64_t signature = 0;
+        if (commandCachingEnabled_) {
+            cache = &passCaches_[currentFrame][size_t(pass)];
+            signature = passSignature(currentFrame, renderingInfo, items, itemCount, instanceBase,
+                                      secondaryCount, pipelines, models, passSets,
+                                      materialVariants, occlusion);
+            cacheLookups_++;
+        }
+
+        vector<VkCommandBuffer> secondaries;
+        if (cache && cache->signature == signature) {
+            secondaries.assign(cache->secondaries.begin(),
+                               cache->secondaries.begin() + cache->secondaryCount);
+            renderQueueStats_ += cache->stats;
+            renderQueueStats_.passesReused++;
+        } else {
+            prepareDraws();
+            vector<RenderQueueStats> chunkStats(chunkCount);
+            secondaries = commandRecorder_.record(
+                secondaryCount, inheritanceInfo,
+                [&](VkCommandBuffer secondary, uint32_t chunk) {
+                    setState(secondary);
+                    if (chunk == chunkCount) {
+                        recordAfter(secondary);
+                        return;
+                    }
+                    const size_t begin = size_t(itemCount) * chunk / chunkCount;
+                    const size_t end = size_t(itemCount) * (chunk + 1) / chunkCount;
+                    recordDrawRange(secondary, currentFrame, items, drawSizes, begin, end,
+                                    instanceBase, pipelines, models, passSets, materialVariants,
+                                    indirectBuffer, indirectOffset, chunkStats[chunk]);
+                },
+                cache ? &cache->secondaries : nullptr);
+
+            RenderQueueStats passStats{};
+            for (const RenderQueueStats& stats : chunkStats) {
+                passStats += stats;
+            }
+            passStats.secondaryCommandBuffers = secondaryCount;
+            renderQueueStats_ += passStats;
+            renderQueueStats_.passesRecorded++;
+
+            if (cache) {
+                cache->signature = signature;
+                cache->secondaryCount = secondaryCount;
+                cache->stats = passStats;
+                cacheInvalidations_++;
+            }
+        }
+
+        VkRenderingInfo secondaryRenderingInfo = renderingInfo;
+        secondaryRenderingInfo.flags |= VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+
+        vkCmdBeginRendering(cmd, &secondaryRenderingInfo);
+        vkCmdExecuteCommands(cmd, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+        vkCmdEndRendering(cmd);
+
+        if (cacheLookups_ >= kCacheLogInterval) {
+            printLog("Command cache: {} of {} passes re-recorded ({:.1f}%)", cacheInvalidations_,
+                     cacheLookups_, 100.0f * cacheInvalidations_ / cacheLookups_);
+            cacheLookups_ = 0;
+            cacheInvalidations_ = 0;
+        }
+    }
+
+    renderQueueStats_.recordMs +=
+        chrono::duration<float, milli>(chrono::steady_clock::now() - recordStart).count();
+}
+
+auto Renderer::reserveInstances(size_t requested, uint32_t& instanceBase) -> uint32_t
+{
+    // Every item gets its own instance slot up front so that chunks can be recorded in
+    // parallel, and so that cached commands keep pointing at the same slots
+    const uint32_t count =
+        std::min(static_cast<uint32_t>(requested), instanceCapacity_ - instanceCount_);
+    if (count < requested && !instanceOverflowLogged_) {
+        printLog("Instance buffer full ({} instances), skipping {} draws", instanceCapacity_,
+                 requested - count);
+        instanceOverflowLogged_ = true;
+    }
+    instanceBase = instanceCount_;
+    instanceCount_ += count;
+    return count;
+}
+
+void Renderer::mergeDraws(const vector<DrawItem>& items, uint32_t count,
+                          const vector<const Pipeline*>& pipelines, vector<Model>& models,
+                          uint32_t materialVariants, vector<uint32_t>& drawSizes)
+{
+    const VkShaderStageFlags pushStages = pipelines[0]->pushConstantStages();
+
+    drawSizes.assign(count, 0);
+    for (uint32_t first = 0; first < count;) {
+        const DrawItem& item = items[first];
+        Model& model = models[item.modelIndex];
+        const uint32_t geometryId = geometryIds_[item.modelIndex][item.meshIndex];
+        const uint32_t materialId =
+            materialIds_[item.modelIndex][model.meshes()[item.meshIndex].materialIndex_];
+        const uint32_t variant = RenderQueue::variantOf(item.key);
+        const bool bindMaterial = (materialVariants >> variant) & 1;
+
+        // Following items with the same variant, geometry, material and coefficients join this
+        // draw.
+        // Skinned models are never merged since the bone matrices are per model.
+        uint32_t last = first + 1;
+        if (instancingEnabled_ && !model.hasBones()) {
+            while (last < count) {
+                const DrawItem& next = items[last];
+                Model& nextModel = models[next.modelIndex];
+                const uint32_t nextMaterial =
+                    nextModel.meshes()[next.meshIndex].materialIndex_;
+                const bool sameState =
+                    RenderQueue::variantOf(next.key) == variant &&
+                    geometryIds_[next.modelIndex][next.meshIndex] == geometryId &&
+                    !nextModel.hasBones() &&
+                    (!bindMaterial || materialIds_[next.modelIndex][nextMaterial] == materialId) &&
+                    (pushStages == 0 ||
+                     std::equal(model.coeffs(), model.coeffs() + 16, nextModel.coeffs()));
+                if (!sameState) {
+                    break;
+                }
+                last++;
+            }
+        }
+
+        drawSizes[first] = last - first;
+        first = last;
+    }
+}
+
+void Renderer::prepareOcclusionDraws(uint32_t currentFrame, const RenderQueue& queue,
+                                     const vector<const Pipeline*>& pipelines,
+                                     vector<Model>& models, uint32_t materialVariants)
+{
+    const vector<DrawItem>& items = queue.items();
+
+    occlusionItemCount_ = reserveInstances(items.size(), occlusionInstanceBase_);
+    writeInstanceData(currentFrame, items, occlusionItemCount_, occlusionInstanceBase_, 0,
+                      models);
+
+    // Both phases record the same draws, so they cannot depend on the chunks
+    mergeDraws(items, occlusionItemCount_, pipelines, models, materialVariants,
+               occlusionDrawSizes_);
+
+    auto* draws = static_cast<OcclusionDraw*>(occlusionDrawBuffers_[currentFrame].mapped());
+    auto* commands = static_cast<VkDrawIndexedIndirectCommand*>(
+        indirectCommandBuffers_[currentFrame].mapped());
+
+    occlusionDrawCount_ = 0;
+    for (uint32_t k = 0; k < occlusionItemCount_; k++) {
+        const uint32_t size = occlusionDrawSizes_[k];
+        if (size == 0) {
+            continue;
+        }
+
+        // One test for all instances of the draw; the history is kept for its first mesh
+        const DrawItem& item = items[k];
+        Model& model = models[item.modelIndex];
+        const Mesh& mesh = model.meshes()[item.meshIndex];
+        AABB bounds = mesh.worldBounds;
+        for (uint32_t i = k + 1; i < k + size; i++) {
+            const DrawItem& other = items[i];
+            const AABB& otherBounds =
+                models[other.modelIndex].meshes()[other.meshIndex].worldBounds;
+            bounds.min = glm::min(bounds.min, otherBounds.min);
+            bounds.max = glm::max(bounds.max, otherBounds.max);
+        }
+
+        const uint32_t slot = occlusionInstanceBase_ + k;
+        const uint32_t flags = RenderQueue::queueOf(item.key) == RenderQueue::Queue::Transparent
+                                   ? OcclusionDraw::kFlagTransparent
+                                   : 0;
+
+        OcclusionDraw& draw = draws[occlusionDrawCount_++];
+        draw.boundsMin = glm::vec4(bounds.min, 0.0f);
+        draw.boundsMax = glm::vec4(bounds.max, 0.0f);
+        draw.params =
+            glm::uvec4(slot, size, meshOffsets_[item.modelIndex] + item.meshIndex, flags);
+
+        // Instance counts are written by occlusionCull.comp
+        VkDrawIndexedIndirectCommand command{};
+        command.indexCount = static_cast<uint32_t>(mesh.indices_.size());
+        command.firstInstance = slot;
+        commands[slot] = command;
+        commands[instanceCapacity_ + slot] = command;
+    }
+}
+
+void Renderer::writeInstanceData(uint32_t currentFrame, const vector<DrawItem>& items,
+                                 uint32_t count, uint32_t instanceBase, uint32_t cascade,
+                                 vector<Model>& models)
+{
+    auto* instances = static_cast<InstanceData*>(instanceBuffers_[currentFrame].mapped());
+    for (uint32_t k = 0; k < count; k++) {
+        const uint32_t modelIndex = items[k].modelIndex;
+        InstanceData& instance = instances[instanceBase + k];
+        instance.model = models[modelIndex].modelMatrix();
+        instance.params = glm::uvec4(modelIndex, cascade, 0, 0);
+    }
+}
+
+auto Renderer::passSignature(uint32_t currentFrame, const VkRenderingInfo& renderingInfo,
+                             const vector<DrawItem>& items, uint32_t itemCount,
+                             uint32_t instanceBase, uint32_t secondaryCount,
+                             const vector<const Pipeline*>& pipelines, vector<Model>& models,
+                             const vector<VkDescriptorSet>& passSets,
+                             uint32_t materialVariants, OcclusionPhase occlusion) -> uint64_t
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    // Pass setup (viewport and scissor follow the render area)
+    hashValue(hash, renderingInfo.renderArea);
+    for (const Pipeline* pipeline : pipelines) {
+        hashValue(hash, pipeline->pipeline());
+    }
+    hashValue(hash, sceneOptionsBoneDataSets_[currentFrame].handle());
+    for (VkDescriptorSet set : passSets) {
+        hashValue(hash, set);
+    }
+    hashValue(hash, materialVariants);
+    hashValue(hash, occlusion); // Direct or indirect draws, and which commands
+    hashValue(hash, instancingEnabled_);
+    hashValue(hash, instanceBase);
+    hashValue(hash, secondaryCount);
+
+    // Visibility set and draw order. The depth part of the keys is left out, so camera motion
+    // alone does not invalidate the pass; only a change of the order of the draws does.
+    hashValue(hash, itemCount);
+    for (uint32_t k = 0; k < itemCount; k++) {
+        hashValue(hash, RenderQueue::stateOf(items[k].key));
+        hashValue(hash, items[k].modelIndex);
+        hashValue(hash, items[k].meshIndex);
+    }
+
+    // Push constants and material descriptor sets
+    for (Model& model : models) {
+        for (uint32_t i = 0; i < 16; i++) {
+            hashValue(hash, model.coeffs()[i]);
+        }
+        hashValue(hash, model.hasBones());
+        for (uint32_t i = 0; i < model.numMaterials(); i++) {
+            hashValue(hash, model.materialDescriptorSet(i).handle());
+        }
+    }
+
+    return hash != 0 ? hash : 1;
+}
+
+void Renderer::recordDrawRange(VkCommandBuffer cmd, uint32_t currentFrame,
+                               const vector<DrawItem>& items, const vector<uint32_t>& drawSizes,
+                               size_t begin, size_t end, uint32_t instanceBase,
+                               const vector<const Pipeline*>& pipelines, vector<Model>& models,
+                               const vector<VkDescriptorSet>& passSets, uint32_t materialVariants,
+                               VkBuffer indirectBuffer, VkDeviceSize indirectOffset,
+                               RenderQueueStats& stats)
+{
+    // Variants share set 0 and the push constant range, so these stay valid across pipeline
+    // switches. Variants that bind materials also share set 1.
+    const VkPipelineLayout layout = pipelines[0]->pipelineLayout();
+    const VkShaderStageFlags pushStages = pipelines[0]->pushConstantStages();
+
+    // Set 0 (scene, options, bones, instances) and sets 2.. stay bound for the whole pass,
+    // only set 1 (material) changes
+    const VkDescriptorSet sceneSet = sceneOptionsBoneDataSets_[currentFrame].handle();
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &sceneSet, 0,
+                            nullptr);
+    stats.descriptorSetBinds++;
+    if (!passSets.empty()) {
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 2,
+                                static_cast<uint32_t>(passSets.size()), passSets.data(), 0,
+                                nullptr);
+        stats.descriptorSetBinds++;
+    }
+
+    uint32_t boundVariant = uint32_t(-1);
+    uint32_t boundModel = uint32_t(-1);
+    VkDescriptorSet boundMaterialSet = VK_NULL_HANDLE;
+    VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+    VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+    const VkDeviceSize offsets[1]{0};
+
+    // A draw that starts in the range is recorded whole, even if it extends past `end`
+    for (size_t first = begin; first < end; first++) {
+        const uint32_t instanceCount = drawSizes[first];
+        if (instanceCount == 0) {
+            continue; // Part of an earlier draw
+        }
+
+        const DrawItem& item = items[first];
+        Model& model = models[item.modelIndex];
+        Mesh& mesh = model.meshes()[item.meshIndex];
+        const uint32_t variant = RenderQueue::variantOf(item.key);
+        const bool bindMaterial = (materialVariants >> variant) & 1;
+        const uint32_t firstInstance = instanceBase + uint32_t(first);
+
+        if (variant != boundVariant) {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              pipelines[variant]->pipeline());
+            boundVariant = variant;
+            stats.pipelineBinds++;
+        }
+
+        if (pushStages != 0) {
+            if (item.modelIndex != boundModel) {
+                // The model matrix part of the block is unused (instance buffer)
+                vkCmdPushConstants(cmd, layout, pushStages, sizeof(glm::mat4), sizeof(float) * 16,
+                                   model.coeffs());
+                boundModel = item.modelIndex;
+                stats.pushConstantUpdates++;
+            } else {
+                stats.skippedBinds++;
+            }
+        }
+
+        if (bindMaterial) {
+            const VkDescriptorSet materialSet =
+                model.materialDescriptorSet(mesh.materialIndex_).handle();
+            if (materialSet != boundMaterialSet) {
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                        pipelines[variant]->pipelineLayout(), 1, 1, &materialSet,
+                                        0, nullptr);
+                boundMaterialSet = materialSet;
+                stats.descriptorSetBinds++;
+            } else {
+                stats.skippedBinds++;
+            }
+        }
+
+        if (mesh.vertexBuffer_ != boundVertexBuffer) {
+            vkCmdBindVertexBuffers(cmd, 0, 1, &mesh.vertexBuffer_, offsets);
+            boundVertexBuffer = mesh.vertexBuffer_;
+            stats.vertexBufferBinds++;
+        } else {
+            stats.skippedBinds++;
+        }
+
+        if (mesh.indexBuffer_ != boundIndexBuffer) {
+            vkCmdBindIndexBuffer(cmd, mesh.indexBuffer_, 0, VK_INDEX_TYPE_UINT32);
+            boundIndexBuffer = mesh.indexBuffer_;
+            stats.indexBufferBinds++;
+        } else {
+            stats.skippedBinds++;
+        }
+
+        // Indirect draws count every candidate instance; the GPU may skip some of them
+        if (indirectBuffer != VK_NULL_HANDLE) {
+            vkCmdDrawIndexedIndirect(cmd, indirectBuffer,
+                                     indirectOffset +
+                                         sizeof(VkDrawIndexedIndirectCommand) * firstInstance,
+                                     1, sizeof(VkDrawIndexedIndirectCommand));
+        } else {
+            vkCmdDrawIndexed(cmd, static_cast<uint32_t>(mesh.indices_.size()), instanceCount, 0,
+                             0, firstInstance);
+        }
+        stats.draws++;
+        stats.instances += instanceCount;
+    }
+}
+
+void Renderer::computeSsao(VkCommandBuffer cmd, uint32_t currentFrame)
+{
+    constexpr uint32_t kGroupSize = 8; // local_size of the ssao*.comp shaders
+
+    const uint32_t writeIndex = ssaoFrame_ % 2;
+    const uint32_t readIndex = 1 - writeIndex;
+
+    // historyViewProjection still refers to the frame that wrote ssaoHistory_[readIndex]
+    ssaoPushConstants_.params = glm::vec4(float(ssaoFrame_), ssaoHistoryBlend_,
+                                          ssaoHistoryValid_ ? 1.0f : 0.0f, 0.0f);
+
+    auto dispatch = [&](const string& name, const vector<VkDescriptorSet>& descriptorSets,
+                        const Image2D& target, bool pushConstants) {
+        const Pipeline& pipeline = pipelines_.at(name);
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline());
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipelineLayout(), 0,
+                                static_cast<uint32_t>(descriptorSets.size()),
+                                descriptorSets.data(), 0, nullptr);
+        if (pushConstants) {
+            vkCmdPushConstants(cmd, pipeline.pipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                               sizeof(ssaoPushConstants_), &ssaoPushConstants_);
+        }
+        vkCmdDispatch(cmd, (target.width() + kGroupSize - 1) / kGroupSize,
+                      (target.height() + kGroupSize - 1) / kGroupSize, 1);
+    };
+
+    const VkPipelineStageFlags2 computeStage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    const VkAccessFlags2 storageRead = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+    const VkAccessFlags2 storageWrite = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    const VkImageLayout general = VK_IMAGE_LAYOUT_GENERAL; // Storage images only
+    BarrierBatch barriers;
+
+    gpuTimer_.begin(cmd, "ssao");
+
+    // Depth and normal at half resolution
+    {
+        gpuTimer_.begin(cmd, "ssaoDownsample");
+
+        // The depth and G-buffer normal are transitioned by the ssao pass of renderGraph_
+        barriers.transition(ssaoDepth_.barrierHelper(), storageWrite, general, computeStage);
+        barriers.transition(ssaoNormal_.barrierHelper(), storageWrite, general, computeStage);
+        barriers.flush(cmd);
+
+        dispatch("ssaoDownsample", {ssaoDownsampleSet_.handle()}, ssaoDepth_, false);
+
+        gpuTimer_.end(cmd);
+    }
+
+    // Ambient occlusion with per-frame rotated samples
+    {
+        gpuTimer_.begin(cmd, "ssaoAo");
+
+        barriers.transition(ssaoDepth_.barrierHelper(), storageRead, general, computeStage);
+        barriers.transition(ssaoNormal_.barrierHelper(), storageRead, general, computeStage);
+        barriers.transition(ssaoRaw_.barrierHelper(), storageWrite, general, computeStage);
+        barriers.flush(cmd);
+
+        dispatch("ssao", {sceneOptionsSets_[currentFrame].handle(), ssaoSet_.handle()}, ssaoRaw_,
+                 true);
+
+        gpuTimer_.end(cmd);
+    }
+
+    // Temporal accumulation
+    {
+        gpuTimer_.begin(cmd, "ssaoTemporal");
+
+        barriers.transition(ssaoRaw_.barrierHelper(), storageRead, general, computeStage);
+        barriers.transition(ssaoHistory_[readIndex].barrierHelper(), storageRead, general,
+                            computeStage);
+        barriers.transition(ssaoHistory_[writeIndex].barrierHelper(), storageWrite, general,
+                            computeStage);
+        barriers.flush(cmd);
+
+        dispatch("ssaoTemporal",
+                 {sceneOptionsSets_[currentFrame].handle(), ssaoTemporalSets_[writeIndex].handle()},
+                 ssaoHistory_[writeIndex], true);
+
+        gpuTimer_.end(cmd);
+    }
+
+    // Bilateral upsample to full resolution
+    {
+        gpuTimer_.begin(cmd, "ssaoUpsample");
+
+        barriers.transition(ssaoHistory_[writeIndex].barrierHelper(), storageRead, general,
+                            computeStage);
+        barriers.transition(ssaoFull_.barrierHelper(), storageWrite, general, computeStage);
+        barriers.flush(cmd);
+
+        dispatch("ssaoUpsample",
+                 {sceneOptionsSets_[currentFrame].handle(), ssaoUpsampleSets_[writeIndex].handle()},
+                 ssaoFull_, false);
+
+        gpuTimer_.end(cmd);
+    }
+
+    // Recorded with the barriers of the lighting pass
+    pendingBarriers_.transition(ssaoFull_.barrierHelper(), storageRead, general,
+                                VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+
+    gpuTimer_.end(cmd);
+
+    ssaoPushConstants_.historyViewProjection = sceneUBO_.projection * sceneUBO_.view;
+    ssaoHistoryValid_ = true;
+    ssaoFrame_++;
+}
+
+auto Renderer::computeSsaoAsync(VkCommandBuffer cmd, uint32_t currentFrame) -> VkCommandBuffer
+{
+    // End of the G-buffer batch, submitted by submitFrame() after the compute batch below.
+    // Timeline semaphores allow waiting for a value whose signal is submitted later.
+    check(vkEndCommandBuffer(cmd));
+    gBufferBatch_ = cmd;
+    gBufferDoneValue_ = ++timelineValue_;
+    ssaoDoneValue_ = ++timelineValue_;
+
+    VkCommandBuffer computeCmd = beginBatch(computeCommandBuffers_[currentFrame]);
+
+    // The barrier helpers may hold graphics stages of the last frame, which are not valid on
+    // the compute queue. The semaphore wait already orders everything before it.
+    for (Image2D* image :
+         {&ssaoDepth_, &ssaoNormal_, &ssaoRaw_, &ssaoHistory_[0], &ssaoHistory_[1], &ssaoFull_}) {
+        image->barrierHelper().currentStage() = VK_PIPELINE_STAGE_2_NONE;
+        image->barrierHelper().currentAccess() = VK_ACCESS_2_NONE;
+    }
+
+    computeSsao(computeCmd, currentFrame);
+    check(vkEndCommandBuffer(computeCmd));
+
+    VkSemaphoreSubmitInfo gBufferWait{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    gBufferWait.semaphore = timelineSemaphore_;
+    gBufferWait.value = gBufferDoneValue_;
+    gBufferWait.stageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+
+    VkSemaphoreSubmitInfo ssaoSignal{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    ssaoSignal.semaphore = timelineSemaphore_;
+    ssaoSignal.value = ssaoDoneValue_;
+    ssaoSignal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+    VkCommandBufferSubmitInfo cmdInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO};
+    cmdInfo.commandBuffer = computeCmd;
+
+    VkSubmitInfo2 submit{VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+    submit.waitSemaphoreInfoCount = 1;
+    submit.pWaitSemaphoreInfos = &gBufferWait;
+    submit.commandBufferInfoCount = 1;
+    submit.pCommandBufferInfos = &cmdInfo;
+    submit.signalSemaphoreInfoCount = 1;
+    submit.pSignalSemaphoreInfos = &ssaoSignal;
+    check(vkQueueSubmit2(ctx_.computeQueue(), 1, &submit, VK_NULL_HANDLE));
+
+    // The rest of the frame, from the lighting pass on
+    return beginBatch(asyncGraphicsCommandBuffers_[currentFrame * 2 + 1]);
+}
+
+void Renderer::buildLightClusters(VkCommandBuffer cmd, uint32_t currentFrame)
+{
+    constexpr uint32_t kGroupSize = 64; // local_size_x of clusterLights.comp
+
+    // The lighting shaders skip the cluster lookup when there are no lights
+    if (clusterUBO_.gridSize.w == 0) {
+        return;
+    }
+
+    gpuTimer_.begin(cmd, "clusterBuild");
+
+    // Previous frame's lighting pass reads the grid that is rebuilt here. Also records the
+    // shadow map transition of makeShadowMap() (unless it has a batch of its own).
+    pendingBarriers_.addMemory(
+        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+    pendingBarriers_.flush(cmd);
+
+    const Pipeline& pipeline = pipelines_.at("clusterLights");
+    const auto descriptorSets =
+        vector{clusterSets_[currentFrame].handle(), clusterStatsSets_[currentFrame].handle()};
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline());
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipelineLayout(), 0,
+                            static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(),
+                            0, nullptr);
+    vkCmdDispatch(cmd, (ClusterUniform::kClusterCount + kGroupSize - 1) / kGroupSize, 1, 1);
+
+    // Grid for the lighting shaders, stats for the read back after the fence. Recorded with
+    // the barriers of the next render graph pass.
+    pendingBarriers_.addMemory(
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_HOST_BIT,
+        VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_HOST_READ_BIT);
+
+    gpuTimer_.end(cmd);
+}
+
+void Renderer::buildDepthPyramid(VkCommandBuffer cmd)
+{
+    constexpr uint32_t kGroupSize = 8; // local_size of depthPyramid.comp
+
+    // Resolved (forward) or G-buffer (deferred) depth of the first pass, and the previous
+    // frame's culling reads the levels that are rebuilt here
+    BarrierBatch barriers;
+    barriers.transition(depthStencil_.barrierHelper_, VK_ACCESS_2_SHADER_READ_BIT,
+                        VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    barriers.addMemory(VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                       VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+    barriers.flush(cmd);
+
+    // Every level reads the one written before it
+    VkMemoryBarrier2 levelBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    levelBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    levelBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    levelBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    levelBarrier.dstAccessMask =
+        VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+
+    VkDependencyInfo depInfo{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    depInfo.memoryBarrierCount = 1;
+    depInfo.pMemoryBarriers = &levelBarrier;
+
+    const Pipeline& pipeline = pipelines_.at("depthPyramid");
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline());
+    for (uint32_t level = 0; level < depthPyramid_.levelCount(); level++) {
+        const VkDescriptorSet set = depthPyramidSets_[level].handle();
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipelineLayout(), 0,
+                                1, &set, 0, nullptr);
+        vkCmdPushConstants(cmd, pipeline.pipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(uint32_t), &level);
+
+        const uint32_t width = std::max(depthPyramid_.width() >> level, 1u);
+        const uint32_t height = std::max(depthPyramid_.height() >> level, 1u);
+        vkCmdDispatch(cmd, (width + kGroupSize - 1) / kGroupSize,
+                      (height + kGroupSize - 1) / kGroupSize, 1);
+        recordBarrier(cmd, depInfo);
+    }
+}
+
+void Renderer::cullOcclusion(VkCommandBuffer cmd, uint32_t currentFrame, OcclusionPhase phase)
+{
+    constexpr uint32_t kGroupSize = 64; // local_size_x of occlusionCull.comp
+
+    VkDependencyInfo depInfo{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    depInfo.memoryBarrierCount = 1;
+
+    if (phase == OcclusionPhase::First) {
+        // Previous frame's second phase wrote the history that is read here
+        VkMemoryBarrier2 historyBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+        historyBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        historyBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+        historyBarrier.dstStageMask =
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT;
+        historyBarrier.dstAccessMask =
+            VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        depInfo.pMemoryBarriers = &historyBarrier;
+        recordBarrier(cmd, depInfo);
+
+        // Without a history everything is drawn in the first pass
+        if (!occlusionHistoryValid_) {
+            vkCmdFillBuffer(cmd, visibilityHistory_.buffer(), 0, VK_WHOLE_SIZE, 1);
+
+            VkMemoryBarrier2 fillBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+            fillBarrier.srcStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+            fillBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+            fillBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            fillBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+            depInfo.pMemoryBarriers = &fillBarrier;
+            recordBarrier(cmd, depInfo);
+
+            occlusionHistoryValid_ = true;
+        }
+    }
+
+    OcclusionCullPushConstants pushConstants{};
+    pushConstants.viewProjection = sceneUBO_.projection * sceneUBO_.view;
+    pushConstants.params = glm::uvec4(occlusionDrawCount_, phase == OcclusionPhase::Second ? 1 : 0,
+                                      instanceCapacity_, 0);
+    pushConstants.pyramidSize = glm::vec4(float(depthPyramid_.width()),
+                                          float(depthPyramid_.height()),
+                                          float(depthPyramid_.levelCount()), 0.0f);
+
+    const Pipeline& pipeline = pipelines_.at("occlusionCull");
+    const VkDescriptorSet set = occlusionSets_[currentFrame].handle();
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline());
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipelineLayout(), 0, 1,
+                            &set, 0, nullptr);
+    vkCmdPushConstants(cmd, pipeline.pipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(pushConstants), &pushConstants);
+    vkCmdDispatch(cmd, (occlusionDrawCount_ + kGroupSize - 1) / kGroupSize, 1, 1);
+
+    // Commands for the indirect draws, stats for the read back after the fence
+    VkMemoryBarrier2 readBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    readBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    readBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    readBarrier.dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT |
+                               VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT |
+                               VK_PIPELINE_STAGE_2_HOST_BIT;
+    readBarrier.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT |
+                                VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_HOST_READ_BIT;
+    depInfo.pMemoryBarriers = &readBarrier;
+    recordBarrier(cmd, depInfo);
+}
+
+void Renderer::makeShadowMap(VkCommandBuffer cmd, uint32_t currentFrame, vector<Model>& models)
+{
+    HLAB_PROFILE_SCOPE("Renderer::makeShadowMap");
+
+    // With async compute the shadow pass is submitted after the G-buffer, so that it runs
+    // while the compute queue works on SSAO
+    if (asyncFrame_) {
+        cmd = shadowBatch_ = beginBatch(asyncGraphicsCommandBuffers_[currentFrame * 2]);
+    }
+
+    gpuTimer_.begin(cmd, "shadow");
+    beginPassStatistics(cmd, "shadow");
+
+    VkRenderingAttachmentInfo shadowDepthAttachment{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+    shadowDepthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    shadowDepthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    shadowDepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    shadowDepthAttachment.clearValue.depthStencil = {1.0f, 0};
+
+    VkRenderingInfo shadowRenderingInfo{VK_STRUCTURE_TYPE_RENDERING_INFO_KHR};
+    shadowRenderingInfo.renderArea = {0, 0, shadowMap_.width(), shadowMap_.height()};
+    shadowRenderingInfo.layerCount = 1;
+    shadowRenderingInfo.colorAttachmentCount = 0;
+    shadowRenderingInfo.pDepthAttachment = &shadowDepthAttachment;
+
+    VkViewport shadowViewport{0.0f, 0.0f, (float)shadowMap_.width(), (float)shadowMap_.height(),
+                              0.0f, 1.0f};
+    VkRect2D shadowScissor{0, 0, shadowMap_.width(), shadowMap_.height()};
+
+    const auto inheritanceInfo = createInheritanceInfo(nullptr, 0, VK_FORMAT_D16_UNORM,
+                                                       VK_FORMAT_UNDEFINED, VK_SAMPLE_COUNT_1_BIT);
+
+    const auto setState = [&](VkCommandBuffer stateCmd) {
+        vkCmdSetViewport(stateCmd, 0, 1, &shadowViewport);
+        vkCmdSetScissor(stateCmd, 0, 1, &shadowScissor);
+
+        vkCmdSetDepthBias(stateCmd,
+                          1.1f,  // Constant factor
+                          0.0f,  // Clamp value
+                          2.0f); // Slope factor
+    };
+
+    // 주의: 카메라 frustum 컬링(mesh.isCulled)을 shadow pass에서 사용하면 안 됨.
+    // 카메라 시야 밖에 있어도 그림자가 카메라 시야 내로 떨어질 수 있어 깜빡임 발생.
+    // 대신 cascade frustum 기준의 mesh.shadowCascadeMask를 사용합니다 (performShadowCulling).
+    // Every cascade is rendered into its own layer. Opaque casters are grouped by geometry
+    // only (no materials); the others use the alpha-tested variant, which binds materials.
+    // With the static cache, animated models are the only casters drawn every frame.
+    for (uint32_t c = 0; c < ShadowMap::kCascadeCount; c++) {
+        shadowQueues_[c].clear();
+        staticShadowQueues_[c].clear();
+        for (uint32_t j = 0; j < uint32_t(models.size()); j++) {
+            if (!models[j].visible()) {
+                continue;
+            }
+            RenderQueue& queue = staticShadowCachingEnabled_ && !models[j].hasAnimations()
+                                     ? staticShadowQueues_[c]
+                                     : shadowQueues_[c];
+            for (uint32_t i = 0; i < uint32_t(models[j].meshes().size()); i++) {
+                const Mesh& mesh = models[j].meshes()[i];
+                if (!(mesh.shadowCascadeMask & (1u << c))) {
+                    continue;
+                }
+                const bool alphaTested =
+                    models[j].materials()[mesh.materialIndex_].alphaMode() !=
+                    Material::AlphaMode::Opaque;
+                queue.add(RenderQueue::makeKey(
+                              RenderQueue::Queue::Opaque,
+                              alphaTested ? kVariantAlphaTested : kVariantOpaque,
+                              alphaTested ? materialIds_[j][mesh.materialIndex_] : 0,
+                              geometryIds_[j][i], 0.0f),
+                          j, i);
+            }
+        }
+        shadowQueues_[c].sort();
+        staticShadowQueues_[c].sort();
+    }
+
+    // Indexed by the sort key variant (kVariantBlended is never used here)
+    const vector<const Pipeline*> shadowPipelines{&pipelines_.at("shadowMap"),
+                                                  &pipelines_.at("shadowMapAlphaTest")};
+    const uint32_t shadowMaterialVariants = 1u << kVariantAlphaTested;
+
+    const uint32_t drawsBefore = renderQueueStats_.draws;
+    cullingStats_.shadowStaticRedraws = 0;
+
+    const VkImageSubresourceRange allCascades{VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0,
+                                              ShadowMap::kCascadeCount};
+
+    VkImageMemoryBarrier2 shadowMapBarrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    shadowMapBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    shadowMapBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    shadowMapBarrier.image = shadowMap_.image();
+    shadowMapBarrier.subresourceRange = allCascades;
+
+    VkDependencyInfo depInfo{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    depInfo.imageMemoryBarrierCount = 1;
+    depInfo.pImageMemoryBarriers = &shadowMapBarrier;
+
+    if (staticShadowCachingEnabled_) {
+        // Re-render the static casters of cascades whose matrix or caster set has changed
+        BarrierBatch copyBarriers;
+        vector<VkImageMemoryBarrier2> staticBarriers;
+        for (uint32_t c = 0; c < ShadowMap::kCascadeCount; c++) {
+            const uint64_t signature = staticShadowSignature(c, staticShadowQueues_[c], models);
+            if (signature == staticShadowSignatures_[c]) {
+                continue;
+            }
+            staticShadowSignatures_[c] = signature;
+
+            VkImageMemoryBarrier2 barrier = shadowMapBarrier;
+            barrier.image = shadowMap_.staticImage();
+            barrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, c, 1};
+            staticBarriers.push_back(barrier);
+        }
+
+        if (!staticBarriers.empty()) {
+            // Previous copies out of the cache must finish before it is cleared
+            for (VkImageMemoryBarrier2& barrier : staticBarriers) {
+                barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+                barrier.srcAccessMask = VK_ACCESS_2_NONE;
+                barrier.dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                                       VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+                barrier.dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+            }
+            VkDependencyInfo staticDepInfo{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+            staticDepInfo.imageMemoryBarrierCount = static_cast<uint32_t>(staticBarriers.size());
+            staticDepInfo.pImageMemoryBarriers = staticBarriers.data();
+            recordBarrier(cmd, staticDepInfo);
+
+            for (const VkImageMemoryBarrier2& barrier : staticBarriers) {
+                const uint32_t c = barrier.subresourceRange.baseArrayLayer;
+                shadowDepthAttachment.imageView = shadowMap_.staticLayerView(c);
+                recordRenderQueue(cmd, currentFrame,
+                                  CachedPass(uint32_t(CachedPass::StaticShadow) + c),
+                                  shadowRenderingInfo, inheritanceInfo, setState,
+                                  staticShadowQueues_[c], shadowPipelines, models, {},
+                                  shadowMaterialVariants);
+                cullingStats_.shadowStaticRedraws++;
+            }
+
+            // Recorded together with the transition of the shadow map below
+            for (VkImageMemoryBarrier2& barrier : staticBarriers) {
+                barrier.srcStageMask = VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+                barrier.srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+                barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+                barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                copyBarriers.add(barrier);
+            }
+        }
+
+        // Start every cascade from the cached static depth
+        shadowMapBarrier.srcStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        shadowMapBarrier.srcAccessMask = VK_ACCESS_2_NONE;
+        shadowMapBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        shadowMapBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        shadowMapBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        shadowMapBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        copyBarriers.add(shadowMapBarrier);
+        copyBarriers.flush(cmd);
+
+        VkImageCopy copyRegion{};
+        copyRegion.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, ShadowMap::kCascadeCount};
+        copyRegion.dstSubresource = copyRegion.srcSubresource;
+        copyRegion.extent = {shadowMap_.width(), shadowMap_.height(), 1};
+        vkCmdCopyImage(cmd, shadowMap_.staticImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       shadowMap_.image(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+        shadowMapBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        shadowMapBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        shadowMapBarrier.dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                                        VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+        shadowMapBarrier.dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                         VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        shadowMapBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        shadowMapBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        recordBarrier(cmd, depInfo);
+
+        shadowDepthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    } else {
+        // Transition shadow map image to depth-stencil attachment layout
+        shadowMapBarrier.srcStageMask = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT;
+        shadowMapBarrier.dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT;
+        shadowMapBarrier.srcAccessMask = VK_ACCESS_2_NONE;
+        shadowMapBarrier.dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        shadowMapBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        shadowMapBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        recordBarrier(cmd, depInfo);
+    }
+
+    for (uint32_t c = 0; c < ShadowMap::kCascadeCount; c++) {
+        // Loading the cached depth without drawing anything on top would be a wasted pass
+        if (staticShadowCachingEnabled_ && shadowQueues_[c].items().empty()) {
+            continue;
+        }
+        shadowDepthAttachment.imageView = shadowMap_.layerView(c);
+        recordRenderQueue(cmd, currentFrame, CachedPass(uint32_t(CachedPass::Shadow) + c),
+                          shadowRenderingInfo, inheritanceInfo, setState, shadowQueues_[c],
+                          shadowPipelines, models, {}, shadowMaterialVariants);
+    }
+    cullingStats_.shadowDraws = renderQueueStats_.draws - drawsBefore;
+
+    // Transition shadow map to shader read-only for sampling in main render pass (recorded
+    // with the first barriers of draw())
+    VkImageMemoryBarrier2 shadowMapReadBarrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    shadowMapReadBarrier.srcStageMask =
+        VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_COPY_BIT;
+    shadowMapReadBarrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+    shadowMapReadBarrier.srcAccessMask =
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    shadowMapReadBarrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+    shadowMapReadBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    shadowMapReadBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    shadowMapReadBarrier.image = shadowMap_.image();
+    shadowMapReadBarrier.subresourceRange = allCascades;
+    shadowMapReadBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    shadowMapReadBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+    endPassStatistics(cmd);
+    gpuTimer_.end(cmd);
+
+    if (asyncFrame_) {
+        BarrierBatch readBarrier;
+        readBarrier.add(shadowMapReadBarrier);
+        readBarrier.flush(cmd);
+        check(vkEndCommandBuffer(cmd));
+    } else {
+        pendingBarriers_.add(shadowMapReadBarrier);
+    }
+}
+
+auto Renderer::staticShadowSignature(uint32_t cascade, const RenderQueue& queue,
+                                     vector<Model>& models) const -> uint64_t
+{
+    // The cascade region only changes when the camera crosses a snap step or the light turns
+    // (see updateShadowCascades), so camera motion alone keeps the cached layer
+    uint64_t hash = 14695981039346656037ull;
+    hashValue(hash, shadowCascades_[cascade].viewProjection);
+    for (const DrawItem& item : queue.items()) {
+        hashValue(hash, item.modelIndex);
+        hashValue(hash, item.meshIndex);
+        hashValue(hash, models[item.modelIndex].modelMatrix());
+    }
+    return hash;
+}
+
+void Renderer::createPipelines(const VkFormat swapChainColorFormat, const VkFormat depthFormat,
+                               VkSampleCountFlagBits msaaSamples)
+{
+    depthFormat_ = depthFormat;
+    msaaSamples_ = msaaSamples;
+
+    pipelines_.emplace("pbrForward",
+                       Pipeline(ctx_, shaderManager_, "pbrForward", VK_FORMAT_R16G16B16A16_SFLOAT,
+                                depthFormat, msaaSamples));
+    for (const char* name : {"pbrForwardAlphaTest", "pbrForwardBlend"}) {
+        pipelines_.emplace(name, Pipeline(ctx_, shaderManager_, name, VK_FORMAT_R16G16B16A16_SFLOAT,
+                                          depthFormat, msaaSamples));
+    }
+    pipelines_.emplace("pbrForwardDepthEqual",
+                       Pipeline(ctx_, shaderManager_, "pbrForwardDepthEqual",
+                                VK_FORMAT_R16G16B16A16_SFLOAT, depthFormat, msaaSamples));
+    pipelines_.emplace("depthPrepass", Pipeline(ctx_, shaderManager_, "depthPrepass",
+                                                VK_FORMAT_UNDEFINED, depthFormat, msaaSamples));
+    pipelines_.emplace("sky", Pipeline(ctx_, shaderManager_, "sky", VK_FORMAT_R16G16B16A16_SFLOAT,
+                                       depthFormat, msaaSamples));
+    pipelines_.emplace("pbrDeferred", Pipeline(ctx_, shaderManager_, "pbrDeferred",
+                                               VK_FORMAT_UNDEFINED, depthFormat,
+                                               VK_SAMPLE_COUNT_1_BIT));
+    pipelines_.emplace("pbrDeferredAlphaTest",
+                       Pipeline(ctx_, shaderManager_, "pbrDeferredAlphaTest", VK_FORMAT_UNDEFINED,
+                                depthFormat, VK_SAMPLE_COUNT_1_BIT));
+    pipelines_.emplace("deferredLighting",
+                       Pipeline(ctx_, shaderManager_, "deferredLighting",
+                                VK_FORMAT_R16G16B16A16_SFLOAT, depthFormat, VK_SAMPLE_COUNT_1_BIT));
+    // Same shaders as "sky" but single-sampled for the deferred path
+    pipelines_.emplace("skyDeferred", Pipeline(ctx_, shaderManager_, "sky",
+                                               VK_FORMAT_R16G16B16A16_SFLOAT, depthFormat,
+                                               VK_SAMPLE_COUNT_1_BIT));
+    for (const char* name : {"ssaoDownsample", "ssao", "ssaoTemporal", "ssaoUpsample"}) {
+        pipelines_.emplace(name, Pipeline(ctx_, shaderManager_, name, VK_FORMAT_UNDEFINED,
+                                          VK_FORMAT_UNDEFINED, VK_SAMPLE_COUNT_1_BIT));
+    }
+    for (const char* name : {"clusterLights", "depthPyramid", "occlusionCull"}) {
+        pipelines_.emplace(name, Pipeline(ctx_, shaderManager_, name, VK_FORMAT_UNDEFINED,
+                                          VK_FORMAT_UNDEFINED, VK_SAMPLE_COUNT_1_BIT));
+    }
+    pipelines_.emplace("post", Pipeline(ctx_, shaderManager_, "post", swapChainColorFormat,
+                                        depthFormat, VK_SAMPLE_COUNT_1_BIT));
+    for (const char* name : {"shadowMap", "shadowMapAlphaTest"}) {
+        pipelines_.emplace(name, Pipeline(ctx_, shaderManager_, name, VK_FORMAT_D16_UNORM,
+                                          VK_FORMAT_D16_UNORM, VK_SAMPLE_COUNT_1_BIT));
+    }
+}
+
+void Renderer::createTextures(uint32_t swapchainWidth, uint32_t swapchainHeight,
+                              VkSampleCountFlagBits msaaSamples)
+{
+    samplerLinearRepeat_.createLinearRepeat();
+    samplerLinearClamp_.createLinearClamp();
+    samplerAnisoRepeat_.createAnisoRepeat();
+    samplerAnisoClamp_.createAnisoClamp();
+
+    string dummyImagePath = kAssetsPathPrefix_ + "textures/blender_uv_grid_2k.png";
+
+    // Load texture from file using stb_image
+    {
+        int width, height, channels;
+        unsigned char* pixels =
+            stbi_load(dummyImagePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+        if (!pixels) {
+            exitWithMessage("Failed to load texture image: {}", dummyImagePath);
+        }
+
+        dummyTexture_.createFromPixelData(pixels, width, height, channels, true);
+
+        // Free the loaded image data (only if we loaded from file)
+        if (pixels != nullptr && dummyImagePath.find(".png") != string::npos) {
+            stbi_image_free(pixels);
+        }
+
+        dummyTexture_.setSampler(samplerLinearRepeat_.handle());
+    }
+
+    // Initialize IBL textures for PBR
+    string path = kAssetsPathPrefix_ + "textures/golden_gate_hills_4k/";
+    skyTextures_.loadKtxMaps(path + "specularGGX.ktx2", path + "diffuseLambertian.ktx2",
+                             path + "outputLUT.png");
+
+    // Create render targets. The transient ones get their memory from renderGraph_.
+    msaaColorBuffer_.createUnbound(
+        VK_FORMAT_R16G16B16A16_SFLOAT, swapchainWidth, swapchainHeight, msaaSamples,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+    msaaDepthStencil_.createUnbound(swapchainWidth, swapchainHeight, msaaSamples,
+                                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                        VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+
+    // Images that SSAO uses, on the compute queue with async compute
+    for (Image2D* image : {&gBufferNormal_, &ssaoDepth_, &ssaoNormal_, &ssaoRaw_,
+                           &ssaoHistory_[0], &ssaoHistory_[1], &ssaoFull_}) {
+        image->shareWithComputeQueue();
+    }
+    depthStencil_.shareWithComputeQueue();
+
+    depthStencil_.create(swapchainWidth, swapchainHeight, VK_SAMPLE_COUNT_1_BIT);
+    forwardToCompute_.createGeneralStorage(swapchainWidth, swapchainHeight);
+
+    const array<VkFormat, 4> gBufferFormats = Pipeline::gBufferFormats(ctx_);
+    const VkImageUsageFlags gBufferUsage =
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    gBufferAlbedo_.createUnbound(gBufferFormats[0], swapchainWidth, swapchainHeight,
+                                 VK_SAMPLE_COUNT_1_BIT, gBufferUsage);
+    gBufferNormal_.createUnbound(gBufferFormats[1], swapchainWidth, swapchainHeight,
+                                 VK_SAMPLE_COUNT_1_BIT, gBufferUsage);
+    gBufferMaterial_.createUnbound(gBufferFormats[2], swapchainWidth, swapchainHeight,
+                                   VK_SAMPLE_COUNT_1_BIT, gBufferUsage);
+    gBufferEmissive_.createUnbound(gBufferFormats[3], swapchainWidth, swapchainHeight,
+                                   VK_SAMPLE_COUNT_1_BIT, gBufferUsage);
+
+    createRenderGraph();
+
+    const uint32_t halfWidth = (swapchainWidth + 1) / 2;
+    const uint32_t halfHeight = (swapchainHeight + 1) / 2;
+    ssaoDepth_.createStorage(VK_FORMAT_R32_SFLOAT, halfWidth, halfHeight);
+    ssaoNormal_.createStorage(VK_FORMAT_R8G8B8A8_UNORM, halfWidth, halfHeight);
+    ssaoRaw_.createStorage(VK_FORMAT_R32_SFLOAT, halfWidth, halfHeight);
+    for (Image2D& history : ssaoHistory_) {
+        history.createStorage(VK_FORMAT_R32G32_SFLOAT, halfWidth, halfHeight);
+    }
+    ssaoFull_.createStorage(VK_FORMAT_R32_SFLOAT, swapchainWidth, swapchainHeight);
+    depthPyramid_.create(swapchainWidth, swapchainHeight);
+    screenHeight_ = swapchainHeight;
+
+    clusterUBO_.tileSize =
+        glm::vec4(float((swapchainWidth + ClusterUniform::kGridX - 1) / ClusterUniform::kGridX),
+                  float((swapchainHeight + ClusterUniform::kGridY - 1) / ClusterUniform::kGridY),
+                  float(swapchainWidth), float(swapchainHeight));
+
+    // Set samplers
+    forwardToCompute_.setSampler(samplerLinearRepeat_.handle());
+
+    // The lighting pass uses texelFetch, samplers are only needed for the descriptor type
+    gBufferAlbedo_.setSampler(samplerLinearClamp_.handle());
+    gBufferNormal_.setSampler(samplerLinearClamp_.handle());
+    gBufferMaterial_.setSampler(samplerLinearClamp_.handle());
+    gBufferEmissive_.setSampler(samplerLinearClamp_.handle());
+    depthStencil_.setSampler(samplerLinearClamp_.handle());
+
+    // Create descriptor sets for sky textures (set 1 for sky pipeline)
+    skyDescriptorSet_.create(ctx_, {skyTextures_.prefiltered().resourceBinding(),
+                                    skyTextures_.irradiance().resourceBinding(),
+                                    skyTextures_.brdfLUT().resourceBinding()});
+
+    // Create descriptor set for shadow mapping
+    shadowMapSet_.create(ctx_, {shadowMap_.resourceBinding()});
+
+    // Create descriptor set for the G-buffer (set 1 for deferredLighting pipeline)
+    gBufferSet_.create(ctx_, {gBufferAlbedo_.resourceBinding(), gBufferNormal_.resourceBinding(),
+                              gBufferMaterial_.resourceBinding(),
+                              gBufferEmissive_.resourceBinding(), depthStencil_.resourceBinding(),
+                              ssaoFull_.resourceBinding()});
+
+    // Descriptor sets of the SSAO compute passes (set 1, set 0 for ssaoDownsample)
+    ssaoDownsampleSet_.create(ctx_, {depthStencil_.resourceBinding(),
+                                     gBufferNormal_.resourceBinding(), ssaoDepth_.resourceBinding(),
+                                     ssaoNormal_.resourceBinding()});
+    ssaoSet_.create(ctx_, {ssaoDepth_.resourceBinding(), ssaoNormal_.resourceBinding(),
+                           ssaoRaw_.resourceBinding()});
+    for (uint32_t i = 0; i < 2; i++) {
+        ssaoTemporalSets_[i].create(ctx_, {ssaoRaw_.resourceBinding(), ssaoDepth_.resourceBinding(),
+                                           ssaoHistory_[1 - i].resourceBinding(),
+                                           ssaoHistory_[i].resourceBinding()});
+        ssaoUpsampleSets_[i].create(ctx_, {depthStencil_.resourceBinding(),
+                                           ssaoHistory_[i].resourceBinding(),
+                                           ssaoFull_.resourceBinding()});
+    }
+
+    // One set per depth pyramid level, level 0 reads the depth buffer only
+    for (uint32_t level = 0; level < depthPyramid_.levelCount(); level++) {
+        const uint32_t source = level > 0 ? level - 1 : 0;
+        depthPyramidSets_[level].create(ctx_, {depthStencil_.resourceBinding(),
+                                               depthPyramid_.levelBinding(source),
+                                               depthPyramid_.levelBinding(level)});
+    }
+}
+
+void Renderer::createRenderGraph()
+{
+    using Usage = RenderGraph::Usage;
+
+    renderGraph_.cleanup();
+
+    const uint32_t msaaColor = renderGraph_.addTransientImage("msaaColor", msaaColorBuffer_, true);
+    const uint32_t msaaDepth = renderGraph_.addTransientImage("msaaDepth", msaaDepthStencil_, true);
+    const uint32_t albedo = renderGraph_.addTransientImage("gBufferAlbedo", gBufferAlbedo_);
+    const uint32_t normal = renderGraph_.addTransientImage("gBufferNormal", gBufferNormal_);
+    const uint32_t material = renderGraph_.addTransientImage("gBufferMaterial", gBufferMaterial_);
+    const uint32_t emissive = renderGraph_.addTransientImage("gBufferEmissive", gBufferEmissive_);
+    const uint32_t depth = renderGraph_.importImage("depth", depthStencil_.barrierHelper_);
+    const uint32_t hdr = renderGraph_.importImage("hdr", forwardToCompute_.barrierHelper());
+
+    // Forward passes first, then deferred: their targets are never alive at the same time
+    graphPasses_.depthPrepass =
+        renderGraph_.addPass("depthPrepass", {{msaaDepth, Usage::DepthAttachment}});
+    graphPasses_.forward = renderGraph_.addPass("forward", {{msaaColor, Usage::ColorAttachment},
+                                                            {msaaDepth, Usage::DepthAttachment},
+                                                            {hdr, Usage::ColorAttachment},
+                                                            {depth, Usage::DepthResolve}});
+    graphPasses_.gBuffer = renderGraph_.addPass("gBuffer", {{albedo, Usage::ColorAttachment},
+                                                            {normal, Usage::ColorAttachment},
+                                                            {material, Usage::ColorAttachment},
+                                                            {emissive, Usage::ColorAttachment},
+                                                            {depth, Usage::DepthAttachment}});
+
+    // 주의: SSAO와 라이팅에서 샘플링하고 이어서 하늘 그릴 때 깊이 테스트에도 쓰기 때문에
+    //      쓰기 없이 읽기 전용 레이아웃 하나로 모든 용도를 처리합니다.
+    graphPasses_.ssao = renderGraph_.addPass(
+        "ssao", {{normal, Usage::SampledCompute}, {depth, Usage::DepthReadOnly}});
+    graphPasses_.lighting = renderGraph_.addPass("lighting", {{albedo, Usage::SampledFragment},
+                                                              {normal, Usage::SampledFragment},
+                                                              {material, Usage::SampledFragment},
+                                                              {emissive, Usage::SampledFragment},
+                                                              {depth, Usage::DepthReadOnly},
+                                                              {hdr, Usage::ColorAttachment}});
+    graphPasses_.post = renderGraph_.addPass("post", {{hdr, Usage::SampledFragment}});
+
+    renderGraph_.compile();
+}
+
+void Renderer::updateViewFrustum(const glm::mat4& viewProjection)
+{
+    viewProjection_ = viewProjection;
+    if (frustumCullingEnabled_) {
+        viewFrustum_.extractFromViewProjection(viewProjection);
+    }
+}
+
+void Renderer::performFrustumCulling(vector<Model>& models)
+{
+    HLAB_PROFILE_SCOPE("Renderer::performFrustumCulling");
+
+    cullingStats_.totalMeshes = 0;
+    cullingStats_.culledMeshes = 0;
+    cullingStats_.renderedMeshes = 0;
+    cullingStats_.contributionCulledMeshes = 0;
+    cullingStats_.softwareOccludedMeshes = 0;
+    cullingStats_.softwareOccluderTriangles = 0;
+    cullingStats_.softwareOcclusionMs = 0.0f;
+
+    if (!frustumCullingEnabled_) {
+        for (auto& model : models) {
+            for (auto& mesh : model.meshes()) {
+                mesh.isCulled = false;
+                cullingStats_.totalMeshes++;
+                cullingStats_.renderedMeshes++;
+            }
+        }
+        return;
+    }
+
+    for (auto& model : models) {
         for (auto& mesh : model.meshes()) {
             cullingStats_.totalMeshes++;
 
@@ -470,6 +2298,364 @@ void Renderer::performFrustumCulling(vector<Model>& models)
             }
         }
     }
+
+    if (contributionCullingThreshold_ > 0.0f) {
+        performContributionCulling(models);
+    }
+    if (softwareOcclusionEnabled_) {
+        performSoftwareOcclusionCulling(models);
+    }
+}
+
+void Renderer::performContributionCulling(vector<Model>& models)
+{
+    // Pixels per world unit at view depth 1 (projection[1][1] is negative with the y flip)
+    const float pixelsPerUnit = std::abs(sceneUBO_.projection[1][1]) * 0.5f * float(screenHeight_);
+    const glm::vec4 depthRow(viewProjection_[0][3], viewProjection_[1][3], viewProjection_[2][3],
+                             viewProjection_[3][3]);
+
+    for (Model& model : models) {
+        for (Mesh& mesh : model.meshes()) {
+            if (mesh.isCulled) {
+                continue;
+            }
+
+            // The bounding sphere overestimates the covered area, so nothing visible enough is
+            // dropped
+            const float radius = glm::length(mesh.worldBounds.getExtents());
+            const float depth = glm::dot(depthRow, glm::vec4(mesh.worldBounds.getCenter(), 1.0f));
+            if (depth <= radius) {
+                continue; // The camera is inside or close to the sphere
+            }
+
+            const float radiusPixels = radius / depth * pixelsPerUnit;
+            // The threshold is a projected area in pixels, not a diameter
+            if (glm::pi<float>() * radiusPixels * radiusPixels < contributionCullingThreshold_) {
+                mesh.isCulled = true;
+                cullingStats_.renderedMeshes--;
+                cullingStats_.contributionCulledMeshes++;
+            }
+        }
+    }
+}
+
+void Renderer::performSoftwareOcclusionCulling(vector<Model>& models)
+{
+    const auto start = chrono::steady_clock::now();
+
+    softwareOcclusion_.beginFrame(viewProjection_);
+    for (const SoftwareOccluder& occluder : softwareOccluders_) {
+        Model& model = models[occluder.modelIndex];
+        if (model.visible() && !model.meshes()[occluder.meshIndex].isCulled) {
+            softwareOcclusion_.renderOccluder(occluder.occluder, model.modelMatrix());
+        }
+    }
+    softwareOcclusion_.rasterize();
+
+    // Occluders are not tested: they lie on the depth they wrote
+    for (size_t j = 0; j < models.size(); j++) {
+        vector<Mesh>& meshes = models[j].meshes();
+        for (size_t i = 0; i < meshes.size(); i++) {
+            Mesh& mesh = meshes[i];
+            if (mesh.isCulled || isSoftwareOccluder_[meshOffsets_[j] + i]) {
+                continue;
+            }
+            if (!softwareOcclusion_.isVisible(mesh.worldBounds)) {
+                mesh.isCulled = true;
+                cullingStats_.renderedMeshes--;
+                cullingStats_.softwareOccludedMeshes++;
+            }
+        }
+    }
+
+    cullingStats_.softwareOccluderTriangles = softwareOcclusion_.triangleCount();
+    cullingStats_.softwareOcclusionMs =
+        chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+}
+
+void Renderer::setCamera(const Camera& camera)
+{
+    sceneUBO_.projection = camera.matrices.perspective;
+    sceneUBO_.view = camera.matrices.view;
+    sceneUBO_.cameraPos = glm::vec3(glm::inverse(camera.matrices.view)[3]);
+}
+
+void Renderer::cullScene(vector<Model>& models)
+{
+    updateViewFrustum(sceneUBO_.projection * sceneUBO_.view);
+
+    // Skinned meshes follow the current pose (the shaders only animate when this holds)
+    static const vector<glm::mat4> noBones;
+    for (auto& model : models) {
+        const vector<glm::mat4>& boneMatrices =
+            model.hasAnimations() && model.hasBones() ? model.getBoneMatrices() : noBones;
+        for (auto& mesh : model.meshes()) {
+            mesh.updateWorldBounds(model.modelMatrix(), boneMatrices);
+        }
+    }
+
+    performFrustumCulling(models);
+    performShadowCulling(models);
+}
+
+void Renderer::fitShadowsToScene(const vector<Model>& models)
+{
+    if (models.empty()) {
+        return;
+    }
+
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), -sceneUBO_.directionalLightDir,
+                                      glm::vec3(0.0f, 0.0f, 1.0f));
+
+    // Combined world space bounding box of all models
+    glm::vec3 min_(numeric_limits<float>::max());
+    glm::vec3 max_(numeric_limits<float>::lowest());
+    for (const auto& model : models) {
+        const glm::vec3 modelMin =
+            glm::vec3(model.modelMatrix() * glm::vec4(model.boundingBoxMin(), 1.0f));
+        const glm::vec3 modelMax =
+            glm::vec3(model.modelMatrix() * glm::vec4(model.boundingBoxMax(), 1.0f));
+        min_ = glm::min(min_, glm::min(modelMin, modelMax));
+        max_ = glm::max(max_, glm::max(modelMin, modelMax));
+    }
+
+    const AABB sceneBounds(min_, max_);
+
+    glm::vec3 corners[] = {
+        glm::vec3(min_.x, min_.y, min_.z), glm::vec3(min_.x, max_.y, min_.z),
+        glm::vec3(min_.x, min_.y, max_.z), glm::vec3(min_.x, max_.y, max_.z),
+        glm::vec3(max_.x, min_.y, min_.z), glm::vec3(max_.x, max_.y, min_.z),
+        glm::vec3(max_.x, min_.y, max_.z), glm::vec3(max_.x, max_.y, max_.z),
+    };
+    glm::vec3 vmin(numeric_limits<float>::max());
+    glm::vec3 vmax(numeric_limits<float>::lowest());
+    for (size_t i = 0; i != 8; i++) {
+        auto temp = glm::vec3(lightView * glm::vec4(corners[i], 1.0f));
+        vmin = glm::min(vmin, temp);
+        vmax = glm::max(vmax, temp);
+    }
+    glm::mat4 lightProjection = glm::orthoLH_ZO(vmin.x, vmax.x, vmin.y, vmax.y, vmax.z,
+                                                vmin.z); // 마지막 Max, Min 순서 주의
+    sceneUBO_.lightSpaceMatrix = lightProjection * lightView;
+    updateShadowCascades(sceneBounds);
+
+    // Modifed "Vulkan 3D Graphics Rendering Cookbook - 2nd Edition Build Status"
+    // https://github.com/PacktPublishing/3D-Graphics-Rendering-Cookbook-Second-Edition
+}
+
+void Renderer::updateShadowCascades(const AABB& sceneBounds)
+{
+    const glm::mat4& projection = sceneUBO_.projection;
+    const float zNear = projection[3][2] / projection[2][2];
+    const float zFar = projection[3][2] / (1.0f + projection[2][2]);
+
+    // Shadows reach as far as the scene is large. The distance does not depend on the camera
+    // and is rounded up to a power of two (animated models change the bounds slightly), so the
+    // splits, the cascade sizes and with them the texel sizes stay fixed while the camera moves.
+    const float sceneSize = std::max(glm::length(sceneBounds.max - sceneBounds.min), zNear);
+    const float shadowFar = std::clamp(std::exp2(std::ceil(std::log2(sceneSize))),
+                                       zNear * 1.01f, zFar);
+
+    // Same light view as sceneUBO_.lightSpaceMatrix; depth grows away from the light
+    const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), -sceneUBO_.directionalLightDir,
+                                            glm::vec3(0.0f, 0.0f, 1.0f));
+    const AABB sceneLight = sceneBounds.transform(lightView);
+
+    // Depth range in coarse steps, so animated models moving inside the scene keep it fixed
+    const float depthStep =
+        std::exp2(std::ceil(std::log2(std::max(sceneLight.max.z - sceneLight.min.z, 1.0f) / 8.0f)));
+    const float lightNear = std::floor(sceneLight.min.z / depthStep) * depthStep;
+    const float lightFar = std::ceil(sceneLight.max.z / depthStep) * depthStep;
+
+    // View space rays through the corners of the near plane, scaled to unit view distance
+    const glm::mat4 inverseProjection = glm::inverse(projection);
+    const glm::mat4 inverseView = glm::inverse(sceneUBO_.view);
+    glm::vec3 cornerRays[4];
+    for (uint32_t i = 0; i < 4; i++) {
+        const glm::vec2 ndc((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f);
+        const glm::vec4 p = inverseProjection * glm::vec4(ndc, 0.0f, 1.0f);
+        const glm::vec3 ray = glm::vec3(p) / p.w;
+        cornerRays[i] = ray / -ray.z;
+    }
+
+    float sliceNear = zNear;
+    for (uint32_t c = 0; c < ShadowMap::kCascadeCount; c++) {
+        // Practical split scheme: blend of uniform and logarithmic splits
+        const float fraction = float(c + 1) / float(ShadowMap::kCascadeCount);
+        const float uniformSplit = zNear + (shadowFar - zNear) * fraction;
+        const float logSplit = zNear * std::pow(shadowFar / zNear, fraction);
+        const float sliceFar = glm::mix(uniformSplit, logSplit, cascadeSplitLambda_);
+
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (uint32_t i = 0; i < 8; i++) {
+            const float distance = (i < 4) ? sliceNear : sliceFar;
+            corners[i] = glm::vec3(inverseView * glm::vec4(cornerRays[i % 4] * distance, 1.0f));
+            center += corners[i] / 8.0f;
+        }
+
+        // A bounding sphere keeps the cascade size fixed while the camera rotates
+        float radius = 0.0f;
+        for (const glm::vec3& corner : corners) {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        // The cascade covers a world-snapped light space region: its center moves in steps of a
+        // quarter of the slice radius (whole texels, so the shadow edges do not shimmer) and the
+        // extent grows by one step to still cover the slice. The region, and with it the static
+        // shadow cache, stays fixed while the camera moves inside a step.
+        const float extent = std::ceil(radius * 1.25f * 16.0f) / 16.0f;
+        const float texelSize = 2.0f * extent / float(shadowMap_.width());
+        const float snapStep = std::max(std::floor(radius * 0.25f / texelSize), 1.0f) * texelSize;
+        glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+        lightCenter.x = std::floor(lightCenter.x / snapStep) * snapStep + snapStep * 0.5f;
+        lightCenter.y = std::floor(lightCenter.y / snapStep) * snapStep + snapStep * 0.5f;
+
+        const glm::mat4 lightProjection =
+            glm::orthoLH_ZO(lightCenter.x - extent, lightCenter.x + extent,
+                            lightCenter.y - extent, lightCenter.y + extent, lightFar,
+                            lightNear); // 마지막 Max, Min 순서 주의
+
+        ShadowCascade& cascade = shadowCascades_[c];
+        cascade.viewProjection = lightProjection * lightView;
+        cascade.frustum.extractFromViewProjection(cascade.viewProjection);
+
+        // The slice in the cascade's clip space, limited to the cascade volume
+        AABB receivers(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+        for (const glm::vec3& corner : corners) {
+            const glm::vec4 p = cascade.viewProjection * glm::vec4(corner, 1.0f);
+            receivers.min = glm::min(receivers.min, glm::vec3(p) / p.w);
+            receivers.max = glm::max(receivers.max, glm::vec3(p) / p.w);
+        }
+        cascade.receivers.min = glm::max(receivers.min, glm::vec3(-1.0f, -1.0f, 0.0f));
+        cascade.receivers.max = glm::min(receivers.max, glm::vec3(1.0f));
+
+        sceneUBO_.cascadeMatrices[c] = cascade.viewProjection;
+        sceneUBO_.cascadeSplits[c] = sliceFar;
+        sliceNear = sliceFar;
+    }
+}
+
+void Renderer::performShadowCulling(vector<Model>& models)
+{
+    HLAB_PROFILE_SCOPE("Renderer::performShadowCulling");
+
+    cullingStats_.shadowCulledMeshes = 0;
+    cullingStats_.shadowRenderedMeshes = 0;
+
+    const uint32_t allCascades = (1u << ShadowMap::kCascadeCount) - 1;
+
+    for (auto& model : models) {
+        for (auto& mesh : model.meshes()) {
+            uint32_t cascadeMask = allCascades;
+            if (shadowCullingEnabled_) {
+                cascadeMask = 0;
+                for (uint32_t c = 0; c < ShadowMap::kCascadeCount; c++) {
+                    const ShadowCascade& cascade = shadowCascades_[c];
+                    if (!cascade.frustum.intersects(mesh.worldBounds)) {
+                        continue;
+                    }
+
+                    // Depth grows away from the light, so a caster starting beyond the far end
+                    // of the receivers or missing them in x/y cannot shadow this slice
+                    if (receiverShadowCullingEnabled_) {
+                        const AABB caster = mesh.worldBounds.transform(cascade.viewProjection);
+                        const AABB& receivers = cascade.receivers;
+                        if (caster.min.x > receivers.max.x || caster.max.x < receivers.min.x ||
+                            caster.min.y > receivers.max.y || caster.max.y < receivers.min.y ||
+                            caster.min.z > receivers.max.z) {
+                            continue;
+                        }
+                    }
+                    cascadeMask |= 1u << c;
+                }
+            }
+
+            mesh.shadowCascadeMask = cascadeMask;
+
+            if (cascadeMask != 0) {
+                cullingStats_.shadowRenderedMeshes++;
+            } else {
+                cullingStats_.shadowCulledMeshes++;
+            }
+        }
+    }
+}
+
+bool Renderer::isShadowCullingEnabled() const
+{
+    return shadowCullingEnabled_;
+}
+
+void Renderer::setShadowCullingEnabled(bool enabled)
+{
+    shadowCullingEnabled_ = enabled;
+}
+
+bool Renderer::isReceiverShadowCullingEnabled() const
+{
+    return receiverShadowCullingEnabled_;
+}
+
+void Renderer::setReceiverShadowCullingEnabled(bool enabled)
+{
+    receiverShadowCullingEnabled_ = enabled;
+}
+
+bool Renderer::isDepthPrepassEnabled() const
+{
+    return depthPrepassEnabled_;
+}
+
+void Renderer::setDepthPrepassEnabled(bool enabled)
+{
+    depthPrepassEnabled_ = enabled;
+}
+
+bool Renderer::isOcclusionCullingEnabled() const
+{
+    return occlusionCullingEnabled_;
+}
+
+void Renderer::setOcclusionCullingEnabled(bool enabled)
+{
+    // The history of a previous run no longer matches the scene
+    if (enabled != occlusionCullingEnabled_) {
+        occlusionHistoryValid_ = false;
+    }
+    occlusionCullingEnabled_ = enabled;
+}
+
+bool Renderer::isStaticShadowCachingEnabled() const
+{
+    return staticShadowCachingEnabled_;
+}
+
+void Renderer::setStaticShadowCachingEnabled(bool enabled)
+{
+    staticShadowCachingEnabled_ = enabled;
+    std::fill(std::begin(staticShadowSignatures_), std::end(staticShadowSignatures_), 0);
+}
+
+auto Renderer::contributionCullingThreshold() const -> float
+{
+    return contributionCullingThreshold_;
+}
+
+void Renderer::setContributionCullingThreshold(float pixels)
+{
+    contributionCullingThreshold_ = std::max(pixels, 0.0f);
+}
+
+bool Renderer::isSoftwareOcclusionEnabled() const
+{
+    return softwareOcclusionEnabled_;
+}
+
+void Renderer::setSoftwareOcclusionEnabled(bool enabled)
+{
+    softwareOcclusionEnabled_ = enabled;
 }
 
 void Renderer::setFrustumCullingEnabled(bool enabled)
@@ -487,6 +2673,239 @@ const CullingStats& Renderer::getCullingStats() const
     return cullingStats_;
 }
 
+auto Renderer::renderPath() const -> RenderPath
+{
+    return renderPath_;
+}
+
+void Renderer::setRenderPath(RenderPath path)
+{
+    renderPath_ = path;
+}
+
+bool Renderer::isRenderPathAlternating() const
+{
+    return alternateRenderPaths_;
+}
+
+void Renderer::setRenderPathAlternating(bool alternating)
+{
+    alternateRenderPaths_ = alternating;
+}
+
+auto Renderer::gpuTimer() const -> const GpuTimer&
+{
+    return gpuTimer_;
+}
+
+auto Renderer::gpuTimer() -> GpuTimer&
+{
+    return gpuTimer_;
+}
+
+auto Renderer::renderQueueStats() const -> const RenderQueueStats&
+{
+    return renderQueueStats_;
+}
+
+auto Renderer::renderGraphStats() const -> const RenderGraph::Stats&
+{
+    return renderGraph_.stats();
+}
+
+auto Renderer::barrierCallCount() const -> uint32_t
+{
+    return barrierCalls_;
+}
+
+void Renderer::reportBenchmarkStats(Benchmark& benchmark) const
+{
+    benchmark.addGpuScopes(gpuTimer_.resolvedScopes());
+
+    benchmark.addCounter("meshes", cullingStats_.totalMeshes);
+    benchmark.addCounter("renderedMeshes", cullingStats_.renderedMeshes);
+    benchmark.addCounter("culledMeshes", cullingStats_.culledMeshes);
+    benchmark.addCounter("contributionCulledMeshes", cullingStats_.contributionCulledMeshes);
+    benchmark.addCounter("softwareOccludedMeshes", cullingStats_.softwareOccludedMeshes);
+    benchmark.addCounter("occludedMeshes", cullingStats_.occludedMeshes);
+    benchmark.addCounter("shadowRenderedMeshes", cullingStats_.shadowRenderedMeshes);
+    benchmark.addCounter("shadowDraws", cullingStats_.shadowDraws);
+
+    benchmark.addCounter("draws", renderQueueStats_.draws);
+    benchmark.addCounter("instances", renderQueueStats_.instances);
+    benchmark.addCounter("pipelineBinds", renderQueueStats_.pipelineBinds);
+    benchmark.addCounter("descriptorSetBinds", renderQueueStats_.descriptorSetBinds);
+    benchmark.addCounter("passesReused", renderQueueStats_.passesReused);
+    benchmark.addCounter("barrierCalls", barrierCalls_);
+    benchmark.addCounter("localLights", clusterStats_.lightCount);
+
+    if (framePipelineStatistics_) {
+        for (const auto& [name, stats] : pipelineStatistics_.resolvedPasses()) {
+            benchmark.addCounter(name + ".inputPrimitives", double(stats.inputPrimitives));
+            benchmark.addCounter(name + ".vertexInvocations", double(stats.vertexInvocations));
+            benchmark.addCounter(name + ".clippingPrimitives", double(stats.clippingPrimitives));
+            benchmark.addCounter(name + ".fragmentInvocations",
+                                 double(stats.fragmentInvocations));
+        }
+    }
+}
+
+bool Renderer::isAsyncComputeAvailable() const
+{
+    // On one queue the compute batch would wait for a batch submitted after it
+    return ctx_.computeQueue() != ctx_.graphicsQueue();
+}
+
+bool Renderer::isAsyncComputeEnabled() const
+{
+    return asyncComputeEnabled_;
+}
+
+void Renderer::setAsyncComputeEnabled(bool enabled)
+{
+    asyncComputeEnabled_ = enabled && isAsyncComputeAvailable();
+}
+
+bool Renderer::isInstancingEnabled() const
+{
+    return instancingEnabled_;
+}
+
+void Renderer::setInstancingEnabled(bool enabled)
+{
+    instancingEnabled_ = enabled;
+}
+
+bool Renderer::isParallelRecordingEnabled() const
+{
+    return parallelRecordingEnabled_;
+}
+
+void Renderer::setParallelRecordingEnabled(bool enabled)
+{
+    parallelRecordingEnabled_ = enabled;
+}
+
+auto Renderer::recordingThreadCount() const -> uint32_t
+{
+    return commandRecorder_.threadCount();
+}
+
+bool Renderer::isCommandCachingEnabled() const
+{
+    return commandCachingEnabled_;
+}
+
+void Renderer::setCommandCachingEnabled(bool enabled)
+{
+    commandCachingEnabled_ = enabled;
+}
+
+bool Renderer::isPipelineStatisticsAvailable() const
+{
+    // A query of the primary is only inherited by secondaries with inheritedQueries
+    const bool secondaries = parallelRecordingEnabled_ || commandCachingEnabled_;
+    return pipelineStatistics_.isSupported() &&
+           (!secondaries || ctx_.enabledFeatures().inheritedQueries);
+}
+
+bool Renderer::isPipelineStatisticsEnabled() const
+{
+    return pipelineStatisticsEnabled_;
+}
+
+void Renderer::setPipelineStatisticsEnabled(bool enabled)
+{
+    pipelineStatisticsEnabled_ = enabled;
+}
+
+auto Renderer::pipelineStatistics() const -> const PipelineStatistics&
+{
+    return pipelineStatistics_;
+}
+
+void Renderer::beginPassStatistics(VkCommandBuffer cmd, const string& name)
+{
+    if (framePipelineStatistics_) {
+        pipelineStatistics_.begin(cmd, name);
+    }
+}
+
+void Renderer::endPassStatistics(VkCommandBuffer cmd)
+{
+    if (framePipelineStatistics_) {
+        pipelineStatistics_.end(cmd);
+    }
+}
+
+auto Renderer::localLights() -> vector<LocalLight>&
+{
+    return localLights_;
+}
+
+void Renderer::generateLocalLights(const vector<Model>& models, int count, float range,
+                                   float intensity)
+{
+    localLights_.clear();
+
+    bool hasBounds = false;
+    AABB bounds;
+    for (const auto& model : models) {
+        for (const auto& mesh : model.meshes()) {
+            if (!hasBounds) {
+                bounds = mesh.worldBounds;
+                hasBounds = true;
+            } else {
+                bounds.min = glm::min(bounds.min, mesh.worldBounds.min);
+                bounds.max = glm::max(bounds.max, mesh.worldBounds.max);
+            }
+        }
+    }
+    if (!hasBounds || count <= 0) {
+        return;
+    }
+
+    // Fixed seed so that timings are comparable between runs
+    mt19937 rng(1234);
+    uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // Lights near the ground (lowest quarter of the scene)
+    const glm::vec3 extent = bounds.max - bounds.min;
+    localLights_.reserve(count);
+    for (int i = 0; i < count; i++) {
+        LocalLight light;
+        light.position = bounds.min + glm::vec3(unit(rng), unit(rng) * 0.25f, unit(rng)) * extent;
+        light.range = range;
+
+        const glm::vec3 color = glm::vec3(unit(rng), unit(rng), unit(rng)) + 0.2f;
+        light.color = color / std::max(color.r, std::max(color.g, color.b)) * intensity;
+
+        // Every fourth light is a spot light pointing down
+        if (i % 4 == 3) {
+            light.direction = glm::normalize(glm::vec3(unit(rng) - 0.5f, -1.0f, unit(rng) - 0.5f));
+            light.spotCosOuter = std::cos(glm::radians(35.0f));
+            light.spotCosInner = std::cos(glm::radians(25.0f));
+        }
+
+        localLights_.push_back(light);
+    }
+}
+
+auto Renderer::clusterStats() const -> const ClusterStats&
+{
+    return clusterStats_;
+}
+
+auto Renderer::ssaoHistoryBlend() const -> float
+{
+    return ssaoHistoryBlend_;
+}
+
+void Renderer::setSsaoHistoryBlend(float blend)
+{
+    ssaoHistoryBlend_ = glm::clamp(blend, 0.0f, 1.0f);
+}
+
 VkRenderingAttachmentInfo Renderer::createColorAttachment(VkImageView imageView,
                                                           VkAttachmentLoadOp loadOp,
                                                           VkClearColorValue clearColor,
@@ -526,16 +2945,32 @@ VkRenderingAttachmentInfo Renderer::createDepthAttachment(VkImageView imageView,
 VkRenderingInfo
 Renderer::createRenderingInfo(const VkRect2D& renderArea,
                               const VkRenderingAttachmentInfo* colorAttachment,
-                              const VkRenderingAttachmentInfo* depthAttachment) const
+                              const VkRenderingAttachmentInfo* depthAttachment,
+                              uint32_t colorAttachmentCount) const
 {
     VkRenderingInfo renderingInfo{VK_STRUCTURE_TYPE_RENDERING_INFO_KHR};
     renderingInfo.renderArea = renderArea;
     renderingInfo.layerCount = 1;
-    renderingInfo.colorAttachmentCount = colorAttachment ? 1 : 0;
+    renderingInfo.colorAttachmentCount = colorAttachment ? colorAttachmentCount : 0;
     renderingInfo.pColorAttachments = colorAttachment;
     renderingInfo.pDepthAttachment = depthAttachment;
     renderingInfo.pStencilAttachment = depthAttachment;
     return renderingInfo;
 }
 
-} // namespace hlab
\ No newline at end of file
+VkCommandBufferInheritanceRenderingInfo
+Renderer::createInheritanceInfo(const VkFormat* colorFormats, uint32_t colorFormatCount,
+                                VkFormat depthFormat, VkFormat stencilFormat,
+                                VkSampleCountFlagBits samples) const
+{
+    VkCommandBufferInheritanceRenderingInfo inheritanceInfo{
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO};
+    inheritanceInfo.colorAttachmentCount = colorFormatCount;
+    inheritanceInfo.pColorAttachmentFormats = colorFormats;
+    inheritanceInfo.depthAttachmentFormat = depthFormat;
+    inheritanceInfo.stencilAttachmentFormat = stencilFormat;
+    inheritanceInfo.rasterizationSamples = samples;
+    return inheritanceInfo;
+}
+
+} // namespace hlab
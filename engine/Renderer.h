@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Benchmark.h"
 #include "Camera.h"
 #include "DescriptorSet.h"
 #include "Context.h"
@@ -14,6 +15,14 @@
 #include "UniformBuffer.h"
 #include "ShaderManager.h"
 #include "ShadowMap.h"
+#include "DepthPyramid.h"
+#include "SoftwareOcclusion.h"
+#include "GpuTimer.h"
+#include "PipelineStatistics.h"
+#include "RenderQueue.h"
+#include "RenderGraph.h"
+#include "CommandRecorder.h"
+#include "WorkerPool.h"
 #include <glm/glm.hpp>
 #include <vector>
 #include <functional>
@@ -31,6 +40,11 @@ struct SceneUniform // Layout matches pbrForward.vert
     alignas(16) glm::vec3 directionalLightDir = glm::vec3(0.0f, 1.0f, 0.0f); // 16 bytes
     alignas(16) glm::vec3 directionalLightColor = glm::vec3(1.0f);
     alignas(16) glm::mat4 lightSpaceMatrix = glm::mat4(1.0f); // 64 bytes - for shadow mapping
+    alignas(16) glm::mat4 inverseViewProjection = glm::mat4(1.0f); // Set in Renderer::update()
+
+    // Set in Renderer::updateShadowCascades()
+    alignas(16) glm::mat4 cascadeMatrices[ShadowMap::kCascadeCount]{};
+    alignas(16) glm::vec4 cascadeSplits = glm::vec4(0.0f); // Far view distance of each cascade
 };
 
 struct SkyOptionsUBO
@@ -56,6 +70,7 @@ struct OptionsUniform
     alignas(4) float ssaoBias = 0.025f;
     alignas(4) int ssaoSampleCount = 16;
     alignas(4) float ssaoPower = 2.0f;
+    alignas(4) int ssaoOn = 1; // Half resolution SSAO of the deferred path
 };
 
 // Post-processing options uniform buffer structure
@@ -86,6 +101,108 @@ struct PostOptionsUBO
     alignas(4) float padding1 = 0.0f;   // Alignment padding
 };
 
+// Per-model weights for the deferred lighting pass (forward path reads them from push constants)
+struct ModelCoeffsUniform
+{
+    // Model index is stored in 8 bits of the G-buffer. Renderer::prepareForModels() fails with
+    // more models instead of letting them share the last model's coefficients.
+    static constexpr uint32_t kMaxModels = 64;
+
+    alignas(16) glm::vec4 coeffs[kMaxModels]; // x: specular, y: diffuse, z: shadow offset
+};
+
+// Point or spot light for clustered shading (std430 layout of LocalLight in the shaders)
+struct LocalLight
+{
+    alignas(16) glm::vec3 position = glm::vec3(0.0f);
+    alignas(4) float range = 5.0f;                 // Radius of influence
+    alignas(16) glm::vec3 color = glm::vec3(1.0f); // Linear color * intensity
+    alignas(4) float spotCosOuter = -1.0f;         // -1 for point lights
+    alignas(16) glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f); // Spot direction
+    alignas(4) float spotCosInner = -1.0f;
+};
+
+static_assert(sizeof(LocalLight) == 48, "LocalLight must match the std430 layout");
+
+// Froxel grid parameters, shared by clusterLights.comp and the lighting shaders
+struct ClusterUniform
+{
+    static constexpr uint32_t kGridX = 16;
+    static constexpr uint32_t kGridY = 9;
+    static constexpr uint32_t kGridZ = 24;
+    static constexpr uint32_t kClusterCount = kGridX * kGridY * kGridZ;
+    static constexpr uint32_t kMaxLightsPerCluster = 128;
+    static constexpr uint32_t kMaxLights = 4096;
+
+    alignas(16) glm::mat4 view = glm::mat4(1.0f);
+    alignas(16) glm::mat4 inverseProjection = glm::mat4(1.0f);
+    alignas(16) glm::uvec4 gridSize = glm::uvec4(kGridX, kGridY, kGridZ, 0); // w: light count
+    alignas(16) glm::vec4 zParams = glm::vec4(0.0f); // x: near, y: far, z: slice scale, w: bias
+    alignas(16) glm::vec4 tileSize = glm::vec4(0.0f); // xy: cluster pixels, zw: target size
+};
+
+// Written by clusterLights.comp, read back after the frame fence
+struct ClusterStatsData
+{
+    uint32_t totalLightRefs = 0;
+    uint32_t nonEmptyClusters = 0;
+    uint32_t maxLightsPerCluster = 0;
+    uint32_t overflowedClusters = 0; // Clusters that had more than kMaxLightsPerCluster
+};
+
+struct ClusterStats
+{
+    uint32_t lightCount = 0;
+    float averageLightsPerCluster = 0.0f;
+    float averageLightsPerNonEmptyCluster = 0.0f;
+    uint32_t maxLightsPerCluster = 0;
+    uint32_t overflowedClusters = 0;
+};
+
+// One element of the instance buffer (std430, Instance in pbrForward.vert and shadowMap.vert)
+struct InstanceData
+{
+    alignas(16) glm::mat4 model;
+    alignas(16) glm::uvec4 params; // x: model index, y: shadow cascade
+};
+
+static_assert(sizeof(InstanceData) == 80, "InstanceData must match the std430 layout");
+
+// One draw of the render queue tested by occlusionCull.comp (std430, OcclusionDraw there)
+struct OcclusionDraw
+{
+    static constexpr uint32_t kFlagTransparent = 1; // Only drawn in the second pass
+
+    alignas(16) glm::vec4 boundsMin; // World space AABB of all instances of the draw
+    alignas(16) glm::vec4 boundsMax;
+    alignas(16) glm::uvec4 params; // x: command index, y: instances, z: history index, w: flags
+};
+
+static_assert(sizeof(OcclusionDraw) == 48, "OcclusionDraw must match the std430 layout");
+
+// Written by occlusionCull.comp, read back after the frame fence
+struct OcclusionStatsData
+{
+    uint32_t occludedMeshes = 0;
+    uint32_t occludedDraws = 0;
+    uint32_t secondPassMeshes = 0;
+    uint32_t padding = 0;
+};
+
+struct OcclusionCullPushConstants
+{
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::uvec4 params = glm::uvec4(0); // x: draw count, y: phase, z: second pass command offset
+    glm::vec4 pyramidSize = glm::vec4(0.0f); // xy: size of level 0, z: level count
+};
+
+// Push constants shared by ssao.comp and ssaoTemporal.comp
+struct SsaoPushConstants
+{
+    glm::mat4 historyViewProjection = glm::mat4(1.0f); // View-projection of the frame in history
+    glm::vec4 params = glm::vec4(0.0f); // x: frame index, y: history blend, z: history valid
+};
+
 struct BoneDataUniform
 {
     alignas(16) glm::mat4 boneMatrices[256]; // 16,384 bytes (already 16-byte aligned)
@@ -101,11 +218,35 @@ struct VulkanBuffer
     VkBuffer handle_{VK_NULL_HANDLE};
 };
 
+enum class RenderPath {
+    Forward, // MSAA forward shading
+    Deferred // G-buffer + fullscreen lighting (no MSAA)
+};
+
 struct CullingStats
 {
     uint32_t totalMeshes = 0;
     uint32_t culledMeshes = 0;
     uint32_t renderedMeshes = 0;
+
+    // Shadow pass (cascade frustum and receiver culling)
+    uint32_t shadowCulledMeshes = 0;   // Not drawn into any cascade
+    uint32_t shadowRenderedMeshes = 0; // Drawn into at least one cascade
+    uint32_t shadowDraws = 0;          // All cascades, after instancing
+    uint32_t shadowStaticRedraws = 0;  // Cascades whose static caster cache was re-rendered
+
+    // GPU occlusion culling of the main pass, read back after the frame fence
+    uint32_t occludedMeshes = 0;   // Inside the frustum but hidden behind the depth pyramid
+    uint32_t occludedDraws = 0;    // After instancing
+    uint32_t secondPassMeshes = 0; // Opaque meshes not visible last frame, drawn in the 2nd pass
+
+    // Screen-size contribution culling (after the frustum test)
+    uint32_t contributionCulledMeshes = 0;
+
+    // CPU occlusion culling (after the contribution test)
+    uint32_t softwareOccludedMeshes = 0;
+    uint32_t softwareOccluderTriangles = 0; // Rasterized in this frame
+    float softwareOcclusionMs = 0.0f;       // Rasterization and tests
 };
 
 class Renderer
@@ -119,6 +260,9 @@ class Renderer
         cleanup();
     }
 
+    // Shaders of every pipeline the renderer creates, for the ShaderManager it is given
+    static auto pipelineShaders() -> vector<pair<string, vector<string>>>;
+
     void prepareForModels(vector<Model>& models, VkFormat outColorFormat, VkFormat depthFormat,
                           VkSampleCountFlagBits msaaSamples, uint32_t swapChainWidth,
                           uint32_t swapChainHeight);
@@ -128,17 +272,37 @@ class Renderer
     void createTextures(uint32_t swapchainWidth, uint32_t swapchainHeight,
                         VkSampleCountFlagBits msaaSamples);
     void createUniformBuffers();
+    void createRenderGraph();
 
     void cleanup()
     {
-        // Manual cleanup is not necessary
+        // Other members clean up after themselves
+        if (timelineSemaphore_ != VK_NULL_HANDLE) {
+            vkDestroySemaphore(ctx_.device(), timelineSemaphore_, nullptr);
+            timelineSemaphore_ = VK_NULL_HANDLE;
+        }
     }
 
     void update(Camera& camera, uint32_t currentFrame, double time);
+
+    // Per-frame scene update shared by the applications, after the models were animated:
+    // setCamera() writes the camera into sceneUBO(), then fitShadowsToScene(); cullScene()
+    // updates the view frustum and the world bounds of all meshes (skinned meshes follow the
+    // current pose) and runs the frustum and shadow culling for the camera of setCamera().
+    void setCamera(const Camera& camera);
+    void cullScene(vector<Model>& models);
     void updateBoneData(const vector<Model>& models, uint32_t currentFrame); // NEW: Add this method
 
-    void draw(VkCommandBuffer cmd, uint32_t currentFrame, VkImageView swapchainImageView,
-              vector<Model>& models, VkViewport viewport, VkRect2D scissor);
+    // Frame: beginFrame(), makeShadowMap(), draw(), then the caller records the rest of the
+    // frame into the command buffer returned by draw() and ends it before submitFrame().
+    void beginFrame(VkCommandBuffer cmd, uint32_t currentFrame);
+    auto draw(VkCommandBuffer cmd, uint32_t currentFrame, VkImageView swapchainImageView,
+              BarrierHelper& swapchainBarrierHelper, vector<Model>& models, VkViewport viewport,
+              VkRect2D scissor) -> VkCommandBuffer;
+    // frameTimeline (timeline semaphore) is set to frameValue once the whole frame is done.
+    // imageAcquired and renderDone may be VK_NULL_HANDLE when rendering without a swapchain.
+    void submitFrame(VkCommandBuffer cmd, VkSemaphore imageAcquired, VkSemaphore renderDone,
+                     VkSemaphore frameTimeline, uint64_t frameValue);
 
     void makeShadowMap(VkCommandBuffer cmd, uint32_t currentFrame, vector<Model>& models);
 
@@ -149,6 +313,113 @@ class Renderer
     void setFrustumCullingEnabled(bool enabled);
     void updateViewFrustum(const glm::mat4& viewProjection);
 
+    // Stage of performFrustumCulling(): meshes whose projected bounding sphere covers fewer
+    // pixels than the threshold (an area, not a diameter) are not drawn. 0 disables it.
+    auto contributionCullingThreshold() const -> float;
+    void setContributionCullingThreshold(float pixels);
+
+    // Extra stage of performFrustumCulling(): the largest opaque static meshes (chosen in
+    // prepareForModels()) are rasterized on the CPU and the meshes they hide are culled
+    // before the render queue is built. Works for both render paths without GPU feedback.
+    bool isSoftwareOcclusionEnabled() const;
+    void setSoftwareOcclusionEnabled(bool enabled);
+
+    // Fits the shadow cascades to the camera frustum slices (practical split scheme). Each
+    // cascade is a bounding sphere snapped to its texels, so shadows do not shimmer when the
+    // camera moves or rotates. Call with the world bounds of all models before update(),
+    // which uploads sceneUBO().
+    void updateShadowCascades(const AABB& sceneBounds);
+
+    // Fits the directional light projection (sceneUBO().lightSpaceMatrix) to the bounding
+    // boxes of all models, then updates the cascades for the same scene bounds
+    void fitShadowsToScene(const vector<Model>& models);
+
+    // Shadow caster culling against the frustum of every cascade. With receiver culling,
+    // casters whose shadow cannot reach the cascade's slice of the view are dropped too.
+    // Call after updateShadowCascades() and the world bounds update.
+    void performShadowCulling(vector<Model>& models);
+    bool isShadowCullingEnabled() const;
+    void setShadowCullingEnabled(bool enabled);
+    bool isReceiverShadowCullingEnabled() const;
+    void setReceiverShadowCullingEnabled(bool enabled);
+
+    // Static (non-animated) casters are rendered into a cached depth array that is copied into
+    // the shadow map every frame. A cascade's cache is re-rendered only when its matrix (light
+    // direction, camera) or its static casters (set, transforms) change.
+    bool isStaticShadowCachingEnabled() const;
+    void setStaticShadowCachingEnabled(bool enabled);
+
+    // Forward/deferred selection. With alternation enabled the path flips every frame so that
+    // both GPU timings are measured for the same camera.
+    auto renderPath() const -> RenderPath;
+    void setRenderPath(RenderPath path);
+    bool isRenderPathAlternating() const;
+    void setRenderPathAlternating(bool alternating);
+
+    auto gpuTimer() const -> const GpuTimer&;
+    auto gpuTimer() -> GpuTimer&; // For scopes recorded after draw() in the same command buffer
+    auto renderQueueStats() const -> const RenderQueueStats&;
+    auto renderGraphStats() const -> const RenderGraph::Stats&;
+
+    auto barrierCallCount() const -> uint32_t; // vkCmdPipelineBarrier2 calls of the last frame
+
+    // GPU pass times and draw/cull counters of the last frame
+    void reportBenchmarkStats(Benchmark& benchmark) const;
+
+    // Deferred SSAO on the compute queue. The G-buffer is submitted first; the shadow pass
+    // follows in a batch of its own and overlaps SSAO, and the lighting batch waits for SSAO
+    // on a timeline semaphore. Needs a compute queue family apart from the graphics one.
+    bool isAsyncComputeAvailable() const;
+    bool isAsyncComputeEnabled() const;
+    void setAsyncComputeEnabled(bool enabled);
+
+    // Consecutive draws of identical geometry and material become one instanced draw
+    bool isInstancingEnabled() const;
+    void setInstancingEnabled(bool enabled);
+
+    // Large queues are split into secondary command buffers recorded on worker threads
+    bool isParallelRecordingEnabled() const;
+    void setParallelRecordingEnabled(bool enabled);
+    auto recordingThreadCount() const -> uint32_t;
+
+    // Forward path: opaque meshes are first drawn depth-only, then shaded with an EQUAL depth
+    // test so that each pixel runs the PBR fragment shader once. Alpha-tested and skinned
+    // meshes keep the depth-writing pipeline.
+    bool isDepthPrepassEnabled() const;
+    void setDepthPrepassEnabled(bool enabled);
+
+    // Two-phase Hi-Z occlusion culling of the forward and G-buffer passes. Draws that were
+    // visible last frame are rendered first, a depth pyramid is built from that depth and every
+    // draw is tested against it; the visible ones that were left out are rendered in a second
+    // pass. The draws become indirect, their instance counts are written by occlusionCull.comp.
+    // Takes the place of the depth pre-pass, whose depth the first pass already provides.
+    bool isOcclusionCullingEnabled() const;
+    void setOcclusionCullingEnabled(bool enabled);
+
+    // Secondaries of the forward, G-buffer and shadow passes are kept per frame slot and
+    // re-recorded only when their draws, pipelines or materials change
+    bool isCommandCachingEnabled() const;
+    void setCommandCachingEnabled(bool enabled);
+
+    // Pipeline statistics queries of the shadow, forward, G-buffer, lighting and post passes.
+    // Available when the device supports them and, while passes execute secondary command
+    // buffers (parallel recording or command caching), also inheritedQueries.
+    bool isPipelineStatisticsAvailable() const;
+    bool isPipelineStatisticsEnabled() const;
+    void setPipelineStatisticsEnabled(bool enabled);
+    auto pipelineStatistics() const -> const PipelineStatistics&;
+
+    // Point/spot lights, uploaded every frame (at most ClusterUniform::kMaxLights)
+    auto localLights() -> vector<LocalLight>&;
+    // Random lights near the ground of the models' world bounds. The seed is fixed, so every
+    // run (and every machine) gets the same lights.
+    void generateLocalLights(const vector<Model>& models, int count, float range, float intensity);
+    auto clusterStats() const -> const ClusterStats&;
+
+    // Weight of the current frame in the SSAO temporal accumulation (1 = no accumulation)
+    auto ssaoHistoryBlend() const -> float;
+    void setSsaoHistoryBlend(float blend);
+
     auto sceneUBO() -> SceneUniform&
     {
         return sceneUBO_;
@@ -167,7 +438,7 @@ class Renderer
     }
 
   private:
-    const uint32_t& kMaxFramesInFlight_; // 2;
+    const uint32_t& kMaxFramesInFlight_; // Frame slots, the application may use fewer
     const string& kAssetsPathPrefix_;    // "../../assets/";
     const string& kShaderPathPrefix_;    // kAssetsPathPrefix + "shaders/";
 
@@ -180,16 +451,32 @@ class Renderer
     OptionsUniform optionsUBO_{};
     BoneDataUniform boneDataUBO_{};
     PostOptionsUBO postOptionsUBO_{};
+    ModelCoeffsUniform modelCoeffsUBO_{};
+    ClusterUniform clusterUBO_{};
 
     vector<UniformBuffer<SceneUniform>> sceneUniforms_{};
     vector<UniformBuffer<SkyOptionsUBO>> skyOptionsUniforms_;
     vector<UniformBuffer<OptionsUniform>> optionsUniforms_{};
     vector<UniformBuffer<BoneDataUniform>> boneDataUniforms_;
     vector<UniformBuffer<PostOptionsUBO>> postOptionsUniforms_;
+    vector<UniformBuffer<ModelCoeffsUniform>> modelCoeffsUniforms_;
+    vector<UniformBuffer<ClusterUniform>> clusterUniforms_;
+
+    // Clustered lighting: per-frame light list and stats, GPU-only grid and index lists
+    vector<LocalLight> localLights_;
+    vector<MappedBuffer> localLightBuffers_;
+    vector<MappedBuffer> clusterStatsBuffers_;
+    StorageBuffer clusterLightCounts_;  // uint per cluster
+    StorageBuffer clusterLightIndices_; // kMaxLightsPerCluster uints per cluster
+    ClusterStats clusterStats_{};
 
     vector<DescriptorSet> sceneOptionsBoneDataSets_{};
     vector<DescriptorSet> sceneSkyOptionsSets_{};
     vector<DescriptorSet> postProcessingDescriptorSets_;
+    vector<DescriptorSet> sceneOptionsModelCoeffsSets_{};
+    vector<DescriptorSet> sceneOptionsSets_{};
+    vector<DescriptorSet> clusterSets_{};      // Set 0 of clusterLights, set 4 of the lighting
+    vector<DescriptorSet> clusterStatsSets_{}; // Set 1 of clusterLights
 
     // Resources
     Image2D msaaColorBuffer_;
@@ -197,7 +484,34 @@ class Renderer
     DepthStencil msaaDepthStencil_;
 
     Image2D forwardToCompute_;
-    Image2D computeToPost_;
+
+    // G-buffer for the deferred path (depth is depthStencil_). Transient like the multisample
+    // targets: renderGraph_ puts them in the same memory, only one of the paths runs per frame.
+    Image2D gBufferAlbedo_;
+    Image2D gBufferNormal_;
+    Image2D gBufferMaterial_;
+    Image2D gBufferEmissive_;
+
+    // Half resolution SSAO of the deferred path (storage images, always in GENERAL layout)
+    Image2D ssaoDepth_;      // r32f, closest depth of each 2x2 quad
+    Image2D ssaoNormal_;     // rgba8, world normal
+    Image2D ssaoRaw_;        // r32f, AO of the current frame
+    Image2D ssaoHistory_[2]; // rg32f, accumulated AO and view distance (ping-pong)
+    Image2D ssaoFull_;       // r32f, upsampled result read by deferredLighting
+
+    // Barriers of the main passes and memory of the transient targets
+    RenderGraph renderGraph_;
+    BarrierBatch pendingBarriers_; // Recorded with the next render graph pass (or cluster build)
+    uint32_t barrierCalls_{0};
+    struct
+    {
+        uint32_t depthPrepass;
+        uint32_t forward;
+        uint32_t gBuffer;
+        uint32_t ssao;
+        uint32_t lighting;
+        uint32_t post;
+    } graphPasses_{};
 
     Image2D dummyTexture_;
     SkyTextures skyTextures_;
@@ -208,15 +522,174 @@ class Renderer
     Sampler samplerAnisoClamp_;
 
     ShadowMap shadowMap_;
+    DepthPyramid depthPyramid_; // Built from depthStencil_ between the occlusion phases
 
     DescriptorSet skyDescriptorSet_;
     DescriptorSet postDescriptorSet_;
     DescriptorSet shadowMapSet_;
+    DescriptorSet gBufferSet_;
+    DescriptorSet ssaoDownsampleSet_;
+    DescriptorSet ssaoSet_;
+    DescriptorSet ssaoTemporalSets_[2]; // Indexed by the history image written
+    DescriptorSet ssaoUpsampleSets_[2];
+    DescriptorSet depthPyramidSets_[DepthPyramid::kMaxLevels]; // Indexed by the level written
 
     unordered_map<string, Pipeline> pipelines_;
 
     ViewFrustum viewFrustum_{};
+    glm::mat4 viewProjection_{1.0f}; // Of the last updateViewFrustum()
     bool frustumCullingEnabled_{true};
+    float contributionCullingThreshold_{0.0f}; // Projected area in pixels
+    uint32_t screenHeight_{0};
+
+    // Worker threads of software occlusion and parallel recording; declared before both
+    WorkerPool workerPool_;
+
+    // Software occluders: whole meshes within a triangle budget, largest bounds first
+    static constexpr uint32_t kMaxSoftwareOccluders = 64;
+    static constexpr uint32_t kMaxOccluderTriangles = 2048;
+    struct SoftwareOccluder
+    {
+        uint32_t modelIndex;
+        uint32_t meshIndex;
+        uint32_t occluder; // Id in softwareOcclusion_
+    };
+    SoftwareOcclusion softwareOcclusion_; // Rasterizes on workerPool_
+    vector<SoftwareOccluder> softwareOccluders_;
+    vector<uint8_t> isSoftwareOccluder_; // Indexed by meshOffsets_[model] + mesh
+    bool softwareOcclusionEnabled_{false};
+    bool shadowCullingEnabled_{true};
+    bool receiverShadowCullingEnabled_{true};
+
+    RenderPath renderPath_{RenderPath::Forward};
+    RenderPath framePath_{RenderPath::Forward}; // Chosen by beginFrame()
+    bool alternateRenderPaths_{false};
+    bool alternateFlip_{false};
+
+    // Async compute. Per frame slot: the shadow and lighting batches of the graphics queue, and
+    // the SSAO batch of the compute queue.
+    bool asyncComputeEnabled_{false};
+    bool asyncFrame_{false}; // Deferred with SSAO and async compute in this frame
+    vector<CommandBuffer> asyncGraphicsCommandBuffers_; // [frame * 2]: shadow, + 1: lighting
+    vector<CommandBuffer> computeCommandBuffers_;
+    VkCommandBuffer gBufferBatch_{VK_NULL_HANDLE}; // The one passed to draw()
+    VkCommandBuffer shadowBatch_{VK_NULL_HANDLE};
+    VkSemaphore timelineSemaphore_{VK_NULL_HANDLE};
+    uint64_t timelineValue_{0}; // Last value of timelineSemaphore_ that a submission signals
+    uint64_t gBufferDoneValue_{0};
+    uint64_t ssaoDoneValue_{0};
+
+    GpuTimer gpuTimer_;
+
+    PipelineStatistics pipelineStatistics_;
+    bool pipelineStatisticsEnabled_{false};
+    bool framePipelineStatistics_{false}; // Queries recorded this frame
+    void beginPassStatistics(VkCommandBuffer cmd, const string& name);
+    void endPassStatistics(VkCommandBuffer cmd);
+
+    SsaoPushConstants ssaoPushConstants_{};
+    uint32_t ssaoFrame_{0}; // Also selects the history image written this frame
+    bool ssaoHistoryValid_{false};
+    float ssaoHistoryBlend_{0.1f};
+
+    // Visible meshes of the frame in sort-key order, shared by the forward and G-buffer passes
+    RenderQueue renderQueue_;
+    RenderQueue depthPrepassQueue_; // Draws of renderQueue_ with kVariantDepthEqual
+    RenderQueue shadowQueues_[ShadowMap::kCascadeCount]; // Casters ordered by geometry only
+    RenderQueue staticShadowQueues_[ShadowMap::kCascadeCount]; // Cached casters, same order
+    RenderQueueStats renderQueueStats_{};
+
+    // Compact ids of identical geometry/material across models ([model][mesh], [model][material])
+    vector<vector<uint32_t>> geometryIds_;
+    vector<vector<uint32_t>> materialIds_;
+    vector<uint32_t> meshOffsets_; // Index of each model's first mesh among all meshes
+    uint32_t meshCount_{0};
+
+    // Per-frame instance transforms, filled while recording (all passes of a frame)
+    static constexpr uint32_t kMaxInstancedPassesPerFrame = 12;
+    vector<MappedBuffer> instanceBuffers_;
+    uint32_t instanceCapacity_{0};
+    uint32_t instanceCount_{0};
+    bool instanceOverflowLogged_{false}; // Once per capacity, not every frame
+    bool instancingEnabled_{true};
+
+    // Instance count of the draw that starts at each queue item, 0 for items merged into an
+    // earlier draw. Filled by mergeDraws() before a queue is recorded.
+    vector<uint32_t> drawSizes_;
+
+    // GPU occlusion culling. prepareOcclusionDraws() sets up the queue once for both phases: the
+    // draws to test, and two indirect commands per draw indexed by its first instance slot
+    // (first pass, then second pass at instanceCapacity_).
+    enum class OcclusionPhase { None, First, Second };
+    vector<MappedBuffer> occlusionDrawBuffers_;   // OcclusionDraw per draw
+    vector<MappedBuffer> indirectCommandBuffers_; // VkDrawIndexedIndirectCommand
+    vector<MappedBuffer> occlusionStatsBuffers_;
+    vector<DescriptorSet> occlusionSets_;
+    StorageBuffer visibilityHistory_; // uint per mesh, result of the last second phase
+    vector<uint32_t> occlusionDrawSizes_; // drawSizes_ of the culled queue
+    uint32_t occlusionDrawCount_{0};
+    uint32_t occlusionItemCount_{0};
+    uint32_t occlusionInstanceBase_{0};
+    bool occlusionCullingEnabled_{false};
+    bool occlusionHistoryValid_{false}; // Reset to "all visible" before the next first phase
+
+    // Parallel recording of the forward, G-buffer and shadow passes
+    static constexpr uint32_t kMinDrawsPerChunk = 256; // Smaller queues are recorded inline
+    CommandRecorder commandRecorder_; // Records on workerPool_
+    bool parallelRecordingEnabled_{true};
+    VkFormat depthFormat_{VK_FORMAT_UNDEFINED}; // Attachment formats for the secondaries
+    VkSampleCountFlagBits msaaSamples_{VK_SAMPLE_COUNT_1_BIT};
+
+    // Sort key variants, index into recordRenderQueue()'s pipelines. The first three are the
+    // values of Material::AlphaMode.
+    static constexpr uint32_t kVariantOpaque = 0;
+    static constexpr uint32_t kVariantAlphaTested = 1;
+    static constexpr uint32_t kVariantBlended = 2;
+    static constexpr uint32_t kVariantDepthEqual = 3; // Opaque, depth written by the pre-pass
+    static constexpr uint32_t kAllVariants = ~0u;    // materialVariants mask
+    bool depthPrepassEnabled_{false};
+
+    // Passes whose secondary command buffers can be reused in later frames. Every shadow
+    // cascade is a pass of its own: Shadow + cascade, StaticShadow + cascade.
+    enum class CachedPass : uint32_t {
+        Forward = 0,
+        GBuffer,
+        DepthPrepass,
+        ForwardSecond, // Second occlusion culling phase
+        GBufferSecond,
+        Shadow,
+        StaticShadow = Shadow + ShadowMap::kCascadeCount,
+        Count = StaticShadow + ShadowMap::kCascadeCount
+    };
+
+    struct PassCommandCache
+    {
+        uint64_t signature = 0; // Hash of everything recorded, 0 when nothing is recorded yet
+        uint32_t secondaryCount = 0;
+        vector<VkCommandBuffer> secondaries; // From commandRecorder_'s persistent pools
+        RenderQueueStats stats{};            // Of the recording, reported again on reuse
+    };
+
+    static constexpr uint32_t kCacheLogInterval = 600; // Pass lookups between log lines
+    vector<array<PassCommandCache, size_t(CachedPass::Count)>> passCaches_; // [frame][pass]
+    bool commandCachingEnabled_{true};
+    uint32_t cacheLookups_{0};
+    uint32_t cacheInvalidations_{0};
+
+    // Shadow cascades, updated every frame
+    struct ShadowCascade
+    {
+        glm::mat4 viewProjection{1.0f}; // Light view-projection of the cascade
+        ViewFrustum frustum{};
+        AABB receivers{}; // The cascade's slice of the view in its clip space
+    };
+
+    ShadowCascade shadowCascades_[ShadowMap::kCascadeCount];
+    float cascadeSplitLambda_{0.75f}; // 0: uniform splits, 1: logarithmic splits
+
+    // Hash of what is in each layer of shadowMap_.staticImage(), 0 when it must be rendered
+    uint64_t staticShadowSignatures_[ShadowMap::kCascadeCount]{};
+    bool staticShadowCachingEnabled_{true};
 
     // Statistics
     CullingStats cullingStats_;
@@ -237,6 +710,81 @@ class Renderer
     int ssaoSampleCount = 16;
     float ssaoPower = 2.0f;
 
+    void drawForward(VkCommandBuffer cmd, uint32_t currentFrame, vector<Model>& models,
+                     VkViewport viewport, VkRect2D scissor);
+    // With async compute, cmd is ended after the G-buffer pass and replaced by the command
+    // buffer of the lighting batch
+    void drawDeferred(VkCommandBuffer& cmd, uint32_t currentFrame, vector<Model>& models,
+                      VkViewport viewport, VkRect2D scissor);
+    void computeSsao(VkCommandBuffer cmd, uint32_t currentFrame);
+    auto computeSsaoAsync(VkCommandBuffer cmd, uint32_t currentFrame) -> VkCommandBuffer;
+    auto beginBatch(CommandBuffer& commandBuffer) -> VkCommandBuffer;
+    void buildLightClusters(VkCommandBuffer cmd, uint32_t currentFrame);
+    void assignInstancingIds(vector<Model>& models);
+    void selectSoftwareOccluders(vector<Model>& models); // After assignInstancingIds()
+    void performContributionCulling(vector<Model>& models);
+    void performSoftwareOcclusionCulling(vector<Model>& models);
+    void buildRenderQueue(vector<Model>& models, bool depthPrepass);
+
+    // Reserves instance slots for up to `requested` items, returns how many fit
+    auto reserveInstances(size_t requested, uint32_t& instanceBase) -> uint32_t;
+
+    // Fills drawSizes for the first count items (see drawSizes_)
+    void mergeDraws(const vector<DrawItem>& items, uint32_t count,
+                    const vector<const Pipeline*>& pipelines, vector<Model>& models,
+                    uint32_t materialVariants, vector<uint32_t>& drawSizes);
+
+    // Occlusion culling: instance slots, draws and indirect commands of the queue for both
+    // phases. Call before cullOcclusion(First) and the two recordRenderQueue() calls.
+    void prepareOcclusionDraws(uint32_t currentFrame, const RenderQueue& queue,
+                               const vector<const Pipeline*>& pipelines, vector<Model>& models,
+                               uint32_t materialVariants);
+    void buildDepthPyramid(VkCommandBuffer cmd); // From depthStencil_
+    void cullOcclusion(VkCommandBuffer cmd, uint32_t currentFrame, OcclusionPhase phase);
+
+    // Records a whole rendering scope: begins rendering, draws the queue followed by
+    // recordAfter (if any) and ends rendering. setState is recorded at the start of every
+    // command buffer since secondaries do not inherit dynamic state. Each draw uses the
+    // pipeline of its sort key variant; all of them must have compatible layouts up to set 0.
+    // Bit v of materialVariants: draws of variant v bind their material as set 1.
+    // With an occlusion phase the draws are indirect; the first phase records only the opaque
+    // part of the queue.
+    void recordRenderQueue(VkCommandBuffer cmd, uint32_t currentFrame, CachedPass pass,
+                           const VkRenderingInfo& renderingInfo,
+                           const VkCommandBufferInheritanceRenderingInfo& inheritanceInfo,
+                           const function<void(VkCommandBuffer)>& setState,
+                           const RenderQueue& queue, const vector<const Pipeline*>& pipelines,
+                           vector<Model>& models, const vector<VkDescriptorSet>& passSets,
+                           uint32_t materialVariants,
+                           OcclusionPhase occlusion = OcclusionPhase::None,
+                           const function<void(VkCommandBuffer)>& recordAfter = nullptr);
+
+    // Fills instance slots instanceBase .. instanceBase + count - 1 with the items' transforms
+    void writeInstanceData(uint32_t currentFrame, const vector<DrawItem>& items, uint32_t count,
+                           uint32_t instanceBase, uint32_t cascade, vector<Model>& models);
+
+    // Hash of the cascade matrix and the static casters drawn into its cached depth
+    auto staticShadowSignature(uint32_t cascade, const RenderQueue& queue,
+                               vector<Model>& models) const -> uint64_t;
+
+    // Hash of all state that ends up in the command buffers of a cached pass
+    auto passSignature(uint32_t currentFrame, const VkRenderingInfo& renderingInfo,
+                       const vector<DrawItem>& items, uint32_t itemCount, uint32_t instanceBase,
+                       uint32_t secondaryCount, const vector<const Pipeline*>& pipelines,
+                       vector<Model>& models, const vector<VkDescriptorSet>& passSets,
+                       uint32_t materialVariants, OcclusionPhase occlusion) -> uint64_t;
+
+    // Records the draws that start at items [begin, end) of a queue. Item k uses instance slot
+    // instanceBase + k. With indirectBuffer the draw of slot s reads its command at
+    // indirectOffset + s * sizeof(VkDrawIndexedIndirectCommand).
+    // Only reads Renderer state, so disjoint ranges can be recorded on different threads.
+    void recordDrawRange(VkCommandBuffer cmd, uint32_t currentFrame, const vector<DrawItem>& items,
+                         const vector<uint32_t>& drawSizes, size_t begin, size_t end,
+                         uint32_t instanceBase, const vector<const Pipeline*>& pipelines,
+                         vector<Model>& models, const vector<VkDescriptorSet>& passSets,
+                         uint32_t materialVariants, VkBuffer indirectBuffer,
+                         VkDeviceSize indirectOffset, RenderQueueStats& stats);
+
     // Helper functions for creating rendering structures
     VkRenderingAttachmentInfo
     createColorAttachment(VkImageView imageView,
@@ -254,7 +802,13 @@ class Renderer
     VkRenderingInfo
     createRenderingInfo(const VkRect2D& renderArea,
                         const VkRenderingAttachmentInfo* colorAttachment,
-                        const VkRenderingAttachmentInfo* depthAttachment = nullptr) const;
+                        const VkRenderingAttachmentInfo* depthAttachment = nullptr,
+                        uint32_t colorAttachmentCount = 1) const;
+
+    VkCommandBufferInheritanceRenderingInfo
+    createInheritanceInfo(const VkFormat* colorFormats, uint32_t colorFormatCount,
+                          VkFormat depthFormat, VkFormat stencilFormat,
+                          VkSampleCountFlagBits samples) const;
 };
 
 } // namespace hlab
\ No newline at end of file
@@ -9,10 +9,13 @@ namespace hlab {
 
 class ResourceBinding
 {
+    friend class DepthPyramid;
+    friend class DepthStencil;
     friend class DescriptorSet;
     friend class Image2D;
     friend class MappedBuffer;
     friend class ShadowMap;
+    friend class StorageBuffer;
 
   public:
     void update()
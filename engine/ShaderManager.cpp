@@ -10,7 +10,7 @@ namespace hlab {
 using namespace std;
 
 ShaderManager::ShaderManager(Context& ctx, string shaderPathPrefix,
-                             const initializer_list<pair<string, vector<string>>>& pipelineShaders)
+                             const vector<pair<string, vector<string>>>& pipelineShaders)
     : ctx_(ctx)
 {
     createFromShaders(shaderPathPrefix, pipelineShaders);
@@ -135,7 +135,7 @@ void ShaderManager::collectPerPipelineBindings(
 }
 
 void ShaderManager::createFromShaders(
-    string shaderPathPrefix, initializer_list<pair<string, vector<string>>> pipelineShaders)
+    string shaderPathPrefix, const vector<pair<string, vector<string>>>& pipelineShaders)
 {
     for (const auto& [pipelineName, shaderFilenames] : pipelineShaders) {
         vector<Shader>& shaders = pipelineShaders_[pipelineName];
@@ -4,7 +4,7 @@
 #include "Context.h"
 #include <vector>
 #include <unordered_map>
-#include <initializer_list>
+#include <utility>
 #include <map>
 
 namespace hlab {
@@ -15,7 +15,7 @@ class ShaderManager
 {
   public:
     ShaderManager(Context& ctx, string shaderPathPrefix,
-                  const initializer_list<pair<string, vector<string>>>& pipelineShaders);
+                  const vector<pair<string, vector<string>>>& pipelineShaders);
     ShaderManager(const ShaderManager&) = delete;
     ShaderManager& operator=(const ShaderManager&) = delete;
     ShaderManager& operator=(ShaderManager&&) = delete;
@@ -80,7 +80,7 @@ class ShaderManager
     vector<LayoutInfo> layoutInfos_;
 
     void createFromShaders(string shaderPathPrefix,
-                           initializer_list<pair<string, vector<string>>> pipelineShaders);
+                           const vector<pair<string, vector<string>>>& pipelineShaders);
     void collectLayoutInfos();
 
     void collectPerPipelineBindings(
@@ -5,51 +5,46 @@
 
 namespace hlab {
 
+// Depth array with one layer per shadow cascade, plus a second array of the same size that
+// keeps the depth of the static casters (copied into the shadow map before dynamic casters)
 class ShadowMap
 {
   public:
+    static constexpr uint32_t kCascadeCount = 4;
+
     ShadowMap(Context& ctx) : ctx_(ctx)
     {
         const VkDevice device = ctx_.device();
 
-        // Create shadow map image
-        VkImageCreateInfo imageCI{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
-        imageCI.imageType = VK_IMAGE_TYPE_2D;
-        imageCI.format = format_;
-        imageCI.extent = {width_, height_, 1};
-        imageCI.mipLevels = 1;
-        imageCI.arrayLayers = 1;
-        imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
-        imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imageCI.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
-                        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-        imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        check(vkCreateImage(device, &imageCI, nullptr, &image_));
+        // Create shadow map image and the static caster cache
+        createImage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                        VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                    image_, memory_);
+        createImage(VK_IMAGE_USAGE_TRANSFER_SRC_BIT, staticImage_, staticMemory_);
 
-        // Allocate memory
-        VkMemoryRequirements memReqs;
-        vkGetImageMemoryRequirements(device, image_, &memReqs);
-
-        VkMemoryAllocateInfo memAlloc{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
-        memAlloc.allocationSize = memReqs.size;
-        memAlloc.memoryTypeIndex =
-            ctx_.getMemoryTypeIndex(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        check(vkAllocateMemory(device, &memAlloc, nullptr, &memory_));
-        check(vkBindImageMemory(device, image_, memory_, 0));
-
-        // Create image view
+        // Create image view (all cascades, sampled as sampler2DArrayShadow)
         VkImageViewCreateInfo viewCI{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
         viewCI.image = image_;
-        viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
         viewCI.format = format_;
         viewCI.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
         viewCI.subresourceRange.baseMipLevel = 0;
         viewCI.subresourceRange.levelCount = 1;
         viewCI.subresourceRange.baseArrayLayer = 0;
-        viewCI.subresourceRange.layerCount = 1;
+        viewCI.subresourceRange.layerCount = kCascadeCount;
         check(vkCreateImageView(device, &viewCI, nullptr, &imageView_));
 
+        // One view per cascade for rendering
+        viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewCI.subresourceRange.layerCount = 1;
+        for (uint32_t i = 0; i < kCascadeCount; i++) {
+            viewCI.subresourceRange.baseArrayLayer = i;
+            viewCI.image = image_;
+            check(vkCreateImageView(device, &viewCI, nullptr, &layerViews_[i]));
+            viewCI.image = staticImage_;
+            check(vkCreateImageView(device, &viewCI, nullptr, &staticLayerViews_[i]));
+        }
+
         // Create sampler for shadow map sampling
         VkSamplerCreateInfo samplerCI{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
         samplerCI.magFilter = VK_FILTER_LINEAR;
@@ -70,7 +65,7 @@ class ShadowMap
         resourceBinding_.descriptorType_ = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         resourceBinding_.descriptorCount_ = 1;
         resourceBinding_.update();
-        resourceBinding_.barrierHelper().update(image_, format_, 1, 1);
+        resourceBinding_.barrierHelper().update(image_, format_, 1, kCascadeCount);
     }
 
     ~ShadowMap()
@@ -87,14 +82,29 @@ class ShadowMap
             imageView_ = VK_NULL_HANDLE;
         }
 
-        if (image_ != VK_NULL_HANDLE) {
-            vkDestroyImage(device, image_, nullptr);
-            image_ = VK_NULL_HANDLE;
+        for (uint32_t i = 0; i < kCascadeCount; i++) {
+            if (layerViews_[i] != VK_NULL_HANDLE) {
+                vkDestroyImageView(device, layerViews_[i], nullptr);
+                layerViews_[i] = VK_NULL_HANDLE;
+            }
+            if (staticLayerViews_[i] != VK_NULL_HANDLE) {
+                vkDestroyImageView(device, staticLayerViews_[i], nullptr);
+                staticLayerViews_[i] = VK_NULL_HANDLE;
+            }
+        }
+
+        for (VkImage* image : {&image_, &staticImage_}) {
+            if (*image != VK_NULL_HANDLE) {
+                vkDestroyImage(device, *image, nullptr);
+                *image = VK_NULL_HANDLE;
+            }
         }
 
-        if (memory_ != VK_NULL_HANDLE) {
-            vkFreeMemory(device, memory_, nullptr);
-            memory_ = VK_NULL_HANDLE;
+        for (VkDeviceMemory* memory : {&memory_, &staticMemory_}) {
+            if (*memory != VK_NULL_HANDLE) {
+                vkFreeMemory(device, *memory, nullptr);
+                *memory = VK_NULL_HANDLE;
+            }
         }
     }
 
@@ -108,6 +118,22 @@ class ShadowMap
         return imageView_;
     }
 
+    auto layerView(uint32_t cascade) const -> VkImageView
+    {
+        return layerViews_[cascade];
+    }
+
+    // Depth of the static casters, kept in TRANSFER_SRC_OPTIMAL between updates
+    auto staticImage() const -> VkImage
+    {
+        return staticImage_;
+    }
+
+    auto staticLayerView(uint32_t cascade) const -> VkImageView
+    {
+        return staticLayerViews_[cascade];
+    }
+
     auto width() const -> uint32_t
     {
         return width_;
@@ -128,12 +154,45 @@ class ShadowMap
     VkImage image_{VK_NULL_HANDLE};
     VkDeviceMemory memory_{VK_NULL_HANDLE};
     VkImageView imageView_{VK_NULL_HANDLE};
+    VkImageView layerViews_[kCascadeCount]{};
     VkSampler sampler_{VK_NULL_HANDLE};
-    uint32_t width_ = 2048 * 2; // Shadow map resolution
-    uint32_t height_ = 2048 * 2;
+    VkImage staticImage_{VK_NULL_HANDLE};
+    VkDeviceMemory staticMemory_{VK_NULL_HANDLE};
+    VkImageView staticLayerViews_[kCascadeCount]{};
+    uint32_t width_ = 2048; // Per cascade; four 2048 layers cost as much memory as one 4096 map
+    uint32_t height_ = 2048;
     VkFormat format_ = VK_FORMAT_D16_UNORM;
 
     ResourceBinding resourceBinding_;
+
+    void createImage(VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& memory)
+    {
+        const VkDevice device = ctx_.device();
+
+        VkImageCreateInfo imageCI{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        imageCI.imageType = VK_IMAGE_TYPE_2D;
+        imageCI.format = format_;
+        imageCI.extent = {width_, height_, 1};
+        imageCI.mipLevels = 1;
+        imageCI.arrayLayers = kCascadeCount;
+        imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCI.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | usage;
+        imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        check(vkCreateImage(device, &imageCI, nullptr, &image));
+
+        // Allocate memory
+        VkMemoryRequirements memReqs;
+        vkGetImageMemoryRequirements(device, image, &memReqs);
+
+        VkMemoryAllocateInfo memAlloc{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+        memAlloc.allocationSize = memReqs.size;
+        memAlloc.memoryTypeIndex =
+            ctx_.getMemoryTypeIndex(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        check(vkAllocateMemory(device, &memAlloc, nullptr, &memory));
+        check(vkBindImageMemory(device, image, memory, 0));
+    }
 };
 
 } // namespace hlab
\ No newline at end of file
@@ -0,0 +1,371 @@
+#include "SoftwareOcclusion.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define HLAB_SOFTWARE_OCCLUSION_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define HLAB_TARGET_AVX2 // MSVC compiles intrinsics without /arch flags
+#else
+#define HLAB_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace hlab {
+
+// Vertices closer to the camera plane than this are not rasterized
+static constexpr float kMinClipW = 1e-5f;
+
+static constexpr uint32_t kTileCount =
+    (SoftwareOcclusion::kHeight + SoftwareOcclusion::kTileHeight - 1) /
+    SoftwareOcclusion::kTileHeight;
+
+// The AVX2 paths are compiled for every x86-64 build and only taken when the CPU (and OS)
+// supports them, so the engine still runs on older CPUs.
+static auto cpuHasAvx2() -> bool
+{
+#if defined(HLAB_SOFTWARE_OCCLUSION_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+#else
+    return false;
+#endif
+}
+
+template <typename Triangle>
+static void rasterizeRowScalar(float* row, const Triangle& t, float py, int32_t minX,
+                               int32_t maxX)
+{
+    const float e0 = t.b[0] * py + t.c[0];
+    const float e1 = t.b[1] * py + t.c[1];
+    const float e2 = t.b[2] * py + t.c[2];
+    const float z = t.zB * py + t.zC;
+    for (int32_t x = minX; x <= maxX; x++) {
+        const float px = float(x) + 0.5f;
+        if (t.a[0] * px + e0 >= 0.0f && t.a[1] * px + e1 >= 0.0f && t.a[2] * px + e2 >= 0.0f) {
+            row[x] = std::min(row[x], t.zA * px + z);
+        }
+    }
+}
+
+static auto isRowBehindScalar(const float* row, float nearestDepth, int32_t minX, int32_t maxX)
+    -> bool
+{
+    for (int32_t x = minX; x <= maxX; x++) {
+        if (row[x] >= nearestDepth) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if defined(HLAB_SOFTWARE_OCCLUSION_X86)
+// Rows start at multiples of 8 pixels and kWidth is one too, so the loads never leave the row.
+// Pixels left of minX are outside the triangle, so their edge tests fail anyway.
+template <typename Triangle>
+HLAB_TARGET_AVX2 static void rasterizeRowAvx2(float* row, const Triangle& t, float py,
+                                              int32_t minX, int32_t maxX)
+{
+    const __m256 lane = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 a0 = _mm256_set1_ps(t.a[0]);
+    const __m256 a1 = _mm256_set1_ps(t.a[1]);
+    const __m256 a2 = _mm256_set1_ps(t.a[2]);
+    const __m256 e0 = _mm256_set1_ps(t.b[0] * py + t.c[0]);
+    const __m256 e1 = _mm256_set1_ps(t.b[1] * py + t.c[1]);
+    const __m256 e2 = _mm256_set1_ps(t.b[2] * py + t.c[2]);
+    const __m256 zA = _mm256_set1_ps(t.zA);
+    const __m256 z = _mm256_set1_ps(t.zB * py + t.zC);
+
+    for (int32_t x = minX & ~7; x <= maxX; x += 8) {
+        const __m256 px = _mm256_add_ps(_mm256_set1_ps(float(x)), lane);
+        const __m256 w0 = _mm256_add_ps(_mm256_mul_ps(a0, px), e0);
+        const __m256 w1 = _mm256_add_ps(_mm256_mul_ps(a1, px), e1);
+        const __m256 w2 = _mm256_add_ps(_mm256_mul_ps(a2, px), e2);
+        const __m256 inside = _mm256_and_ps(_mm256_cmp_ps(w0, zero, _CMP_GE_OQ),
+                                            _mm256_and_ps(_mm256_cmp_ps(w1, zero, _CMP_GE_OQ),
+                                                          _mm256_cmp_ps(w2, zero, _CMP_GE_OQ)));
+        if (_mm256_movemask_ps(inside) == 0) {
+            continue;
+        }
+
+        const __m256 depth = _mm256_add_ps(_mm256_mul_ps(zA, px), z);
+        const __m256 old = _mm256_loadu_ps(row + x);
+        _mm256_storeu_ps(row + x, _mm256_blendv_ps(old, _mm256_min_ps(old, depth), inside));
+    }
+}
+
+HLAB_TARGET_AVX2 static auto isRowBehindAvx2(const float* row, float nearestDepth,
+                                             int32_t minX, int32_t maxX) -> bool
+{
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i first = _mm256_set1_epi32(minX);
+    const __m256i end = _mm256_set1_epi32(maxX + 1);
+    const __m256 nearest = _mm256_set1_ps(nearestDepth);
+
+    for (int32_t x = minX & ~7; x <= maxX; x += 8) {
+        const __m256i column = _mm256_add_epi32(_mm256_set1_epi32(x), lane);
+        const __m256i inRange = _mm256_andnot_si256(_mm256_cmpgt_epi32(first, column),
+                                                    _mm256_cmpgt_epi32(end, column));
+        const __m256 farther = _mm256_cmp_ps(_mm256_loadu_ps(row + x), nearest, _CMP_GE_OQ);
+        if (_mm256_movemask_ps(_mm256_and_ps(farther, _mm256_castsi256_ps(inRange))) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+SoftwareOcclusion::~SoftwareOcclusion()
+{
+    cleanup();
+}
+
+void SoftwareOcclusion::create(WorkerPool& workers)
+{
+    cleanup();
+
+    workers_ = &workers;
+    avx2_ = cpuHasAvx2();
+
+    printLog("Software occlusion: {}x{}, {} threads, {}", kWidth, kHeight, threadCount(),
+             avx2_ ? "AVX2" : "scalar");
+}
+
+void SoftwareOcclusion::cleanup()
+{
+    workers_ = nullptr;
+}
+
+auto SoftwareOcclusion::addOccluder(const vector<glm::vec3>& positions,
+                                    const vector<uint32_t>& indices) -> uint32_t
+{
+    occluders_.push_back({positions, indices});
+    return uint32_t(occluders_.size() - 1);
+}
+
+void SoftwareOcclusion::clearOccluders()
+{
+    occluders_.clear();
+}
+
+auto SoftwareOcclusion::occluderCount() const -> uint32_t
+{
+    return uint32_t(occluders_.size());
+}
+
+void SoftwareOcclusion::beginFrame(const glm::mat4& viewProjection)
+{
+    viewProjection_ = viewProjection;
+    triangles_.clear();
+}
+
+void SoftwareOcclusion::renderOccluder(uint32_t occluder, const glm::mat4& modelMatrix)
+{
+    const Occluder& geometry = occluders_[occluder];
+    const glm::mat4 transform = viewProjection_ * modelMatrix;
+
+    clipPositions_.resize(geometry.positions.size());
+    for (size_t i = 0; i < geometry.positions.size(); i++) {
+        clipPositions_[i] = transform * glm::vec4(geometry.positions[i], 1.0f);
+    }
+
+    for (size_t i = 0; i + 2 < geometry.indices.size(); i += 3) {
+        glm::vec3 v[3]; // Pixels and depth
+        bool clipped = false;
+        for (uint32_t k = 0; k < 3; k++) {
+            const glm::vec4& clip = clipPositions_[geometry.indices[i + k]];
+            if (clip.w < kMinClipW || clip.z < 0.0f) {
+                clipped = true; // Leaving out an occluder only makes the culling less effective
+                break;
+            }
+            const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            v[k] = glm::vec3((ndc.x * 0.5f + 0.5f) * float(kWidth),
+                             (ndc.y * 0.5f + 0.5f) * float(kHeight), ndc.z);
+        }
+        if (clipped) {
+            continue;
+        }
+
+        // Pixels whose centers lie within the bounds
+        const glm::vec3 lower = glm::min(v[0], glm::min(v[1], v[2]));
+        const glm::vec3 upper = glm::max(v[0], glm::max(v[1], v[2]));
+        Triangle t;
+        t.minX = std::max(int32_t(std::ceil(lower.x - 0.5f)), 0);
+        t.maxX = std::min(int32_t(std::floor(upper.x - 0.5f)), int32_t(kWidth) - 1);
+        t.minY = std::max(int32_t(std::ceil(lower.y - 0.5f)), 0);
+        t.maxY = std::min(int32_t(std::floor(upper.y - 0.5f)), int32_t(kHeight) - 1);
+        if (t.minX > t.maxX || t.minY > t.maxY) {
+            continue;
+        }
+
+        const float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) -
+                           (v[1].y - v[0].y) * (v[2].x - v[0].x);
+        if (std::abs(area) < 1e-6f) {
+            continue;
+        }
+
+        // Edge k is opposite to vertex k, its function is the barycentric weight of vertex k
+        // times the area. Both windings are rasterized.
+        const float sign = area > 0.0f ? 1.0f : -1.0f;
+        t.zA = t.zB = t.zC = 0.0f;
+        for (uint32_t k = 0; k < 3; k++) {
+            const glm::vec3& p = v[(k + 1) % 3];
+            const glm::vec3& q = v[(k + 2) % 3];
+            t.a[k] = sign * (p.y - q.y);
+            t.b[k] = sign * (q.x - p.x);
+            t.c[k] = sign * ((q.y - p.y) * p.x - (q.x - p.x) * p.y);
+            t.zA += t.a[k] * v[k].z;
+            t.zB += t.b[k] * v[k].z;
+            t.zC += t.c[k] * v[k].z;
+        }
+        const float invArea = 1.0f / std::abs(area);
+        t.zA *= invArea;
+        t.zB *= invArea;
+        t.zC *= invArea;
+
+        triangles_.push_back(t);
+    }
+}
+
+void SoftwareOcclusion::rasterize()
+{
+    // Tiles are handed out one at a time, so threads that get small triangles take more tiles
+    atomic<uint32_t> nextTile{0};
+    const function<void(uint32_t)> job = [&](uint32_t) {
+        for (uint32_t tile = nextTile++; tile < kTileCount; tile = nextTile++) {
+            rasterizeTile(tile);
+        }
+    };
+    if (workers_) {
+        workers_->run(job);
+    } else {
+        job(0);
+    }
+}
+
+void SoftwareOcclusion::rasterizeTile(uint32_t tile)
+{
+    const int32_t tileMinY = int32_t(tile * kTileHeight);
+    const int32_t tileMaxY = std::min(tileMinY + int32_t(kTileHeight), int32_t(kHeight)) - 1;
+
+    std::fill(depth_.begin() + tileMinY * kWidth, depth_.begin() + (tileMaxY + 1) * kWidth,
+              1.0f);
+
+    for (const Triangle& t : triangles_) {
+        const int32_t minY = std::max(t.minY, tileMinY);
+        const int32_t maxY = std::min(t.maxY, tileMaxY);
+        for (int32_t y = minY; y <= maxY; y++) {
+            float* row = depth_.data() + y * kWidth;
+            const float py = float(y) + 0.5f;
+#if defined(HLAB_SOFTWARE_OCCLUSION_X86)
+            if (avx2_) {
+                rasterizeRowAvx2(row, t, py, t.minX, t.maxX);
+                continue;
+            }
+#endif
+            rasterizeRowScalar(row, t, py, t.minX, t.maxX);
+        }
+    }
+}
+
+auto SoftwareOcclusion::isVisible(const AABB& bounds) const -> bool
+{
+    glm::vec2 lower(FLT_MAX);
+    glm::vec2 upper(-FLT_MAX);
+    float nearestDepth = 1.0f;
+    for (uint32_t i = 0; i < 8; i++) {
+        const glm::vec3 corner((i & 1) ? bounds.max.x : bounds.min.x,
+                               (i & 2) ? bounds.max.y : bounds.min.y,
+                               (i & 4) ? bounds.max.z : bounds.min.z);
+        const glm::vec4 clip = viewProjection_ * glm::vec4(corner, 1.0f);
+        if (clip.w < kMinClipW) {
+            return true; // Reaches behind the camera
+        }
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        lower = glm::min(lower, glm::vec2(ndc));
+        upper = glm::max(upper, glm::vec2(ndc));
+        nearestDepth = std::min(nearestDepth, ndc.z);
+    }
+    if (nearestDepth <= 0.0f) {
+        return true; // Crosses the near plane
+    }
+
+    // Every pixel the box touches
+    const int32_t minX = int32_t(std::floor((lower.x * 0.5f + 0.5f) * float(kWidth)));
+    const int32_t maxX = int32_t(std::floor((upper.x * 0.5f + 0.5f) * float(kWidth)));
+    const int32_t minY = int32_t(std::floor((lower.y * 0.5f + 0.5f) * float(kHeight)));
+    const int32_t maxY = int32_t(std::floor((upper.y * 0.5f + 0.5f) * float(kHeight)));
+    if (maxX < 0 || maxY < 0 || minX >= int32_t(kWidth) || minY >= int32_t(kHeight)) {
+        return true; // Off screen, left to the frustum test
+    }
+
+    const int32_t x0 = std::max(minX, 0);
+    const int32_t x1 = std::min(maxX, int32_t(kWidth) - 1);
+    const int32_t y0 = std::max(minY, 0);
+    const int32_t y1 = std::min(maxY, int32_t(kHeight) - 1);
+    for (int32_t y = y0; y <= y1; y++) {
+        const float* row = depth_.data() + y * kWidth;
+#if defined(HLAB_SOFTWARE_OCCLUSION_X86)
+        if (avx2_) {
+            if (!isRowBehindAvx2(row, nearestDepth, x0, x1)) {
+                return true;
+            }
+            continue;
+        }
+#endif
+        if (!isRowBehindScalar(row, nearestDepth, x0, x1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+auto SoftwareOcclusion::depthBuffer() const -> const vector<float>&
+{
+    return depth_;
+}
+
+auto SoftwareOcclusion::triangleCount() const -> uint32_t
+{
+    return uint32_t(triangles_.size());
+}
+
+auto SoftwareOcclusion::threadCount() const -> uint32_t
+{
+    return workers_ ? workers_->threadCount() : 1;
+}
+
+auto SoftwareOcclusion::isAvx2Enabled() const -> bool
+{
+    return avx2_;
+}
+
+void SoftwareOcclusion::setAvx2Enabled(bool enabled)
+{
+    avx2_ = enabled && cpuHasAvx2();
+}
+
+} // namespace hlab
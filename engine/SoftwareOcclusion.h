@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ViewFrustum.h"
+#include "WorkerPool.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace hlab {
+
+using namespace std;
+
+// CPU occlusion culling: occluder triangles are rasterized into a small depth buffer that
+// keeps the nearest occluder depth of every pixel, then bounding boxes are tested against it.
+// Rows of tiles are rasterized in parallel on a shared WorkerPool; 8 pixels at a time with
+// AVX2 when the CPU has it. Only needs glm, so it can run (and be tested) without a GPU.
+//
+// Per frame: beginFrame(), renderOccluder() for every occluder in view, rasterize(), then
+// isVisible() from any thread.
+class SoftwareOcclusion
+{
+  public:
+    static constexpr uint32_t kWidth = 320;  // Multiple of 8 (one AVX2 register per 8 pixels)
+    static constexpr uint32_t kHeight = 192;
+    static constexpr uint32_t kTileHeight = 16; // Rows of one parallel job
+
+    SoftwareOcclusion() = default;
+    SoftwareOcclusion(const SoftwareOcclusion&) = delete;
+    SoftwareOcclusion& operator=(const SoftwareOcclusion&) = delete;
+    ~SoftwareOcclusion();
+
+    // workers must outlive this object (or the next create())
+    void create(WorkerPool& workers);
+    void cleanup();
+
+    // Object space occluder geometry, kept until clearOccluders(). Returns the occluder id.
+    auto addOccluder(const vector<glm::vec3>& positions, const vector<uint32_t>& indices)
+        -> uint32_t;
+    void clearOccluders();
+    auto occluderCount() const -> uint32_t;
+
+    // viewProjection maps to Vulkan clip space (depth 0 at the near plane)
+    void beginFrame(const glm::mat4& viewProjection);
+    void renderOccluder(uint32_t occluder, const glm::mat4& modelMatrix);
+    void rasterize();
+
+    // False when the box is behind the rasterized occluders everywhere it covers
+    auto isVisible(const AABB& bounds) const -> bool;
+
+    auto depthBuffer() const -> const vector<float>&; // kWidth x kHeight, row by row
+    auto triangleCount() const -> uint32_t;           // Set up in this frame
+    auto threadCount() const -> uint32_t;
+    auto isAvx2Enabled() const -> bool;
+    void setAvx2Enabled(bool enabled); // Stays off when the CPU lacks AVX2, e.g. to compare
+
+  private:
+    struct Occluder
+    {
+        vector<glm::vec3> positions;
+        vector<uint32_t> indices;
+    };
+
+    // Screen space triangle: inside where all three edge functions a * x + b * y + c are not
+    // negative, depth z = zA * x + zB * y + zC (both at pixel centers)
+    struct Triangle
+    {
+        float a[3];
+        float b[3];
+        float c[3];
+        float zA, zB, zC;
+        int32_t minX, maxX, minY, maxY; // Pixel bounds, clamped to the buffer
+    };
+
+    vector<Occluder> occluders_;
+    vector<Triangle> triangles_;
+    vector<glm::vec4> clipPositions_; // Scratch of renderOccluder()
+    vector<float> depth_ = vector<float>(kWidth * kHeight, 1.0f);
+    glm::mat4 viewProjection_{1.0f};
+    bool avx2_{false};
+
+    WorkerPool* workers_{nullptr}; // Rasterizes on the calling thread alone when null
+
+    void rasterizeTile(uint32_t tile);
+};
+
+} // namespace hlab
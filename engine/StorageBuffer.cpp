@@ -33,6 +33,12 @@ void StorageBuffer::create(VkDeviceSize size, VkBufferUsageFlags additionalUsage
     allocInfo.memoryTypeIndex = memoryTypeIndex;
     check(vkAllocateMemory(device, &allocInfo, nullptr, &memory_));
     check(vkBindBufferMemory(device, buffer_, memory_, 0));
+
+    resourceBinding_.descriptorType_ = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    resourceBinding_.buffer_ = buffer_;
+    resourceBinding_.bufferSize_ = size_;
+    resourceBinding_.descriptorCount_ = 1;
+    resourceBinding_.update();
 }
 
 void* StorageBuffer::map()
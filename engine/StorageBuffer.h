@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Context.h"
+#include "ResourceBinding.h"
 #include "VulkanTools.h"
 #include <vulkan/vulkan.h>
 
@@ -37,6 +38,11 @@ class StorageBuffer
 
     VkDescriptorBufferInfo getDescriptorInfo() const;
 
+    auto resourceBinding() -> ResourceBinding&
+    {
+        return resourceBinding_;
+    }
+
     void cleanup();
 
   private:
@@ -47,6 +53,8 @@ class StorageBuffer
     VkDeviceSize size_{0};
     void* mapped_{nullptr};
     bool hostVisible_{false};
+
+    ResourceBinding resourceBinding_;
 };
 
 } // namespace hlab
\ No newline at end of file
@@ -1,5 +1,7 @@
 ﻿#include "Swapchain.h"
 
+#include <algorithm>
+
 namespace hlab {
 
 using namespace std;
@@ -118,6 +120,31 @@ const char* presentModeToString(VkPresentModeKHR mode)
 }
 
 void Swapchain::create(VkExtent2D& expectedWindowSize, bool vsync)
+{
+    queryPresentModes();
+
+    VkPresentModeKHR swapchainPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+
+    if (vsync) {
+        // When vsync is enabled, prioritize MAILBOX over FIFO for smoother experience
+        if (supportsPresentMode(VK_PRESENT_MODE_MAILBOX_KHR)) {
+            swapchainPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+        }
+        // If MAILBOX is not available, FIFO is already set as default
+    } else {
+        // When vsync is disabled, prioritize non-sync modes for maximum performance.
+        // IMMEDIATE is the true non-vsync mode, MAILBOX is still better than FIFO.
+        if (supportsPresentMode(VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+            swapchainPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        } else if (supportsPresentMode(VK_PRESENT_MODE_MAILBOX_KHR)) {
+            swapchainPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+        }
+    }
+
+    create(expectedWindowSize, swapchainPresentMode);
+}
+
+void Swapchain::create(VkExtent2D& expectedWindowSize, VkPresentModeKHR presentMode)
 {
     VkSwapchainKHR oldSwapchain = swapchain_;
 
@@ -139,47 +166,17 @@ void Swapchain::create(VkExtent2D& expectedWindowSize, bool vsync)
         expectedWindowSize.height = surfCaps.currentExtent.height;
     }
 
-    uint32_t presentModeCount;
-    check(vkGetPhysicalDeviceSurfacePresentModesKHR(ctx_.physicalDevice(), surface_,
-                                                    &presentModeCount, nullptr));
-    assert(presentModeCount > 0);
-
-    vector<VkPresentModeKHR> presentModes(presentModeCount);
-    check(vkGetPhysicalDeviceSurfacePresentModesKHR(ctx_.physicalDevice(), surface_,
-                                                    &presentModeCount, presentModes.data()));
-
-    printLog("Available Present Modes: {}", presentModeCount);
-    for (const auto& mode : presentModes) {
-        printLog("  VK_PRESENT_MODE_{}", presentModeToString(mode));
+    if (presentModes_.empty()) {
+        queryPresentModes();
     }
-
-    VkPresentModeKHR swapchainPresentMode = VK_PRESENT_MODE_FIFO_KHR;
-
-    if (vsync) {
-        // When vsync is enabled, prioritize MAILBOX over FIFO for smoother experience
-        for (size_t i = 0; i < presentModeCount; i++) {
-            if (presentModes[i] == VK_PRESENT_MODE_MAILBOX_KHR) {
-                swapchainPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
-                break;
-            }
-        }
-        // If MAILBOX is not available, FIFO is already set as default
-    } else {
-        // When vsync is disabled, prioritize non-sync modes for maximum performance
-        for (size_t i = 0; i < presentModeCount; i++) {
-            if (presentModes[i] == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-                swapchainPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
-                break; // IMMEDIATE is the true non-vsync mode, use it first
-            }
-            if (presentModes[i] == VK_PRESENT_MODE_MAILBOX_KHR) {
-                swapchainPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
-                // Fallback: MAILBOX is still better than FIFO for performance
-            }
-        }
+    if (!supportsPresentMode(presentMode)) {
+        printLog("VK_PRESENT_MODE_{} is not supported, using FIFO",
+                 presentModeToString(presentMode));
+        presentMode = VK_PRESENT_MODE_FIFO_KHR; // Always supported
     }
+    presentMode_ = presentMode;
 
-    printLog("Selected Present Mode: VK_PRESENT_MODE_{}",
-             presentModeToString(swapchainPresentMode));
+    printLog("Selected Present Mode: VK_PRESENT_MODE_{}", presentModeToString(presentMode_));
 
     uint32_t desiredNumberOfSwapchainImages = surfCaps.minImageCount + 1;
     if ((surfCaps.maxImageCount > 0) && (desiredNumberOfSwapchainImages > surfCaps.maxImageCount)) {
@@ -221,7 +218,7 @@ void Swapchain::create(VkExtent2D& expectedWindowSize, bool vsync)
     swapchainCI.imageArrayLayers = 1;
     swapchainCI.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
     swapchainCI.queueFamilyIndexCount = 0;
-    swapchainCI.presentMode = swapchainPresentMode;
+    swapchainCI.presentMode = presentMode_;
 
     swapchainCI.oldSwapchain = oldSwapchain;
 
@@ -276,6 +273,7 @@ void Swapchain::create(VkExtent2D& expectedWindowSize, bool vsync)
         check(vkCreateImageView(ctx_.device(), &colorAttachmentView, nullptr, &imageViews_[i]));
     }
 
+    barrierHelpers.clear(); // Of the old swapchain
     barrierHelpers.reserve(imageCount_);
     for (uint32_t i = 0; i < imageCount_; i++) {
         barrierHelpers.emplace_back(images_[i]);
@@ -288,6 +286,33 @@ void Swapchain::create(VkExtent2D& expectedWindowSize, bool vsync)
     }
 }
 
+void Swapchain::queryPresentModes()
+{
+    uint32_t presentModeCount;
+    check(vkGetPhysicalDeviceSurfacePresentModesKHR(ctx_.physicalDevice(), surface_,
+                                                    &presentModeCount, nullptr));
+    assert(presentModeCount > 0);
+
+    presentModes_.resize(presentModeCount);
+    check(vkGetPhysicalDeviceSurfacePresentModesKHR(ctx_.physicalDevice(), surface_,
+                                                    &presentModeCount, presentModes_.data()));
+
+    printLog("Available Present Modes: {}", presentModeCount);
+    for (const auto& mode : presentModes_) {
+        printLog("  VK_PRESENT_MODE_{}", presentModeToString(mode));
+    }
+}
+
+auto Swapchain::supportsPresentMode(VkPresentModeKHR mode) const -> bool
+{
+    return find(presentModes_.begin(), presentModes_.end(), mode) != presentModes_.end();
+}
+
+auto Swapchain::presentMode() const -> VkPresentModeKHR
+{
+    return presentMode_;
+}
+
 VkResult Swapchain::acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t& imageIndex)
 {
     return vkAcquireNextImageKHR(ctx_.device(), swapchain_, UINT64_MAX, presentCompleteSemaphore,
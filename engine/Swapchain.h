@@ -14,6 +14,8 @@ namespace hlab {
 
 using namespace std;
 
+const char* presentModeToString(VkPresentModeKHR mode);
+
 class Swapchain
 {
   public:
@@ -25,8 +27,14 @@ class Swapchain
 
     void initSurface(VkSurfaceKHR surface);
     void create(VkExtent2D& exectedWindowSize, bool vsync = false);
+    // Also recreates the swapchain, e.g. with another present mode (the device must be idle).
+    // Unsupported modes fall back to FIFO.
+    void create(VkExtent2D& exectedWindowSize, VkPresentModeKHR presentMode);
     void cleanup();
 
+    auto supportsPresentMode(VkPresentModeKHR mode) const -> bool;
+    auto presentMode() const -> VkPresentModeKHR;
+
     auto acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t& imageIndex) -> VkResult;
     auto queuePresent(VkQueue queue, uint32_t imageIndex,
                       VkSemaphore waitSemaphore = VK_NULL_HANDLE) -> VkResult;
@@ -81,6 +89,8 @@ class Swapchain
     vector<VkImage> images_{};
     vector<VkImageView> imageViews_{};
     uint32_t imageCount_{0};
+    vector<VkPresentModeKHR> presentModes_{}; // Supported by the surface
+    VkPresentModeKHR presentMode_{VK_PRESENT_MODE_FIFO_KHR};
 
     vector<BarrierHelper> barrierHelpers{};
 };
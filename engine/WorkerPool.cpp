@@ -0,0 +1,99 @@
+#include "WorkerPool.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <format>
+
+namespace hlab {
+
+WorkerPool::~WorkerPool()
+{
+    cleanup();
+}
+
+void WorkerPool::create(uint32_t threadCount)
+{
+    cleanup();
+
+    if (threadCount == 0) {
+        threadCount = std::max(thread::hardware_concurrency(), 1u);
+    }
+    threadCount_ = std::min(threadCount, kMaxThreads);
+
+    stopping_ = false;
+    jobGeneration_ = 0;
+    for (uint32_t i = 1; i < threadCount_; i++) {
+        workers_.emplace_back(&WorkerPool::workerLoop, this, i);
+    }
+
+    printLog("Worker threads: {}", threadCount_);
+}
+
+void WorkerPool::cleanup()
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    startCondition_.notify_all();
+    for (thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    threadCount_ = 1;
+}
+
+void WorkerPool::run(const function<void(uint32_t)>& job)
+{
+    if (workers_.empty()) {
+        job(0);
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(mutex_);
+        job_ = &job;
+        jobGeneration_++;
+        pendingWorkers_ = uint32_t(workers_.size());
+    }
+    startCondition_.notify_all();
+
+    job(0);
+
+    unique_lock<mutex> lock(mutex_);
+    doneCondition_.wait(lock, [&] { return pendingWorkers_ == 0; });
+    job_ = nullptr;
+}
+
+auto WorkerPool::threadCount() const -> uint32_t
+{
+    return threadCount_;
+}
+
+void WorkerPool::workerLoop(uint32_t threadIndex)
+{
+    Profiler::instance().setThreadName(std::format("worker {}", threadIndex));
+
+    uint64_t seenGeneration = 0;
+    while (true) {
+        unique_lock<mutex> lock(mutex_);
+        startCondition_.wait(lock,
+                             [&] { return stopping_ || jobGeneration_ != seenGeneration; });
+        if (stopping_) {
+            return;
+        }
+        seenGeneration = jobGeneration_;
+        const function<void(uint32_t)>& job = *job_;
+        lock.unlock();
+
+        job(threadIndex);
+
+        lock.lock();
+        if (--pendingWorkers_ == 0) {
+            doneCondition_.notify_one();
+        }
+    }
+}
+
+} // namespace hlab
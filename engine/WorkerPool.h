@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hlab {
+
+using namespace std;
+
+// Worker threads shared by the parallel parts of a frame (CommandRecorder, SoftwareOcclusion).
+// The calling thread works as thread 0, so threadCount() - 1 workers are created.
+//
+// run() is called from one thread at a time and does not nest.
+class WorkerPool
+{
+  public:
+    static constexpr uint32_t kMaxThreads = 8;
+
+    WorkerPool() = default;
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    ~WorkerPool();
+
+    // threadCount 0: one thread per hardware thread (at most kMaxThreads)
+    void create(uint32_t threadCount = 0);
+    void cleanup();
+
+    // Calls job(threadIndex) once on every thread and waits for all of them
+    void run(const function<void(uint32_t)>& job);
+
+    auto threadCount() const -> uint32_t;
+
+  private:
+    uint32_t threadCount_{1};
+    vector<thread> workers_;
+    mutex mutex_;
+    condition_variable startCondition_;
+    condition_variable doneCondition_;
+    const function<void(uint32_t)>* job_{nullptr}; // Called with the thread index
+    uint64_t jobGeneration_{0};
+    uint32_t pendingWorkers_{0};
+    bool stopping_{false};
+
+    void workerLoop(uint32_t threadIndex);
+};
+
+} // namespace hlab
@@ -0,0 +1,110 @@
+// CPU-only test of SoftwareOcclusion: known occluders and occludees, on the scalar and the AVX2
+// path, single threaded and on a WorkerPool. Runs headless; returns non-zero on failure.
+
+#include "SoftwareOcclusion.h"
+#include "WorkerPool.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <cstdio>
+
+using namespace hlab;
+
+static uint32_t failures = 0;
+
+static void expect(bool condition, const char* what, const char* path)
+{
+    if (!condition) {
+        printf("FAILED (%s): %s\n", path, what);
+        failures++;
+    }
+}
+
+// Camera at the origin looking down -z, Vulkan clip space like Camera
+static auto viewProjection() -> glm::mat4
+{
+    glm::mat4 projection =
+        glm::perspectiveRH_ZO(glm::radians(60.0f),
+                              float(SoftwareOcclusion::kWidth) / SoftwareOcclusion::kHeight,
+                              0.1f, 100.0f);
+    projection[1][1] *= -1.0f;
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+                                       glm::vec3(0.0f, 1.0f, 0.0f));
+    return projection * view;
+}
+
+// Occluder: an 8 x 8 wall at z = -10. Occludees are boxes in front of, behind and beside it.
+static auto runScene(SoftwareOcclusion& occlusion, const char* path) -> vector<float>
+{
+    occlusion.clearOccluders();
+    const uint32_t wall = occlusion.addOccluder(
+        {{-4.0f, -4.0f, 0.0f}, {4.0f, -4.0f, 0.0f}, {4.0f, 4.0f, 0.0f}, {-4.0f, 4.0f, 0.0f}},
+        {0, 1, 2, 0, 2, 3});
+
+    occlusion.beginFrame(viewProjection());
+    occlusion.renderOccluder(wall, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -10.0f)));
+    occlusion.rasterize();
+
+    expect(occlusion.triangleCount() == 2, "both wall triangles set up", path);
+
+    const auto box = [](glm::vec3 center, float halfSize) {
+        return AABB(center - glm::vec3(halfSize), center + glm::vec3(halfSize));
+    };
+    expect(!occlusion.isVisible(box({0.0f, 0.0f, -20.0f}, 1.0f)), "box behind the wall", path);
+    expect(!occlusion.isVisible(box({1.5f, -1.0f, -30.0f}, 2.0f)), "large box far behind", path);
+    expect(occlusion.isVisible(box({0.0f, 0.0f, -5.0f}, 1.0f)), "box in front of the wall",
+           path);
+    expect(occlusion.isVisible(box({0.0f, 0.0f, -10.5f}, 1.0f)), "box through the wall", path);
+    expect(occlusion.isVisible(box({12.0f, 0.0f, -20.0f}, 1.0f)), "box beside the wall", path);
+    expect(occlusion.isVisible(box({8.0f, 0.0f, -20.0f}, 1.0f)), "box partly behind the wall",
+           path);
+    expect(occlusion.isVisible(box({0.0f, 0.0f, 1.0f}, 2.0f)), "box around the camera", path);
+
+    return occlusion.depthBuffer();
+}
+
+static auto maxDifference(const vector<float>& a, const vector<float>& b) -> float
+{
+    float difference = 0.0f;
+    for (size_t i = 0; i < a.size(); i++) {
+        difference = std::max(difference, std::abs(a[i] - b[i]));
+    }
+    return difference;
+}
+
+int main()
+{
+    WorkerPool workers;
+    workers.create(4);
+
+    SoftwareOcclusion occlusion;
+    occlusion.create(workers);
+    const bool hasAvx2 = occlusion.isAvx2Enabled();
+
+    occlusion.setAvx2Enabled(false);
+    const vector<float> scalar = runScene(occlusion, "scalar");
+
+    // The same scene on the calling thread alone
+    SoftwareOcclusion singleThreaded;
+    singleThreaded.setAvx2Enabled(false);
+    const vector<float> scalarSingle = runScene(singleThreaded, "scalar, single thread");
+    expect(scalar == scalarSingle, "threads rasterize the same depth", "scalar");
+
+    if (hasAvx2) {
+        occlusion.setAvx2Enabled(true);
+        const vector<float> avx2 = runScene(occlusion, "AVX2");
+        expect(maxDifference(scalar, avx2) < 1e-5f, "AVX2 matches the scalar depth", "AVX2");
+    } else {
+        printf("AVX2 not supported by this CPU, only the scalar path was tested\n");
+    }
+
+    occlusion.cleanup();
+    workers.cleanup();
+
+    if (failures > 0) {
+        printf("%u checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -1,8 +1,12 @@
 #include "engine/Application.h"
 
+#include <string>
+
 using namespace hlab;
 
-int main()
+//   Ex14_Bistro trace [frame count] [output json]
+// Writes a CPU trace of loading and the first frames (F9 captures one at any time).
+int main(int argc, char* argv[])
 {
     ApplicationConfig config;
 
@@ -21,6 +25,16 @@ int main()
 
     config.camera = CameraConfig::forBistro();
 
+    if (argc > 1 && std::string(argv[1]) == "trace") {
+        config.profiler.captureAtStart = true;
+        if (argc > 2) {
+            config.profiler.captureFrames = static_cast<uint32_t>(std::stoul(argv[2]));
+        }
+        if (argc > 3) {
+            config.profiler.outputFile = argv[3];
+        }
+    }
+
     auto app = std::make_unique<Application>(config);
 
     app->run();
@@ -0,0 +1,66 @@
+#include "engine/HeadlessApplication.h"
+
+#include <string>
+
+using namespace hlab;
+
+// Renders the Bistro scene without a window, e.g. on CI or render farm nodes.
+//   Ex15_Headless [frame count] [capture prefix] [capture interval]
+//   Ex15_Headless benchmark [camera path file] [output json]
+//   Ex15_Headless trace [frame count] [output json]
+// Frames are written to "<capture prefix><frame>.png" when a prefix is given.
+int main(int argc, char* argv[])
+{
+    ApplicationConfig config;
+
+    config.models.push_back(
+        ModelConfig("characters/Leonard/Bboy Hip Hop Move.fbx", "Dancer")
+            .setTransform(glm::rotate(
+                glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-6.719f, 0.21f, -1.860f)),
+                           glm::vec3(0.012f)),
+                glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f)))
+            .setAnimation(true, 0, 1.0f, true));
+
+    config.models.push_back(
+        ModelConfig("models/AmazonLumberyardBistroMorganMcGuire/exterior.obj", "Bistro")
+            .setBistroModel(true)
+            .setTransform(glm::scale(glm::mat4(1.0f), glm::vec3(0.01f))));
+
+    config.camera = CameraConfig::forBistro();
+
+    HeadlessConfig headlessConfig;
+    if (argc > 1 && std::string(argv[1]) == "benchmark") {
+        config.benchmark.enabled = true;
+        if (argc > 2) {
+            config.benchmark.cameraPathFile = argv[2];
+        }
+        if (argc > 3) {
+            config.benchmark.outputFile = argv[3];
+        }
+    } else if (argc > 1 && std::string(argv[1]) == "trace") {
+        // CPU trace of loading and all frames
+        config.profiler.captureAtStart = true;
+        if (argc > 2) {
+            headlessConfig.frameCount = static_cast<uint32_t>(std::stoul(argv[2]));
+        }
+        config.profiler.captureFrames = headlessConfig.frameCount;
+        if (argc > 3) {
+            config.profiler.outputFile = argv[3];
+        }
+    } else {
+        if (argc > 1) {
+            headlessConfig.frameCount = static_cast<uint32_t>(std::stoul(argv[1]));
+        }
+        if (argc > 2) {
+            headlessConfig.capturePrefix = argv[2];
+        }
+        if (argc > 3) {
+            headlessConfig.captureInterval = static_cast<uint32_t>(std::stoul(argv[3]));
+        }
+    }
+
+    auto app = std::make_unique<HeadlessApplication>(config, headlessConfig);
+
+    app->run();
+    return 0;
+}
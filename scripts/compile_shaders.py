@@ -21,6 +21,16 @@ class ShaderCompilerHandler(FileSystemEventHandler):
             '.tese': 'tessellation evaluation',
             '.comp': 'compute'
         }
+
+        # Extra outputs compiled from one source with preprocessor defines
+        # (e.g. pbrForward.frag -> pbrForwardAlphaTest.frag.spv with -DALPHA_TEST)
+        self.shader_variants = {
+            'pbrForward.frag': {'pbrForwardAlphaTest': ['ALPHA_TEST'],
+                                'pbrForwardBlend': ['ALPHA_BLEND']},
+            'pbrDeferred.frag': {'pbrDeferredAlphaTest': ['ALPHA_TEST']},
+            'shadowMap.vert': {'shadowMapAlphaTest': ['ALPHA_TEST']},
+            'shadowMap.frag': {'shadowMapAlphaTest': ['ALPHA_TEST']},
+        }
         
         # Cache glslc path to avoid repeated PATH lookups
         self.glslc_path = self._find_glslc()
@@ -51,13 +61,23 @@ class ShaderCompilerHandler(FileSystemEventHandler):
         if file_path.suffix in self.shader_extensions:
             self.compile_shader(file_path)
 
+    def shader_outputs(self, shader_path):
+        """(output path, defines) of every SPV compiled from a shader file"""
+        relative_path = shader_path.relative_to(self.watch_dir)
+        outputs = [(self.output_dir / f"{relative_path}.spv", [])]
+        for variant, defines in self.shader_variants.get(shader_path.name, {}).items():
+            variant_path = relative_path.with_name(f"{variant}{shader_path.suffix}.spv")
+            outputs.append((self.output_dir / variant_path, defines))
+        return outputs
+
     def compile_shader(self, shader_path):
-        """Compile a single shader file to SPV"""
+        """Compile a single shader file (and its variants) to SPV"""
+        for output_path, defines in self.shader_outputs(shader_path):
+            self.compile_output(shader_path, output_path, defines)
+
+    def compile_output(self, shader_path, output_path, defines):
+        """Compile a shader file to one SPV output"""
         try:
-            # Generate output path (same name with .spv extension)
-            relative_path = shader_path.relative_to(self.watch_dir)
-            output_path = self.output_dir / f"{relative_path}.spv"
-            
             # Skip compilation if output is newer than source
             if (output_path.exists() and 
                 output_path.stat().st_mtime > shader_path.stat().st_mtime):
@@ -71,7 +91,7 @@ class ShaderCompilerHandler(FileSystemEventHandler):
                 self.glslc_path,
                 str(shader_path),
                 '-o', str(output_path)
-            ]
+            ] + [f"-D{define}" for define in defines]
             
             # Generate timestamp only when needed
             timestamp = datetime.now().strftime("%H:%M:%S")
@@ -121,11 +141,9 @@ class ShaderCompilerHandler(FileSystemEventHandler):
         compiled_count = 0
         for shader_file in shader_files:
             # Check if compilation is needed before calling compile_shader
-            relative_path = shader_file.relative_to(self.watch_dir)
-            output_path = self.output_dir / f"{relative_path}.spv"
-            
-            if (not output_path.exists() or 
-                output_path.stat().st_mtime <= shader_file.stat().st_mtime):
+            if any(not output_path.exists() or
+                   output_path.stat().st_mtime <= shader_file.stat().st_mtime
+                   for output_path, _ in self.shader_outputs(shader_file)):
                 self.compile_shader(shader_file)
                 compiled_count += 1
         